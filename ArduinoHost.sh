@@ -0,0 +1,33 @@
+echo "ArduinoHost.sh <sketch_file> [name=value ...]"
+
+# Builds a sketch to run on a Linux PC with the shield simulated, see ArduinoHost/ArduinoHost.cpp.
+# Each name=value changes the 'const' of that name in the sketch, for example display_transport=0.
+
+x=${1%.*}
+y=${x##*/}
+z=$(dirname $0)/ArduinoHost
+
+mkdir -p $x
+
+cp $1 $x/$y.ino
+
+shift
+
+for v in "$@"
+do
+	sed -i -E "s/^(const [a-z ]+ ${v%%=*} = )[^;]+;/\1${v#*=};/" $x/$y.ino
+done
+
+# the 6502's memory functions are wrapped, so ArduinoHost.cpp can give it a flat 64KB
+sed -i -E 's/^(unsigned char x6502_read|void x6502_write)\(/\1_shield(/' $x/$y.ino
+
+# function prototypes, as the Arduino IDE would make
+grep -E '^(unsigned |const |volatile |static |inline )*(void|int|char|bool|long|byte|unsigned|unsigned char|unsigned int|unsigned long|unsigned char \*) *[a-z0-9_]+\(.*\)\s*(//.*)?$' $x/$y.ino | sed -E 's@\s*//.*$@@; s@\s*$@;@' > $x/$y.h
+
+echo "unsigned char x6502_read(unsigned char BL, unsigned char BH);" >> $x/$y.h
+echo "void x6502_write(unsigned char BL, unsigned char BH, unsigned char BD);" >> $x/$y.h
+
+# x6502_stats keeps the 6502's counts, for the monitor's '?' command and for -6502
+g++ -O2 -Wall -Dx6502_stats -I$z -include Arduino.h -include $x/$y.h -x c++ $x/$y.ino -x c++ $z/ArduinoHost.cpp -o $x/$y
+
+echo "Run with: $x/$y -help"
@@ -0,0 +1,174 @@
+// Arduino.h
+
+// Stand-in for the Arduino core, so the sketches can be compiled and run on a Linux PC.
+// Only what the sketches use is here.  Pin changes go to the shield model in ArduinoHost.cpp,
+// which also counts the AVR cycles each pin change would have taken on the Arduino UNO.
+
+#ifndef ARDUINO_HOST_H
+#define ARDUINO_HOST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define PROGMEM
+#define ISR(vector) extern "C" void vector(void); void vector(void)
+
+#define pgm_read_byte_near(address) (*(const unsigned char *)(address))
+#define pgm_read_byte(address) (*(const unsigned char *)(address))
+#define pgm_read_word_near(address) ((unsigned short)(((const unsigned char *)(address))[0] | (((const unsigned char *)(address))[1] << 8))) // little endian, as on the AVR
+#define pgm_read_word(address) pgm_read_word_near(address)
+
+typedef unsigned char byte;
+typedef unsigned char uint8_t;
+typedef unsigned short uint16_t;
+typedef bool boolean;
+
+extern unsigned long long host_cycles; // AVR cycles at 16 MHz spent on pins and delays
+
+void pinMode(unsigned char pin, unsigned char mode);
+void digitalWrite(unsigned char pin, unsigned char value);
+int digitalRead(unsigned char pin);
+
+void delay(unsigned long value);
+void delayMicroseconds(unsigned int value);
+unsigned long millis();
+unsigned long micros();
+
+long random(long value);
+long random(long low, long high);
+void randomSeed(unsigned long value);
+
+void interrupts();
+void noInterrupts();
+int digitalPinToInterrupt(unsigned char pin);
+void attachInterrupt(int number, void (*function)(void), int mode);
+void detachInterrupt(int number);
+
+void __builtin_avr_delay_cycles(unsigned long value);
+
+// the port registers, bit changes cost 2 cycles like 'sbi' and 'cbi'
+
+class host_register
+{
+public:
+	host_register(int id) : number(id), value(0x00) {}
+
+	operator unsigned char();
+	host_register &operator=(const unsigned char data);
+	host_register &operator|=(const unsigned char data);
+	host_register &operator&=(const unsigned char data);
+	host_register &operator^=(const unsigned char data);
+
+	int number;
+	unsigned char value;
+};
+
+class host_register16
+{
+public:
+	host_register16(int id) : number(id), value(0x0000) {}
+
+	operator unsigned int();
+	host_register16 &operator=(const unsigned int data);
+
+	int number;
+	unsigned int value;
+};
+
+extern host_register PORTB, PINB, DDRB, PORTD, PIND, DDRD;
+extern host_register UCSR0A, UCSR0B, UCSR0C, UDR0;
+extern host_register SPCR, SPSR, SPDR;
+extern host_register TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+extern host_register EIMSK, EICRA, SREG;
+extern host_register16 UBRR0, OCR1A, OCR1B, ICR1, TCNT1;
+
+// bit names used by the sketches
+
+#define PORTD0 0
+#define PORTD1 1
+#define PORTD2 2
+#define PORTD3 3
+#define PORTD4 4
+#define PORTD5 5
+#define PORTD6 6
+#define PORTD7 7
+
+#define MPCM0 0
+#define U2X0 1
+#define UPE0 2
+#define DOR0 3
+#define FE0 4
+#define UDRE0 5
+#define TXC0 6
+#define RXC0 7
+
+#define TXB80 0
+#define RXB80 1
+#define UCSZ02 2
+#define TXEN0 3
+#define RXEN0 4
+#define UDRIE0 5
+#define TXCIE0 6
+#define RXCIE0 7
+
+#define UCPOL0 0
+#define UCPHA0 1
+#define UDORD0 2
+#define UCSZ00 1
+#define UCSZ01 2
+#define USBS0 3
+#define UPM00 4
+#define UPM01 5
+#define UMSEL00 6
+#define UMSEL01 7
+
+#define SPR0 0
+#define SPR1 1
+#define CPHA 2
+#define CPOL 3
+#define MSTR 4
+#define DORD 5
+#define SPE 6
+#define SPIE 7
+#define SPI2X 0
+#define WCOL 6
+#define SPIF 7
+
+#define WGM10 0
+#define WGM11 1
+#define COM1B0 4
+#define COM1B1 5
+#define COM1A0 6
+#define COM1A1 7
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define WGM13 4
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define TOV1 0
+#define OCF1A 1
+#define OCF1B 2
+
+#define INT0 0
+#define INT1 1
+#define ISC00 0
+#define ISC01 1
+
+#define _BV(bit) (1 << (bit))
+
+#endif
@@ -0,0 +1,1325 @@
+// ArduinoHost.cpp
+
+// Runs the ArduinoShield sketches on a Linux PC, see ArduinoHost.sh for building.
+// The shield is modelled at the pin level:
+//   pins 4 and 5 clock packets into the CPLD's 24-bit shift register (Verilog6.v),
+//   which reads or writes the 16KB RAM and latches reads into the shift register on pins 6 and 7,
+//   pins 2 and 3 are the PS/2 keyboard, fed from a script,
+//   pins 10 to 13 are the SD card, kept in an image file,
+//   pin 9 is the speaker, counted in periods of Timer1, and the EEPROM is kept in a file.
+// Every pin change and delay adds the AVR cycles it would take on the Arduino UNO to host_cycles,
+// so changes to the sketches can be measured without the board.
+
+#include "Arduino.h"
+#include "EEPROM.h"
+
+#include <signal.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+extern void setup();
+extern void loop();
+
+extern void display_initialize();
+
+// only in the BASIC sketch, where ArduinoHost.sh renames the 6502's memory functions so a flat 64KB can be swapped in
+extern unsigned char x6502_L __attribute__((weak));
+extern unsigned char x6502_H __attribute__((weak));
+extern unsigned long x6502_count __attribute__((weak));
+extern int x6502_instruction() __attribute__((weak));
+extern void x6502_reset() __attribute__((weak));
+extern unsigned char x6502_read_shield(unsigned char BL, unsigned char BH) __attribute__((weak));
+extern void x6502_write_shield(unsigned char BL, unsigned char BH, unsigned char BD) __attribute__((weak));
+extern void display_sendpacket(const unsigned char high, const unsigned char low, const unsigned char value);
+extern unsigned char display_receivepacket(const unsigned char high, const unsigned char low);
+
+unsigned long long host_cycles = 0;
+
+const unsigned long host_cost_digitalwrite = 54; // cycles, measured on the UNO
+const unsigned long host_cost_digitalread = 50;
+const unsigned long host_cost_pinmode = 50;
+const unsigned long host_cost_bit = 2; // 'sbi' or 'cbi'
+const unsigned long host_cost_port = 1; // 'in' or 'out'
+const unsigned long host_cost_access = 11; // 16 CPLD master clocks at 25.175 MHz, in AVR cycles
+const unsigned long host_cost_clear = 6; // 8 CPLD master clocks
+
+unsigned char host_pin_level[20];
+unsigned char host_pin_mode[20];
+
+unsigned long long host_cycles_limit = 0;
+int host_bench = 0;
+int host_quiet = 0;
+int host_ram_size = 16384;
+const char *host_dump_name = NULL; // RAM is saved here at the end
+
+void host_pin_change(const unsigned char pin, const unsigned char level);
+void host_finish();
+
+
+// CPLD, following Verilog6.v
+
+unsigned char cpld_ram[16384];
+unsigned long cpld_shift = 0x000000; // 24 bits
+unsigned char cpld_clear = 0x00;
+unsigned long long cpld_set_time = 0; // when bit 23 was set
+unsigned long long cpld_clear_time = 0; // when bit 23 was cleared
+unsigned char cpld_pending = 0x00; // access waiting for the master clock
+unsigned char cpld_output = 0x00; // output shift register (pins 6 and 7)
+
+unsigned long cpld_packets = 0;
+unsigned long cpld_reads = 0;
+unsigned long cpld_writes = 0;
+unsigned long cpld_violations = 0;
+unsigned long cpld_clocks = 0;
+unsigned long long cpld_last_write = 0;
+
+unsigned int cpld_address()
+{
+	return (unsigned int)((cpld_shift >> 8) & 0x3FFF) % host_ram_size;
+}
+
+void cpld_master() // catches the master clock domain up to host_cycles
+{
+	if (cpld_shift & 0x800000)
+	{
+		if (cpld_pending && host_cycles >= cpld_set_time + host_cost_access)
+		{
+			cpld_pending = 0x00;
+			cpld_clear = 0x01;
+
+			if (cpld_shift & 0x400000)
+			{
+				cpld_ram[cpld_address()] = (unsigned char)(cpld_shift & 0xFF);
+				cpld_writes++;
+				cpld_last_write = host_cycles;
+			}
+			else
+			{
+				cpld_output = cpld_ram[cpld_address()]; // serial_latch
+				cpld_reads++;
+			}
+		}
+	}
+	else
+	{
+		if (host_cycles >= cpld_clear_time + host_cost_clear)
+		{
+			cpld_clear = 0x00;
+		}
+	}
+}
+
+void cpld_violation(const char *text)
+{
+	cpld_violations++;
+
+	if (!host_quiet && cpld_violations <= 10)
+	{
+		fprintf(stderr, "ArduinoHost: CPLD %s at cycle %llu\n", text, host_cycles);
+	}
+}
+
+void cpld_set(const unsigned long value)
+{
+	unsigned long before = cpld_shift;
+
+	cpld_shift = value & 0xFFFFFF;
+
+	if (!(before & 0x800000) && (cpld_shift & 0x800000))
+	{
+		cpld_set_time = host_cycles;
+		cpld_packets++;
+
+		if (cpld_clear)
+		{
+			cpld_violation("packet started before the last one was seen as cleared");
+		}
+		else
+		{
+			cpld_pending = 0x01;
+		}
+	}
+	else if ((before & 0x800000) && !(cpld_shift & 0x800000))
+	{
+		cpld_clear_time = host_cycles;
+	}
+}
+
+void cpld_clock(const unsigned char data) // rising edge of serial_clock
+{
+	cpld_master();
+
+	cpld_clocks++;
+
+	if (cpld_pending)
+	{
+		cpld_violation("clocked before the access was done");
+
+		cpld_pending = 0x00; // the access is lost
+		cpld_clear = 0x01;
+	}
+
+	if ((cpld_shift & 0x800000) && cpld_clear)
+	{
+		cpld_set(0x000000);
+	}
+	else
+	{
+		cpld_set((cpld_shift << 1) | (data ? 1 : 0));
+	}
+}
+
+unsigned char cpld_data() // pin 7
+{
+	cpld_master();
+
+	if (cpld_pending)
+	{
+		cpld_violation("read before the data was latched");
+	}
+
+	return (cpld_output & 0x80) ? HIGH : LOW;
+}
+
+void cpld_shiftout() // rising edge of pin 6
+{
+	cpld_master();
+
+	cpld_output = (unsigned char)(cpld_output << 1);
+}
+
+
+// SD card in SPI mode, blocks kept in an image file
+
+FILE *sd_file = NULL;
+int sd_sdhc = 0; // block addressed when set
+unsigned char sd_ready = 0x00; // finished ACMD41
+unsigned char sd_app = 0x00; // CMD55 was sent
+int sd_tries = 0; // ACMD41 since CMD0
+unsigned char sd_command[6];
+int sd_command_pos = 0;
+unsigned char sd_queue[1024]; // bytes waiting to go out on MISO
+int sd_queue_head = 0;
+int sd_queue_tail = 0;
+int sd_mode = 0; // 0 = commands, 1 = receiving a written block, 2 = reading multiple blocks, 3 = writing multiple blocks
+unsigned long sd_address = 0;
+unsigned char sd_block[514];
+int sd_block_pos = -1;
+unsigned char sd_in = 0x00;
+int sd_bit = 0;
+unsigned char sd_out = 0xFF;
+
+unsigned long sd_reads = 0;
+unsigned long sd_writes = 0;
+unsigned long sd_commands = 0;
+
+void sd_push(const unsigned char value)
+{
+	sd_queue[sd_queue_tail] = value;
+	sd_queue_tail = (sd_queue_tail + 1) % 1024;
+}
+
+void sd_readblock(unsigned long block)
+{
+	unsigned char data[512];
+
+	memset(data, 0x00, 512);
+
+	if (sd_file)
+	{
+		fseek(sd_file, (long)(block * 512), SEEK_SET);
+		if (fread(data, 1, 512, sd_file) < 512) {}
+	}
+
+	sd_push(0xFF);
+	sd_push(0xFE); // data token
+
+	for (int i=0; i<512; i++) sd_push(data[i]);
+
+	sd_push(0xFF); // CRC
+	sd_push(0xFF);
+
+	sd_reads++;
+}
+
+void sd_writeblock(unsigned long block)
+{
+	if (sd_file)
+	{
+		fseek(sd_file, (long)(block * 512), SEEK_SET);
+		fwrite(sd_block, 1, 512, sd_file);
+		fflush(sd_file);
+	}
+
+	sd_writes++;
+}
+
+unsigned long sd_block_number(unsigned long argument)
+{
+	if (sd_sdhc) return argument;
+	else return argument / 512;
+}
+
+void sd_execute()
+{
+	unsigned char index = sd_command[0] & 0x3F;
+	unsigned long argument = ((unsigned long)sd_command[1] << 24) | ((unsigned long)sd_command[2] << 16) | 
+		((unsigned long)sd_command[3] << 8) | (unsigned long)sd_command[4];
+	unsigned char idle = sd_ready ? 0x00 : 0x01;
+
+	sd_commands++;
+
+	sd_push(0xFF); // one byte before the response
+
+	if (sd_app)
+	{
+		sd_app = 0x00;
+
+		if (index == 41) // ready on the second try, like most cards
+		{
+			sd_tries++;
+
+			if (sd_tries >= 2) sd_ready = 0x01;
+
+			sd_push(sd_ready ? 0x00 : 0x01);
+			return;
+		}
+	}
+
+	switch (index)
+	{
+		case 0: { sd_ready = 0x00; sd_tries = 0; sd_mode = 0; sd_push(0x01); break; }
+		case 8: { sd_push(idle); sd_push(0x00); sd_push(0x00); sd_push(0x01); sd_push(sd_command[4]); break; }
+		case 55: { sd_app = 0x01; sd_push(idle); break; }
+		case 58: { sd_push(idle); sd_push(sd_sdhc ? 0xC0 : 0x80); sd_push(0xFF); sd_push(0x80); sd_push(0x00); break; }
+		case 16: { sd_push(idle); break; }
+		case 12: { sd_mode = 0; sd_queue_head = sd_queue_tail; sd_push(0xFF); sd_push(0x00); sd_push(0xFF); break; }
+		case 17:
+		{
+			sd_push(0x00);
+			sd_readblock(sd_block_number(argument));
+			break;
+		}
+		case 18:
+		{
+			sd_push(0x00);
+			sd_address = sd_block_number(argument);
+			sd_mode = 2;
+			break;
+		}
+		case 24:
+		{
+			sd_push(0x00);
+			sd_address = sd_block_number(argument);
+			sd_mode = 1;
+			sd_block_pos = -1;
+			break;
+		}
+		case 25:
+		{
+			sd_push(0x00);
+			sd_address = sd_block_number(argument);
+			sd_mode = 3;
+			sd_block_pos = -1;
+			break;
+		}
+		default: { sd_push(0x04); break; } // illegal command
+	}
+}
+
+unsigned char sd_exchange(const unsigned char value) // one byte each way
+{
+	unsigned char temp_out = 0xFF;
+
+	if (host_pin_level[10] == HIGH) return 0xFF; // not selected
+
+	if (sd_queue_head != sd_queue_tail)
+	{
+		temp_out = sd_queue[sd_queue_head];
+		sd_queue_head = (sd_queue_head + 1) % 1024;
+	}
+	else if (sd_mode == 2)
+	{
+		sd_readblock(sd_address);
+		sd_address++;
+	}
+
+	if (sd_mode == 1 || sd_mode == 3) // receiving data
+	{
+		if (sd_block_pos < 0)
+		{
+			if (value == 0xFE || (sd_mode == 3 && value == 0xFC)) sd_block_pos = 0;
+			else if (sd_mode == 3 && value == 0xFD) { sd_mode = 0; sd_push(0xFF); sd_push(0x00); sd_push(0xFF); }
+		}
+		else
+		{
+			sd_block[sd_block_pos] = value;
+			sd_block_pos++;
+
+			if (sd_block_pos == 514)
+			{
+				sd_writeblock(sd_address);
+				sd_address++;
+				sd_block_pos = -1;
+
+				if (sd_mode == 1) sd_mode = 0;
+
+				sd_push(0x05); // data accepted
+				sd_push(0x00); // busy
+				sd_push(0xFF);
+			}
+		}
+
+		return temp_out;
+	}
+
+	if (sd_command_pos == 0)
+	{
+		if ((value & 0xC0) == 0x40) { sd_command[0] = value; sd_command_pos = 1; }
+	}
+	else
+	{
+		sd_command[sd_command_pos] = value;
+		sd_command_pos++;
+
+		if (sd_command_pos == 6)
+		{
+			sd_command_pos = 0;
+			sd_execute();
+		}
+	}
+
+	return temp_out;
+}
+
+void sd_clock() // rising edge of pin 13, bit-banged
+{
+	if (host_pin_level[10] == HIGH) return;
+
+	sd_in = (unsigned char)((sd_in << 1) | (host_pin_level[11] ? 1 : 0));
+	sd_bit++;
+
+	if (sd_bit == 8)
+	{
+		sd_bit = 0;
+		sd_out = sd_exchange(sd_in);
+		sd_out = (sd_queue_head != sd_queue_tail) ? sd_queue[sd_queue_head] : 0xFF;
+	}
+}
+
+unsigned char sd_miso() // pin 12
+{
+	if (host_pin_level[10] == HIGH) return HIGH;
+
+	unsigned char temp_next = (sd_queue_head != sd_queue_tail) ? sd_queue[sd_queue_head] : 0xFF;
+
+	return (temp_next & (0x80 >> sd_bit)) ? HIGH : LOW;
+}
+
+
+// PS/2 keyboard, frames of 11 bits from a script, delivered from a timer signal
+
+extern "C" void INT0_vect(void) __attribute__((weak));
+
+void (*host_interrupt)(void) = NULL; // from attachInterrupt(), or INT0_vect once EIMSK enables it
+unsigned char ps2_codes[65536];
+int ps2_length = 0;
+int ps2_pos = 0;
+int ps2_wait = 0;
+unsigned long long ps2_release = 0;
+
+const unsigned char ps2_scancodes[128] = { // ASCII to set 2 make codes, 0x80 means shifted
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x66,0x0D,0x5A,0x00,0x00,0x5A,0x00,0x00,
+	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x76,0x00,0x00,0x00,0x00,
+	0x29,0x96,0xD2,0xA6,0xA5,0xAE,0xBD,0x52,0xC6,0xC5,0xBE,0xD5,0x41,0x4E,0x49,0x4A,
+	0x45,0x16,0x1E,0x26,0x25,0x2E,0x36,0x3D,0x3E,0x46,0xCC,0x4C,0xC1,0x55,0xC9,0xCA,
+	0x9E,0x9C,0xB2,0xA1,0xA3,0xA4,0xAB,0xB4,0xB3,0xC3,0xBB,0xC2,0xCB,0xBA,0xB1,0xC4,
+	0xCD,0x95,0xAD,0x9B,0xAC,0xBC,0xAA,0x9D,0xA2,0xB5,0x9A,0x54,0x5D,0x5B,0xB6,0xCE,
+	0x0E,0x1C,0x32,0x21,0x23,0x24,0x2B,0x34,0x33,0x43,0x3B,0x42,0x4B,0x3A,0x31,0x44,
+	0x4D,0x15,0x2D,0x1B,0x2C,0x3C,0x2A,0x1D,0x22,0x35,0x1A,0xD4,0xDD,0xDB,0x8E,0x71
+};
+
+void ps2_add(const unsigned char code)
+{
+	if (ps2_length < 65536) ps2_codes[ps2_length++] = code;
+}
+
+void ps2_type(const char *text) // make and break codes, with shift where needed
+{
+	for (int i=0; text[i] != 0; i++)
+	{
+		unsigned char temp_code = ps2_scancodes[(unsigned char)text[i] & 0x7F];
+
+		if (text[i] == '\\' && text[i+1] == 'n') { i++; temp_code = 0x5A; }
+		else if (text[i] == '\\' && text[i+1] == 'e') { i++; temp_code = 0x76; }
+		else if (text[i] == '\\' && text[i+1] == 'p') { i++; ps2_add(0x00); continue; } // pause
+		else if (text[i] == '\\' && text[i+1] == '\\') i++;
+
+		if (temp_code == 0x00) continue;
+
+		if (temp_code & 0x80) ps2_add(0x12);
+		ps2_add(temp_code & 0x7F);
+		ps2_add(0xF0);
+		ps2_add(temp_code & 0x7F);
+		if (temp_code & 0x80) { ps2_add(0xF0); ps2_add(0x12); }
+	}
+}
+
+void ps2_tick() // one frame per call, its bits 80 us apart in sketch time as from a real keyboard
+{
+	if (host_interrupt == NULL && INT0_vect != NULL && (EIMSK.value & (1 << INT0))) host_interrupt = INT0_vect;
+
+	if (ps2_pos >= ps2_length || host_interrupt == NULL) return;
+
+	if (ps2_wait > 0) { ps2_wait--; return; }
+
+	unsigned char temp_code = ps2_codes[ps2_pos];
+	unsigned char temp_parity = 0x01;
+
+	if (temp_code == 0x00) // half a second
+	{
+		ps2_pos++;
+		ps2_wait = 500;
+		return;
+	}
+
+	for (int i=0; i<8; i++) temp_parity ^= (temp_code >> i) & 0x01;
+
+	unsigned char temp_data;
+
+	for (int i=0; i<11; i++)
+	{
+		if (i == 0) temp_data = 0; // start
+		else if (i <= 8) temp_data = (temp_code >> (i - 1)) & 0x01;
+		else if (i == 9) temp_data = temp_parity;
+		else temp_data = 1; // stop
+
+		if (i > 0) host_cycles += 1280; // 12.5 kHz clock
+
+		host_pin_level[3] = temp_data ? HIGH : LOW;
+		host_pin_level[2] = LOW;
+		ps2_release = host_cycles + 640; // clock low for 40 us
+		host_interrupt(); // falling edge of the clock
+		host_pin_level[2] = HIGH;
+	}
+
+	ps2_pos++;
+	ps2_wait = 12; // as many ticks per code as when each bit took one
+}
+
+
+// serial port, lines from stdin, with a pause after each one like typing into the monitor
+
+extern "C" void USART_RX_vect(void) __attribute__((weak));
+
+unsigned char serial_buffer[65536];
+int serial_length = 0;
+int serial_pos = 0;
+unsigned long long serial_gap = 0; // cycle count when a pause ends
+int serial_enabled = 0;
+
+int serial_ready() // a byte waits in UDR0
+{
+	if (serial_pos >= serial_length) return 0;
+
+	if (serial_buffer[serial_pos] == '\n') // no line ending, just a pause
+	{
+		if (serial_gap == 0) serial_gap = host_cycles + 1600000;
+
+		if (host_cycles < serial_gap) return 0; // 100 ms in sketch time
+
+		serial_gap = 0;
+		serial_pos++;
+
+		return 0;
+	}
+
+	return 1;
+}
+
+void serial_tick() // the rest of a line at once, while the receive interrupt is on, so the sketch never sees a gap inside one
+{
+	if (USART_RX_vect == NULL) return;
+
+	while ((UCSR0B.value & (1 << RXCIE0)) && serial_ready()) USART_RX_vect();
+}
+
+
+// EEPROM, kept in a file
+
+unsigned char eeprom_memory[1024];
+const char *eeprom_name = NULL;
+unsigned long eeprom_writes = 0;
+
+void eeprom_store()
+{
+	if (eeprom_name)
+	{
+		FILE *temp_file = fopen(eeprom_name, "wb");
+
+		if (temp_file)
+		{
+			fwrite(eeprom_memory, 1, 1024, temp_file);
+			fclose(temp_file);
+		}
+	}
+}
+
+unsigned char host_eeprom::read(int address)
+{
+	host_cycles += 4;
+
+	return eeprom_memory[address % 1024];
+}
+
+void host_eeprom::write(int address, unsigned char value)
+{
+	host_cycles += 52800; // 3.3 ms
+
+	eeprom_memory[address % 1024] = value;
+
+	eeprom_writes++;
+}
+
+void host_eeprom::update(int address, unsigned char value)
+{
+	if (read(address) != value) write(address, value);
+}
+
+host_eeprom EEPROM;
+
+void eeprom_read_block(void *dst, const void *src, unsigned int n)
+{
+	for (unsigned int i=0; i<n; i++) ((unsigned char *)dst)[i] = EEPROM.read((int)((unsigned long)src + i));
+}
+
+
+// Timer1, only the fast PWM mode with ICR1 as TOP that audio_note() uses, caught up from the timer signal
+
+extern "C" void TIMER1_OVF_vect(void) __attribute__((weak));
+
+unsigned long long timer1_last = 0; // cycle count of the last overflow
+unsigned long timer1_periods = 0; // overflows with OC1A connected, PWM periods on pin 9
+
+FILE *wav_file = NULL; // pin 9 while Timer1 runs, as 8-bit samples, each the share of 1024 cycles it was high
+const unsigned long wav_cycles = 1024; // 15625 samples a second
+unsigned long long wav_time = 0; // cycle count rendered up to
+unsigned long wav_high = 0; // cycles high so far in this sample
+unsigned long wav_samples = 0;
+
+void wav_render(const unsigned long long until, const unsigned long long high) // pin 9 high up to 'high', then low up to 'until'
+{
+	if (!wav_file) return;
+
+	while (wav_time < until)
+	{
+		unsigned long long temp_end = (wav_time / wav_cycles + 1) * wav_cycles;
+
+		if (temp_end > until) temp_end = until;
+
+		if (high > wav_time) wav_high += (unsigned long)((high < temp_end ? high : temp_end) - wav_time);
+
+		wav_time = temp_end;
+
+		if (wav_time % wav_cycles == 0)
+		{
+			fputc((int)(wav_high * 255 / wav_cycles), wav_file);
+
+			wav_high = 0;
+			wav_samples++;
+		}
+	}
+}
+
+void wav_header() // at the start, and again at the end with the sizes
+{
+	unsigned char temp_header[44] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0,
+		0x09, 0x3D, 0, 0, 0x09, 0x3D, 0, 0, 1, 0, 8, 0, 'd', 'a', 't', 'a', 0, 0, 0, 0 }; // PCM, mono, 15625 bytes a second, 8 bits
+
+	for (int i=0; i<4; i++)
+	{
+		temp_header[4+i] = (unsigned char)(((wav_samples + 36) >> (i * 8)) & 0xFF);
+		temp_header[40+i] = (unsigned char)((wav_samples >> (i * 8)) & 0xFF);
+	}
+
+	fseek(wav_file, 0, SEEK_SET);
+	fwrite(temp_header, 1, 44, wav_file);
+	fseek(wav_file, 0, SEEK_END);
+}
+
+void timer1_start() // counting from BOTTOM now, rather than from the last timer signal
+{
+	timer1_last = host_cycles;
+
+	wav_time = host_cycles;
+	wav_high = 0;
+}
+
+unsigned char timer1_busy = 0x00; // from delay() and from the timer signal, not both at once
+
+void timer1_tick()
+{
+	static const unsigned int temp_prescale[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+	if (timer1_busy) return;
+
+	timer1_busy = 0x01;
+
+	while (true) // the interrupt may change the period, or stop the timer
+	{
+		unsigned long long temp_period = (unsigned long long)(ICR1.value + 1) * temp_prescale[TCCR1B.value & 0x07];
+
+		if (temp_period == 0 || TIMER1_OVF_vect == NULL)
+		{
+			timer1_last = host_cycles;
+
+			wav_time = host_cycles; // nothing is kept while it is stopped
+
+			break;
+		}
+
+		if (host_cycles < timer1_last + temp_period) break;
+
+		if (TCCR1A.value & (1 << COM1A1)) wav_render(timer1_last + temp_period, timer1_last + temp_period * (OCR1A.value + 1) / (ICR1.value + 1)); // high from BOTTOM to the OCR1A match
+		else wav_render(timer1_last + temp_period, 0);
+
+		timer1_last += temp_period;
+
+		if (TCCR1A.value & (1 << COM1A1)) timer1_periods++;
+
+		if (TIMSK1.value & (1 << TOIE1)) TIMER1_OVF_vect();
+	}
+
+	timer1_busy = 0x00;
+}
+
+
+// pins and registers
+
+void host_pin_change(const unsigned char pin, const unsigned char level)
+{
+	unsigned char before = host_pin_level[pin];
+
+	host_pin_level[pin] = level;
+
+	if (before == LOW && level == HIGH)
+	{
+		if (pin == 4) cpld_clock(host_pin_level[5]);
+		else if (pin == 6) cpld_shiftout();
+		else if (pin == 13) sd_clock();
+	}
+
+	if (host_cycles_limit && host_cycles >= host_cycles_limit) host_finish();
+}
+
+unsigned char host_pin_read(const unsigned char pin)
+{
+	if (pin == 7) return cpld_data();
+	else if (pin == 12) return sd_miso();
+	else if (pin == 2 && host_cycles >= ps2_release) return HIGH;
+	else return host_pin_level[pin];
+}
+
+void pinMode(unsigned char pin, unsigned char mode)
+{
+	host_cycles += host_cost_pinmode;
+
+	if (pin < 20)
+	{
+		host_pin_mode[pin] = mode;
+
+		if (mode == INPUT_PULLUP) host_pin_level[pin] = HIGH;
+	}
+}
+
+void digitalWrite(unsigned char pin, unsigned char value)
+{
+	host_cycles += host_cost_digitalwrite;
+
+	if (pin < 20) host_pin_change(pin, value ? HIGH : LOW);
+}
+
+int digitalRead(unsigned char pin)
+{
+	host_cycles += host_cost_digitalread;
+
+	if (pin < 20) return host_pin_read(pin);
+	else return LOW;
+}
+
+host_register PORTB(1), PINB(2), DDRB(3), PORTD(4), PIND(5), DDRD(6);
+host_register UCSR0A(10), UCSR0B(11), UCSR0C(12), UDR0(13);
+host_register SPCR(20), SPSR(21), SPDR(22);
+host_register TCCR1A(30), TCCR1B(31), TCCR1C(32), TIMSK1(33), TIFR1(34);
+host_register EIMSK(40), EICRA(41), SREG(42);
+host_register16 UBRR0(50), OCR1A(51), OCR1B(52), ICR1(53), TCNT1(54);
+
+unsigned char spi_received = 0xFF;
+
+void host_port_write(const int number, const unsigned char before, const unsigned char after)
+{
+	int temp_base = (number == 1) ? 8 : 0;
+
+	for (int i=0; i<8; i++)
+	{
+		if (((before ^ after) >> i) & 0x01)
+		{
+			if (temp_base + i < 20) host_pin_change((unsigned char)(temp_base + i), (unsigned char)((after >> i) & 0x01));
+		}
+	}
+}
+
+void host_usart_send(const unsigned char value) // master SPI mode, XCK on pin 4, TXD on pin 1 jumpered to the CPLD
+{
+	host_cycles += 16 * ((unsigned long)UBRR0.value + 1);
+
+	for (int i=7; i>=0; i--)
+	{
+		cpld_clock((value >> i) & 0x01);
+	}
+}
+
+host_register::operator unsigned char()
+{
+	if (number == 5) // PIND
+	{
+		host_cycles += host_cost_port;
+
+		unsigned char temp_value = 0x00;
+
+		for (int i=0; i<8; i++) if (host_pin_read((unsigned char)i)) temp_value |= (unsigned char)(1 << i);
+
+		return temp_value;
+	}
+	else if (number == 2) // PINB
+	{
+		host_cycles += host_cost_port;
+
+		unsigned char temp_value = 0x00;
+
+		for (int i=0; i<6; i++) if (host_pin_read((unsigned char)(i+8))) temp_value |= (unsigned char)(1 << i);
+
+		return temp_value;
+	}
+	else if (number == 10) // UCSR0A, always ready to send
+	{
+		return (unsigned char)(value | (1 << UDRE0) | (1 << TXC0) | (serial_ready() ? (1 << RXC0) : 0));
+	}
+	else if (number == 13) // UDR0, the next byte from stdin
+	{
+		host_cycles += host_cost_port;
+
+		if (serial_pos >= serial_length) return 0x00;
+
+		return serial_buffer[serial_pos++];
+	}
+	else if (number == 21) // SPSR, always done
+	{
+		return (unsigned char)(value | (1 << SPIF));
+	}
+	else if (number == 22) // SPDR
+	{
+		return spi_received;
+	}
+
+	host_cycles += host_cost_port;
+
+	return value;
+}
+
+host_register &host_register::operator=(const unsigned char data)
+{
+	unsigned char before = value;
+
+	if (number == 13) // UDR0
+	{
+		if (UCSR0C.value & (1 << UMSEL01)) host_usart_send(data);
+		else if (!host_quiet && data != 0x0D) putchar(data); // the serial port is stdout
+
+		return *this;
+	}
+	else if (number == 22) // SPDR
+	{
+		host_cycles += 17; // 16 at the fastest clock, plus waiting for SPIF
+
+		if (SPSR.value & (1 << SPI2X)) {}
+		else host_cycles += 16;
+
+		spi_received = sd_exchange(data);
+
+		return *this;
+	}
+
+	host_cycles += host_cost_port;
+
+	value = data;
+
+	if (number == 1 || number == 4) host_port_write(number, before, value);
+	else if (number == 31 && (before & 0x07) == 0 && (value & 0x07) != 0) timer1_start(); // TCCR1B
+
+	return *this;
+}
+
+host_register &host_register::operator|=(const unsigned char data)
+{
+	unsigned char before = value;
+
+	host_cycles += host_cost_bit;
+
+	value |= data;
+
+	if (number == 1 || number == 4) host_port_write(number, before, value);
+
+	return *this;
+}
+
+host_register &host_register::operator&=(const unsigned char data)
+{
+	unsigned char before = value;
+
+	host_cycles += host_cost_bit;
+
+	value &= data;
+
+	if (number == 1 || number == 4) host_port_write(number, before, value);
+
+	return *this;
+}
+
+host_register &host_register::operator^=(const unsigned char data)
+{
+	unsigned char before = value;
+
+	host_cycles += host_cost_bit;
+
+	value ^= data;
+
+	if (number == 1 || number == 4) host_port_write(number, before, value);
+
+	return *this;
+}
+
+host_register16::operator unsigned int()
+{
+	host_cycles += 2 * host_cost_port;
+
+	return value;
+}
+
+host_register16 &host_register16::operator=(const unsigned int data)
+{
+	host_cycles += 2 * host_cost_port;
+
+	value = data & 0xFFFF;
+
+	return *this;
+}
+
+
+// time
+
+void delay(unsigned long value)
+{
+	host_cycles += 16000 * (unsigned long long)value;
+
+	timer1_tick(); // so a sketch waiting on the interrupt sees it run
+
+	if (host_cycles_limit && host_cycles >= host_cycles_limit) host_finish();
+}
+
+void delayMicroseconds(unsigned int value)
+{
+	host_cycles += 16 * (unsigned long long)value;
+}
+
+void __builtin_avr_delay_cycles(unsigned long value)
+{
+	host_cycles += value;
+}
+
+unsigned long millis()
+{
+	return (unsigned long)(host_cycles / 16000);
+}
+
+unsigned long micros()
+{
+	return (unsigned long)(host_cycles / 16);
+}
+
+long random(long value)
+{
+	if (value <= 0) return 0;
+
+	return (long)(rand() % value);
+}
+
+long random(long low, long high)
+{
+	if (high <= low) return low;
+
+	return low + (long)(rand() % (high - low));
+}
+
+void randomSeed(unsigned long value)
+{
+	srand((unsigned int)value);
+}
+
+void interrupts() {}
+void noInterrupts() {}
+
+int digitalPinToInterrupt(unsigned char pin)
+{
+	return (pin == 2) ? 0 : ((pin == 3) ? 1 : -1);
+}
+
+void attachInterrupt(int number, void (*function)(void), int mode)
+{
+	if (number == 0) host_interrupt = function;
+}
+
+void detachInterrupt(int number)
+{
+	if (number == 0) host_interrupt = NULL;
+}
+
+
+// 6502 memory, either through the sketch as usual or flat for running test programs
+
+unsigned char *host_flat = NULL;
+unsigned long host_accesses = 0; // calls made by the sketch, the AVR's own work when few reach the CPLD
+
+unsigned char x6502_read(unsigned char BL, unsigned char BH)
+{
+	host_accesses++;
+
+	if (host_flat) return host_flat[BH*256+BL];
+	else return x6502_read_shield(BL, BH);
+}
+
+void x6502_write(unsigned char BL, unsigned char BH, unsigned char BD)
+{
+	host_accesses++;
+
+	if (host_flat) host_flat[BH*256+BL] = BD;
+	else x6502_write_shield(BL, BH, BD);
+}
+
+void host_6502(const char *name, const unsigned int start, const long trap) // runs until an instruction jumps to itself
+{
+	if (x6502_instruction == NULL)
+	{
+		printf("ArduinoHost: this sketch has no 6502\n");
+		fflush(stdout);
+		_exit(1);
+	}
+
+	host_flat = (unsigned char *)calloc(65536, 1);
+
+	FILE *temp_file = fopen(name, "rb");
+
+	if (!temp_file)
+	{
+		printf("ArduinoHost: cannot open %s\n", name);
+		fflush(stdout);
+		_exit(1);
+	}
+
+	if (fread(host_flat, 1, 65536, temp_file) == 0) {}
+	fclose(temp_file);
+
+	x6502_reset();
+
+	x6502_L = (unsigned char)(start & 0xFF);
+	x6502_H = (unsigned char)(start >> 8);
+
+	unsigned int temp_last = 0x10000;
+	unsigned int temp_pc = start;
+
+	while (temp_pc != temp_last)
+	{
+		temp_last = temp_pc;
+
+		if (!x6502_instruction())
+		{
+			printf("stopped by BRK, STP, or WAI at $%04X\n", temp_last);
+			break;
+		}
+
+		temp_pc = (unsigned int)(x6502_H*256+x6502_L);
+	}
+
+	printf("trapped at $%04X after %lu instructions\n", temp_pc, &x6502_count ? x6502_count : 0);
+
+	if (trap >= 0) // Klaus Dormann's functional tests keep the number of the test running at $0200
+	{
+		if (temp_pc == (unsigned int)trap) printf("functional test passed\n");
+		else printf("functional test failed in test $%02X\n", host_flat[0x0200]);
+
+		fflush(stdout);
+
+		_exit(temp_pc == (unsigned int)trap ? 0 : 1);
+	}
+
+	fflush(stdout);
+
+	_exit(0);
+}
+
+
+// results
+
+unsigned long host_ticks = 0;
+int host_idle_ticks = 0;
+
+void host_screen(char *buffer, int &length) // what the VGA output shows, without inverse video
+{
+	for (int row=0; row<30; row++)
+	{
+		int temp_end = 0;
+
+		for (int column=0; column<64; column++)
+		{
+			unsigned char temp_char = cpld_ram[(row*64+column) % host_ram_size] & 0x7F;
+
+			if (temp_char < 0x20 || temp_char == 0x7F) temp_char = ' ';
+
+			buffer[length+column] = (char)temp_char;
+
+			if (temp_char != ' ') temp_end = column + 1;
+		}
+
+		length += temp_end;
+		buffer[length++] = '\n';
+	}
+}
+
+void host_finish()
+{
+	char buffer[4096];
+	int length = 0;
+
+	const char *line = "\n---- screen ----\n";
+
+	memcpy(buffer, line, strlen(line));
+	length += (int)strlen(line);
+
+	host_screen(buffer, length);
+
+	length += snprintf(buffer+length, 4096-length, 
+		"---- cycles %llu, packets %lu, reads %lu, writes %lu, serial clocks %lu, CPLD timing errors %lu, SD commands %lu, SD reads %lu, SD writes %lu, EEPROM writes %lu, 6502 memory accesses %lu, audio periods %lu ----\n",
+		host_cycles, cpld_packets, cpld_reads, cpld_writes, cpld_clocks, cpld_violations, sd_commands, sd_reads, sd_writes, eeprom_writes, host_accesses, timer1_periods);
+
+	if (write(2, buffer, length) < 0) {}
+
+	if (host_dump_name)
+	{
+		FILE *temp_file = fopen(host_dump_name, "wb");
+
+		if (temp_file)
+		{
+			fwrite(cpld_ram, 1, host_ram_size, temp_file);
+			fclose(temp_file);
+		}
+	}
+
+	eeprom_store();
+
+	if (sd_file) fflush(sd_file);
+
+	if (wav_file)
+	{
+		wav_header();
+		fclose(wav_file);
+	}
+
+	_exit(cpld_violations ? 1 : 0);
+}
+
+void host_stop(int number) // Ctrl-C
+{
+	host_finish();
+}
+
+void host_divide(int number) // the AVR carries on after dividing by zero, this cannot
+{
+	const char *text = "\n---- divided by zero ----\n";
+
+	if (write(2, text, strlen(text)) < 0) {}
+
+	host_finish();
+}
+
+unsigned long host_screen_sum = 0;
+
+void host_tick(int number) // every millisecond of real time
+{
+	ps2_tick();
+
+	serial_tick();
+
+	timer1_tick();
+
+	host_ticks++;
+
+	if (ps2_pos >= ps2_length && serial_pos >= serial_length && !host_cycles_limit && (host_ticks % 100) == 0)
+	{
+		unsigned long temp_sum = 0;
+
+		for (int i=0; i<2048; i++) temp_sum = temp_sum * 31 + (cpld_ram[i] & 0x7F); // without the cursor
+
+		if (temp_sum == host_screen_sum) host_idle_ticks++; // nothing new on screen
+		else host_idle_ticks = 0;
+
+		host_screen_sum = temp_sum;
+
+		if (host_idle_ticks >= 20) host_finish(); // for two seconds
+	}
+}
+
+void host_benchmark()
+{
+	display_initialize();
+
+	unsigned long long temp_start = host_cycles;
+
+	for (int i=0; i<4096; i++)
+	{
+		display_sendpacket((unsigned char)((i/256)&0x3F), (unsigned char)(i%256), (unsigned char)(i*7));
+	}
+
+	unsigned long long temp_write = host_cycles - temp_start;
+
+	temp_start = host_cycles;
+
+	int temp_errors = 0;
+
+	for (int i=0; i<4096; i++)
+	{
+		if (display_receivepacket((unsigned char)((i/256)&0x3F), (unsigned char)(i%256)) != (unsigned char)(i*7)) temp_errors++;
+	}
+
+	unsigned long long temp_read = host_cycles - temp_start;
+
+	printf("display_sendpacket: %llu cycles each\n", temp_write / 4096);
+	printf("display_receivepacket: %llu cycles each\n", temp_read / 4096);
+	printf("wrong bytes read back: %d, CPLD timing errors: %lu\n", temp_errors, cpld_violations);
+
+	fflush(stdout);
+
+	_exit((temp_errors || cpld_violations) ? 1 : 0);
+}
+
+int main(const int argc, const char **argv)
+{
+	const char *sd_name = NULL;
+	const char *flat_name = NULL;
+	unsigned int flat_start = 0x0400;
+	long flat_trap = -1;
+
+	for (int i=1; i<argc; i++)
+	{
+		if (strcmp(argv[i], "-bench") == 0) host_bench = 1;
+		else if (strcmp(argv[i], "-quiet") == 0) host_quiet = 1;
+		else if (strcmp(argv[i], "-sdhc") == 0) sd_sdhc = 1;
+		else if (strcmp(argv[i], "-8k") == 0) host_ram_size = 8192;
+		else if (strcmp(argv[i], "-stdin") == 0) serial_enabled = 1;
+		else if (strcmp(argv[i], "-sd") == 0 && i+1 < argc) sd_name = argv[++i];
+		else if (strcmp(argv[i], "-eeprom") == 0 && i+1 < argc) eeprom_name = argv[++i];
+		else if (strcmp(argv[i], "-dump") == 0 && i+1 < argc) host_dump_name = argv[++i];
+		else if (strcmp(argv[i], "-wav") == 0 && i+1 < argc) wav_file = fopen(argv[++i], "w+b");
+		else if (strcmp(argv[i], "-keys") == 0 && i+1 < argc) ps2_type(argv[++i]);
+		else if (strcmp(argv[i], "-cycles") == 0 && i+1 < argc) host_cycles_limit = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "-6502") == 0 && i+2 < argc) { flat_name = argv[i+1]; flat_start = (unsigned int)strtoul(argv[i+2], NULL, 16); i += 2; }
+		else if (strcmp(argv[i], "-trap") == 0 && i+1 < argc) flat_trap = strtol(argv[++i], NULL, 16);
+		else
+		{
+			printf("Runs an ArduinoShield sketch on a Linux PC, built with ArduinoHost.sh\n");
+			printf("Arguments:\n");
+			printf("  -keys \"text\"     typed on the PS/2 keyboard, \\n is Enter, \\e is Escape, \\p is a pause, \\\\ is \\\n");
+			printf("  -stdin           stdin goes to the serial port, one line at a time\n");
+			printf("  -sd <file>       SD card image, created if needed\n");
+			printf("  -sdhc            SD card is block addressed\n");
+			printf("  -eeprom <file>   EEPROM contents, created if needed\n");
+			printf("  -8k              only 8KB of RAM on the shield\n");
+			printf("  -cycles <n>      stop after this many AVR cycles\n");
+			printf("  -wav <file>      pin 9 while Timer1 runs, as 8-bit samples at 15625 Hz\n");
+			printf("  -bench           time packets to and from the CPLD, then stop\n");
+			printf("  -6502 <file> <start>   load 64KB at $0000 and run the 6502 from the hex start address until\n");
+			printf("                   an instruction jumps to itself, build with x6502_brk_vector=true for BRK\n");
+			printf("  -trap <address>  with -6502, pass only when it traps at this hex address, otherwise fail\n");
+			printf("                   with the test number at $0200 and exit status 1\n");
+			printf("  -quiet           no serial output\n");
+			printf("When all input has been used and the screen stops changing, the screen and the counts are printed on stderr.\n");
+
+			return 0;
+		}
+	}
+
+	if (sd_name)
+	{
+		sd_file = fopen(sd_name, "r+b");
+		if (!sd_file) sd_file = fopen(sd_name, "w+b");
+	}
+
+	if (eeprom_name)
+	{
+		FILE *temp_file = fopen(eeprom_name, "rb");
+
+		if (temp_file)
+		{
+			if (fread(eeprom_memory, 1, 1024, temp_file) < 1024) {}
+			fclose(temp_file);
+		}
+		else memset(eeprom_memory, 0xFF, 1024);
+	}
+
+	if (wav_file) wav_header();
+
+	if (serial_enabled)
+	{
+		serial_length = (int)fread(serial_buffer, 1, 65536, stdin);
+	}
+
+	for (int i=0; i<20; i++) host_pin_level[i] = LOW;
+
+	host_pin_level[2] = HIGH; // keyboard clock and data idle high
+	host_pin_level[3] = HIGH;
+
+	srand(1);
+
+	setvbuf(stdout, NULL, _IONBF, 0); // serial output as the sketch sends it
+
+	if (host_bench) host_benchmark();
+
+	if (flat_name) host_6502(flat_name, flat_start, flat_trap);
+
+	struct sigaction temp_action;
+	memset(&temp_action, 0, sizeof(temp_action));
+	temp_action.sa_handler = host_tick;
+	sigaction(SIGALRM, &temp_action, NULL);
+
+	temp_action.sa_handler = host_stop;
+	sigaction(SIGINT, &temp_action, NULL);
+	sigaction(SIGTERM, &temp_action, NULL);
+
+	temp_action.sa_handler = host_divide;
+	sigaction(SIGFPE, &temp_action, NULL);
+
+	struct itimerval temp_timer;
+	temp_timer.it_interval.tv_sec = 0;
+	temp_timer.it_interval.tv_usec = 1000;
+	temp_timer.it_value = temp_timer.it_interval;
+	setitimer(ITIMER_REAL, &temp_timer, NULL);
+
+	setup();
+
+	while (true)
+	{
+		loop();
+	}
+
+	return 0;
+}
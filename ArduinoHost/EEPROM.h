@@ -0,0 +1,21 @@
+// EEPROM.h
+
+// Stand-in for the Arduino EEPROM library, kept in a file when running on a Linux PC.
+
+#ifndef EEPROM_HOST_H
+#define EEPROM_HOST_H
+
+class host_eeprom
+{
+public:
+	unsigned char read(int address);
+	void write(int address, unsigned char value); // 3.3 ms each
+	void update(int address, unsigned char value); // only writes when different
+	int length() { return 1024; }
+};
+
+extern host_eeprom EEPROM;
+
+void eeprom_read_block(void *dst, const void *src, unsigned int n); // from <avr/eeprom.h>, 'src' is the EEPROM address
+
+#endif
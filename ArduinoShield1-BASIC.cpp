@@ -26,15 +26,47 @@ unsigned char screen_memory[960]; // used for 40x24 and 64x15 fast vertical scro
 const bool serial_debug = false; // change to stop error messages
 const bool serial_output = true; // change to stop serial output
 const bool serial_input = true; // change to stop serial input
-unsigned char serial_last = 0x00;
+volatile unsigned char serial_line = 0x00; // 0x01 while a line comes in, 0x02 just after a carriage return
+volatile unsigned char serial_time = 0x00; // low byte of millis() when the last byte came in
+const unsigned char serial_idle = 20; // milliseconds without a byte that end a line too, for no line ending
+const unsigned int serial_rate = 103; // UBRR0 for 9600 baud, 16 MHz / 16 / 9600 - 1
 
-int display_width = 40; // 40 or 64
-int display_height = 24; // 24 or 15
-int display_left = 12; // 12 or 0
-int display_top = 1; // 1 or 5
+// The USART registers are used directly instead of the Serial library,
+// whose two 64 byte buffers left too little SRAM for the stack.
+// Bytes received go straight into keyboard_buffer from USART_RX_vect,
+// bytes sent wait for the one before, as each is followed by delay(1) anyway.
+
+void serial_begin()
+{
+	UBRR0 = serial_rate;
+	UCSR0A = 0x00;
+	UCSR0C = (unsigned char)((1 << UCSZ01) | (1 << UCSZ00)); // 8 data bits, no parity, 1 stop bit
+	UCSR0B = (unsigned char)((serial_input ? ((1 << RXEN0) | (1 << RXCIE0)) : 0x00) | (serial_output ? (1 << TXEN0) : 0x00));
+};
+
+void serial_write(const unsigned char value)
+{
+	while ((UCSR0A & (1 << UDRE0)) == 0x00) { }
+
+	UDR0 = value;
+};
+
+void serial_newline()
+{
+	serial_write(0x0D);
+	serial_write(0x0A);
+};
+
+unsigned char display_width = 40; // 40 or 64
+unsigned char display_height = 24; // 24 or 15
+unsigned char display_left = 12; // 12 or 0
+unsigned char display_top = 1; // 1 or 5
 
 const bool display_check = false; // double checks reads and writes
 const int display_delay = 1; // microseconds
+const int display_transport = 1; // 0 = digitalWrite(), 1 = direct port registers, 2 = USART as SPI master
+const unsigned char display_settle = 16; // cycles at 16 MHz, CPLD needs 16 master clocks per access
+const unsigned char display_baud = 1; // USART clock is 16 MHz / (2 * (display_baud + 1)), so 4 MHz
 
 const int display_input_clock = 6;
 const int display_input_data = 7;
@@ -42,25 +74,127 @@ const int display_input_data = 7;
 const int display_output_clock = 4;
 const int display_output_data = 5;
 
+// Transport 2 uses the ATmega328's USART in master SPI mode.
+// XCK is already pin 4, but TXD is pin 1, so the CPLD serial_data line
+// must be jumpered from pin 5 to pin 1, and both serial_output and serial_input
+// must be false because the USART is no longer available to serial_begin().
+// The SPI block is not used here, pins 11 to 13 belong to the SD card.
+// Received bytes still come through pins 6 and 7 on the port registers.
+const int display_usart_data = 1;
+
 //const int display_ram_bank = 8; // not used anymore
 //int display_ram_bank_value = 0;
 
+// pins 4 through 7 are PD4 through PD7, so the port registers can be used directly,
+// single bit changes compile down to 'sbi' and 'cbi' and are safe from the keyboard interrupt
+
 void display_toggleinput()
 {
-	digitalWrite(display_input_clock, HIGH);
-	digitalWrite(display_input_clock, LOW);
+	if (display_transport >= 1)
+	{
+		PORTD |= (unsigned char)(1 << display_input_clock);
+		PORTD &= (unsigned char)~(1 << display_input_clock);
+	}
+	else
+	{
+		digitalWrite(display_input_clock, HIGH);
+		digitalWrite(display_input_clock, LOW);
+	}
+};
+
+void display_usartsend(const unsigned char value)
+{
+	while ((UCSR0A & (1 << UDRE0)) == 0x00) {}
+
+	UDR0 = value;
+
+	UCSR0A = (unsigned char)(1 << TXC0); // cleared by writing a one, after the buffer is full again
 };
 
 void display_toggleoutput()
 {
-	digitalWrite(display_output_clock, HIGH);
-	digitalWrite(display_output_clock, LOW);
+	if (display_transport == 2)
+	{
+		display_usartsend(0x00); // first clock clears the shift register, the other seven shift in zeros
+	}
+	else if (display_transport == 1)
+	{
+		PORTD |= (unsigned char)(1 << display_output_clock);
+		PORTD &= (unsigned char)~(1 << display_output_clock);
+	}
+	else
+	{
+		digitalWrite(display_output_clock, HIGH);
+		digitalWrite(display_output_clock, LOW);
+	}
+};
+
+void display_wait()
+{
+	if (display_transport == 2)
+	{
+		while ((UCSR0A & (1 << TXC0)) == 0x00) {} // last bit has left the USART
+
+		__builtin_avr_delay_cycles(display_settle);
+	}
+	else if (display_transport == 1)
+	{
+		__builtin_avr_delay_cycles(display_settle); // gives the CPLD time to do the access
+	}
+	else
+	{
+		delayMicroseconds(display_delay); // just in case
+	}
+};
+
+inline unsigned char display_portreceive(const unsigned char value, const unsigned char mask)
+{
+	unsigned char temp_value = value;
+
+	if (PIND & (unsigned char)(1 << display_input_data))
+	{
+		temp_value |= mask;
+	}
+
+	PORTD |= (unsigned char)(1 << display_input_clock);
+	PORTD &= (unsigned char)~(1 << display_input_clock);
+
+	return temp_value;
+};
+
+inline void display_portsend(const unsigned char value, const unsigned char mask)
+{
+	if (value & mask)
+	{
+		PORTD |= (unsigned char)(1 << display_output_data);
+	}
+	else
+	{
+		PORTD &= (unsigned char)~(1 << display_output_data);
+	}
+
+	PORTD |= (unsigned char)(1 << display_output_clock);
+	PORTD &= (unsigned char)~(1 << display_output_clock);
 };
 
 unsigned char display_receivebyte()
 {
 	unsigned char temp_value = 0x00;
 
+	if (display_transport >= 1) // unrolled
+	{
+		temp_value = display_portreceive(temp_value, 0x80);
+		temp_value = display_portreceive(temp_value, 0x40);
+		temp_value = display_portreceive(temp_value, 0x20);
+		temp_value = display_portreceive(temp_value, 0x10);
+		temp_value = display_portreceive(temp_value, 0x08);
+		temp_value = display_portreceive(temp_value, 0x04);
+		temp_value = display_portreceive(temp_value, 0x02);
+		temp_value = display_portreceive(temp_value, 0x01);
+
+		return temp_value;
+	}
+
 	for (int i=0; i<8; i++)
 	{
 		temp_value = temp_value << 1;
@@ -80,6 +214,26 @@ void display_sendbyte(const unsigned char value)
 {
 	unsigned char temp_value = value;
 
+	if (display_transport == 2)
+	{
+		display_usartsend(temp_value);
+
+		return;
+	}
+	else if (display_transport == 1) // unrolled
+	{
+		display_portsend(temp_value, 0x80);
+		display_portsend(temp_value, 0x40);
+		display_portsend(temp_value, 0x20);
+		display_portsend(temp_value, 0x10);
+		display_portsend(temp_value, 0x08);
+		display_portsend(temp_value, 0x04);
+		display_portsend(temp_value, 0x02);
+		display_portsend(temp_value, 0x01);
+
+		return;
+	}
+
 	for (int i=0; i<8; i++)
 	{
 		if (temp_value >= 0x80)
@@ -104,7 +258,7 @@ unsigned char display_receivepacket(const unsigned char high, const unsigned cha
 		display_sendbyte((unsigned char)((high&0x3F)+0x80));
 		display_sendbyte((unsigned char)(low));
 		display_sendbyte((unsigned char)(0x00));
-		delayMicroseconds(display_delay); // just in case
+		display_wait();
 		display_toggleoutput();
 
 		unsigned char temp_check[2];
@@ -118,7 +272,7 @@ unsigned char display_receivepacket(const unsigned char high, const unsigned cha
 			display_sendbyte((unsigned char)((high&0x3F)+0x80));
 			display_sendbyte((unsigned char)(low));
 			display_sendbyte((unsigned char)(0x00));
-			delayMicroseconds(display_delay); // just in case
+			display_wait();
 			display_toggleoutput();
 	
 			temp_check[1] = temp_check[0];
@@ -131,41 +285,41 @@ unsigned char display_receivepacket(const unsigned char high, const unsigned cha
 				{
 					unsigned char temp_binary;
 	
-					Serial.println("");
+					serial_newline();
 	
-					Serial.print('R');
-					Serial.print(' ');
+					serial_write('R');
+					serial_write(' ');
 					
 					temp_binary = temp_check[0];
 	
 					for (int i=0; i<8; i++)
 					{
-						if (temp_binary >= 0x80) Serial.print('1');
-						else Serial.print('0');
+						if (temp_binary >= 0x80) serial_write('1');
+						else serial_write('0');
 					
 						temp_binary = temp_binary << 1;
 		
-						if (i == 3) Serial.print(' ');
+						if (i == 3) serial_write(' ');
 					}
 					
-					Serial.println("");
+					serial_newline();
 	
-					Serial.print(' ');
-					Serial.print(' ');
+					serial_write(' ');
+					serial_write(' ');
 	
 					temp_binary = temp_check[1];
 	
 					for (int i=0; i<8; i++)
 					{
-						if (temp_binary >= 0x80) Serial.print('1');
-						else Serial.print('0');
+						if (temp_binary >= 0x80) serial_write('1');
+						else serial_write('0');
 					
 						temp_binary = temp_binary << 1;
 	
-						if (i == 3) Serial.print(' ');
+						if (i == 3) serial_write(' ');
 					}
 	
-					Serial.println("");
+					serial_newline();
 				}
 			}
 		} 
@@ -178,8 +332,8 @@ unsigned char display_receivepacket(const unsigned char high, const unsigned cha
 		display_sendbyte((unsigned char)((high&0x3F)+0x80));
 		display_sendbyte((unsigned char)(low));
 		display_sendbyte((unsigned char)(0x00));
-		delayMicroseconds(display_delay); // just in case
-		display_toggleoutput();	
+		display_wait();
+		display_toggleoutput();
 	
 		return display_receivebyte();
 	}
@@ -196,7 +350,7 @@ void display_sendpacket(const unsigned char high, const unsigned char low, const
 			display_sendbyte((unsigned char)((high&0x3F)+0xC0));
 			display_sendbyte((unsigned char)(low));
 			display_sendbyte((unsigned char)(value));
-			delayMicroseconds(display_delay); // just in case
+			display_wait();
 			display_toggleoutput();
 	
 			if ((unsigned char)(high&0x08) == 0x08)
@@ -204,7 +358,7 @@ void display_sendpacket(const unsigned char high, const unsigned char low, const
 				display_sendbyte((unsigned char)((high&0x3F)+0x80));
 				display_sendbyte((unsigned char)(low));
 				display_sendbyte((unsigned char)(value));
-				delayMicroseconds(display_delay); // just in case
+				display_wait();
 				display_toggleoutput();
 	
 				temp_check = display_receivebyte();
@@ -220,41 +374,41 @@ void display_sendpacket(const unsigned char high, const unsigned char low, const
 				{
 					unsigned char temp_binary;
 	
-					Serial.println("");
+					serial_newline();
 	
-					Serial.print('W');
-					Serial.print(' ');
+					serial_write('W');
+					serial_write(' ');
 					
 					temp_binary = temp_check;
 	
 					for (int i=0; i<8; i++)
 					{
-						if (temp_binary >= 0x80) Serial.print('1');
-						else Serial.print('0');
+						if (temp_binary >= 0x80) serial_write('1');
+						else serial_write('0');
 					
 						temp_binary = temp_binary << 1;
 		
-						if (i == 3) Serial.print(' ');
+						if (i == 3) serial_write(' ');
 					}
 					
-					Serial.println("");
+					serial_newline();
 	
-					Serial.print(' ');
-					Serial.print(' ');
+					serial_write(' ');
+					serial_write(' ');
 	
 					temp_binary = value;
 	
 					for (int i=0; i<8; i++)
 					{
-						if (temp_binary >= 0x80) Serial.print('1');
-						else Serial.print('0');
+						if (temp_binary >= 0x80) serial_write('1');
+						else serial_write('0');
 					
 						temp_binary = temp_binary << 1;
 	
-						if (i == 3) Serial.print(' ');
+						if (i == 3) serial_write(' ');
 					}
 	
-					Serial.println("");
+					serial_newline();
 				}
 			}
 		}
@@ -265,11 +419,74 @@ void display_sendpacket(const unsigned char high, const unsigned char low, const
 		display_sendbyte((unsigned char)((high&0x3F)+0xC0));
 		display_sendbyte((unsigned char)(low));
 		display_sendbyte((unsigned char)(value));
-		delayMicroseconds(display_delay); // just in case
+		display_wait();
 		display_toggleoutput();
 	}
 };
 
+void display_sendblock(const unsigned char high, const unsigned char low, const unsigned char *buf, const unsigned int len) // consecutive addresses, one packet each
+{
+	unsigned int temp_addr = (unsigned int)((high&0x3F)*256+low);
+
+	for (unsigned int i=0; i<len; i++)
+	{
+		display_sendpacket((unsigned char)((temp_addr&0x3F00)>>8), (unsigned char)(temp_addr&0x00FF), buf[i]);
+
+		temp_addr++;
+	}
+};
+
+void display_receiveblock(const unsigned char high, const unsigned char low, unsigned char *buf, const unsigned int len) // consecutive addresses, one packet each
+{
+	unsigned int temp_addr = (unsigned int)((high&0x3F)*256+low);
+
+	for (unsigned int i=0; i<len; i++)
+	{
+		buf[i] = display_receivepacket((unsigned char)((temp_addr&0x3F00)>>8), (unsigned char)(temp_addr&0x00FF));
+
+		temp_addr++;
+	}
+};
+
+void display_fill(const unsigned char high, const unsigned char low, const unsigned char value, const unsigned int len) // consecutive addresses, one packet each
+{
+	unsigned int temp_addr = (unsigned int)((high&0x3F)*256+low);
+
+	for (unsigned int i=0; i<len; i++)
+	{
+		display_sendpacket((unsigned char)((temp_addr&0x3F00)>>8), (unsigned char)(temp_addr&0x00FF), value);
+
+		temp_addr++;
+	}
+};
+
+void display_copy(const unsigned int from, const unsigned int to, const unsigned int len) // overlapping is fine, through a small buffer
+{
+	unsigned char temp_buffer[32];
+	unsigned int temp_size;
+	unsigned int temp_done = 0;
+
+	while (temp_done < len)
+	{
+		temp_size = len - temp_done;
+
+		if (temp_size > 32) temp_size = 32;
+
+		if (to > from) // moving up, so from the end down
+		{
+			display_receiveblock((unsigned char)(((from+len-temp_done-temp_size)&0x3F00)>>8), (unsigned char)((from+len-temp_done-temp_size)&0x00FF), temp_buffer, temp_size);
+			display_sendblock((unsigned char)(((to+len-temp_done-temp_size)&0x3F00)>>8), (unsigned char)((to+len-temp_done-temp_size)&0x00FF), temp_buffer, temp_size);
+		}
+		else
+		{
+			display_receiveblock((unsigned char)(((from+temp_done)&0x3F00)>>8), (unsigned char)((from+temp_done)&0x00FF), temp_buffer, temp_size);
+			display_sendblock((unsigned char)(((to+temp_done)&0x3F00)>>8), (unsigned char)((to+temp_done)&0x00FF), temp_buffer, temp_size);
+		}
+
+		temp_done += temp_size;
+	}
+};
+
 unsigned char display_receivecharacter(const unsigned char row, const unsigned char column)
 {
 	unsigned char low = (unsigned char)((unsigned char)(column & 0x3F) + (unsigned char)((row & 0x03) << 6));
@@ -299,18 +516,30 @@ void display_initialize()
 
 	digitalWrite(display_input_clock, LOW);
 
+	if (display_transport == 2)
+	{
+		pinMode(display_output_data, INPUT); // jumpered to pin 1 instead
+
+		UBRR0 = 0x0000; // must be zero while enabling
+		UCSR0C = (unsigned char)((1 << UMSEL01) | (1 << UMSEL00)); // master SPI, MSB first, sample on rising edge
+		UCSR0B = (unsigned char)(1 << TXEN0); // transmit only
+		UBRR0 = (unsigned int)display_baud;
+	}
+
 	for (int i=0; i<32; i++)
 	{
 		display_toggleoutput(); // clears shift register
 	}
+
+	if (display_transport == 2)
+	{
+		display_wait();
+	}
 };
 
 void display_clearmemory()
 {	
-	for (int i=0; i<16384; i++)
-	{
-		display_sendpacket((unsigned char)(i/256), (unsigned char)(i%256), 0x00);
-	}
+	display_fill(0x00, 0x00, 0x00, 16384);
 };
 
 
@@ -336,7 +565,7 @@ void string_print(int Y, int X, const char *A)
 
 			if (serial_output)
 			{
-				Serial.print((char)A[i]);
+				serial_write((unsigned char)A[i]);
 				delay(1);
 			}
 		}
@@ -344,7 +573,7 @@ void string_print(int Y, int X, const char *A)
 
 	if (serial_output)
 	{
-		Serial.println("");
+		serial_newline();
 		delay(1);
 	}
 };
@@ -353,16 +582,22 @@ void string_print(int Y, int X, const char *A)
 const int keyboard_clock = 2;
 const int keyboard_data = 3;
 
-volatile unsigned char keyboard_bit = 0x00;
+const unsigned char keyboard_size = 16; // characters waiting, a power of two
+const unsigned int keyboard_timeout = 2000; // microseconds between clocks before a frame starts over
+
 volatile unsigned char keyboard_byte = 0x00;
-volatile unsigned char keyboard_counter = 0x00;
-volatile unsigned char keyboard_buffer[16];
-volatile unsigned char keyboard_read_pos = 0x00;
-volatile unsigned char keyboard_write_pos = 0x00;
-unsigned char keyboard_extended = 0x00;
-unsigned char keyboard_release = 0x00;
-unsigned char keyboard_shift = 0x00;
-unsigned char keyboard_capslock = 0x00;
+volatile unsigned char keyboard_counter = 0x00; // bit of the frame expected next, the start bit is zero, the stop bit 0x0A or 0x0B after a wrong parity
+volatile unsigned int keyboard_time = 0x0000; // low half of micros() at the last clock
+volatile unsigned char keyboard_buffer[keyboard_size];
+volatile unsigned char keyboard_read_pos = 0x00; // only changed by keyboard_character()
+volatile unsigned char keyboard_write_pos = 0x00; // only changed by keyboard_push()
+volatile unsigned char keyboard_overflow = 0x00; // characters dropped while the buffer was full, beeped and cleared by keyboard_character()
+volatile unsigned char keyboard_stop = 0x00; // 0x01 once a break key comes in, until the next command clears it
+unsigned char keyboard_state = 0x00; // these bits only change in keyboard_decode()
+const unsigned char keyboard_extended = 0x01;
+const unsigned char keyboard_release = 0x02;
+const unsigned char keyboard_shift = 0x04;
+const unsigned char keyboard_capslock = 0x08;
 unsigned char keyboard_mode = 0x00;
 unsigned char keyboard_serial = 0x00;
 
@@ -370,6 +605,13 @@ unsigned char keyboard_pos_x = 0x00;
 unsigned char keyboard_pos_y = 0x00;
 unsigned char keyboard_invert = 0x80; // 0x00 or 0x80
 
+unsigned char keyboard_dirty_y = 0xFF; // row of the text area printed to but not sent yet, 0xFF when none
+unsigned char keyboard_dirty_first = 0x00; // columns from here
+unsigned char keyboard_dirty_last = 0x00; // to here
+unsigned char keyboard_cursor = 0x00; // 0x01 when the cursor is not drawn yet
+unsigned char keyboard_pending = 0x00; // low byte of millis() when something first waited
+const unsigned char keyboard_latency = 20; // milliseconds before keyboard_character() sends it anyway
+
 const unsigned char keyboard_text[128] PROGMEM = 
 "\\ for Editor, and to Break. Commands:\nHELP, QUIT, CLEAR, ALIGN, INVERT,\nLOAD, SAVE, NEW, DIR, RUN, and MON\" \" _";
 
@@ -409,54 +651,152 @@ const unsigned char keyboard_conversion[256] PROGMEM = {
 	 0x19,0x2B,0x04,0x2D,0x2A,0x01,0x00,0x00
 };
 
-void keyboard_interrupt()
+unsigned char keyboard_under() // character under the cursor, the menu below the text area is not kept
 {
-	keyboard_bit = digitalRead(keyboard_data);
-	
-	keyboard_byte = keyboard_byte >> 1;
+	if (keyboard_pos_y >= display_top && keyboard_pos_y < display_top+display_height)
+	{
+		return screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left];
+	}
 
-	if (keyboard_bit == HIGH) keyboard_byte += 0x80;
+	return 0x00;
+};
+
+void keyboard_push(unsigned char value) // from keyboard_interrupt(), or with interrupts off
+{
+	unsigned char temp_next = (unsigned char)((keyboard_write_pos + 1) & (keyboard_size - 1));
+
+	if (value == '\\' || value == '|' || value == 0x1B) keyboard_stop = 0x01; // seen at once, even behind other keys
+
+	if (temp_next != keyboard_read_pos)
+	{
+		keyboard_buffer[keyboard_write_pos] = value;
+		keyboard_write_pos = temp_next;
+	}
+	else if (keyboard_overflow < 0xFF) keyboard_overflow++;
+};
 
-	keyboard_counter++;
+void keyboard_decode(unsigned char code) // from keyboard_interrupt(), so only whole characters go into the buffer
+{
+	unsigned char temp_second = 0x00;
 
-	if (keyboard_counter == 0x09)
+	if (code == 0xF0) // release
 	{
-		keyboard_buffer[keyboard_write_pos] = keyboard_byte;
-		keyboard_write_pos++;
-		if (keyboard_write_pos >= 0x10) keyboard_write_pos = 0x00;
+		keyboard_state |= keyboard_release;
 	}
-	else if (keyboard_counter == 0x0B)
+	else if (code == 0xE0) // extended
 	{
-		keyboard_counter = 0x00;
+		keyboard_state |= keyboard_extended;
+	}
+	else
+	{
+		if (keyboard_state & keyboard_release)
+		{
+			if (code == 0x12 || code == 0x59) keyboard_state &= (unsigned char)(~keyboard_shift);
+		}
+		else
+		{
+			if (code == 0x58) keyboard_state ^= keyboard_capslock;
+			else if (code == 0x12 || code == 0x59) keyboard_state |= keyboard_shift;
+
+			if (keyboard_state & keyboard_capslock) code += 0x80;
+
+			if (keyboard_state & keyboard_shift) code += 0x80;
+
+			if (keyboard_state & keyboard_extended)
+			{
+				if (code == 0x4A || code == 0xCA) code += 0x80; // numpad slash
+				
+				temp_second = (unsigned char)pgm_read_byte_near(keyboard_conversion + (unsigned char)(code+0x80));
+			}
+			else
+			{
+				temp_second = (unsigned char)pgm_read_byte_near(keyboard_conversion + (unsigned char)(code+0x00));
+			}
+		}
+
+		keyboard_state &= (unsigned char)(~(keyboard_release | keyboard_extended));
+	}
+
+	if (temp_second == 0x00) return; // releases, prefixes, and keys that type nothing
+
+	keyboard_push(temp_second);
+};
+
+void keyboard_interrupt() // falling edge of the clock, one bit each time and never waits
+{
+	unsigned char temp_bit = (digitalRead(keyboard_data) == HIGH ? 0x01 : 0x00);
+	unsigned char temp_ones = 0x00;
+	unsigned int temp_time = (unsigned int)micros();
+
+	if ((unsigned int)(temp_time - keyboard_time) > keyboard_timeout) keyboard_counter = 0x00; // a clock was missed, start over
+
+	keyboard_time = temp_time;
+
+	if (keyboard_counter == 0x00) // start
+	{
+		if (temp_bit == 0x00)
+		{
+			keyboard_byte = 0x00;
+			keyboard_counter++;
+		}
+	}
+	else if (keyboard_counter <= 0x08) // data
+	{
+		keyboard_byte = keyboard_byte >> 1;
+
+		if (temp_bit == 0x01) keyboard_byte += 0x80;
+
+		keyboard_counter++;
+	}
+	else if (keyboard_counter == 0x09) // parity, odd
+	{
+		temp_ones = temp_bit;
+
+		for (int i=0; i<8; i++) temp_ones += (unsigned char)((keyboard_byte >> i) & 0x01);
+
+		keyboard_counter = (unsigned char)(0x0B - (temp_ones & 0x01));
 	}
+	else // stop
+	{
+		if (temp_bit == 0x01 && keyboard_counter == 0x0A) keyboard_decode(keyboard_byte);
 
-	while (digitalRead(keyboard_clock) == LOW) {}
+		keyboard_counter = 0x00;
+	}
 
 	return;
 };
 
+ISR(INT0_vect) // keyboard_clock is pin 2, set up here rather than with attachInterrupt() and its table of handlers in SRAM
+{
+	keyboard_interrupt();
+};
+
 void keyboard_initialize()
 {
 	pinMode(keyboard_clock, INPUT_PULLUP);
 	pinMode(keyboard_data, INPUT_PULLUP);
 
-	attachInterrupt(digitalPinToInterrupt(keyboard_clock), keyboard_interrupt, LOW);
+	EICRA = (unsigned char)((EICRA & ~((1 << ISC01) | (1 << ISC00))) | (1 << ISC01)); // falling edge
+	EIMSK |= (unsigned char)(1 << INT0);
 
 	interrupts(); // just in case
 };
 
 void keyboard_clearscreen()
 {
+	unsigned char temp_row[64];
+
 	keyboard_pos_x = 0x00;
 	keyboard_pos_y = 0x00;
 
-	for (int i=0; i<2048; i++)
-	{
-		display_sendpacket(keyboard_pos_y, keyboard_pos_x, 0x00);
+	keyboard_dirty_y = 0xFF; // nothing left to send
+	keyboard_cursor = 0x00;
 
-		keyboard_pos_x++;
+	for (int i=0; i<64; i++) temp_row[i] = 0x00;
 
-		if (keyboard_pos_x == 0x00) keyboard_pos_y++;
+	for (int i=0; i<2048; i+=64)
+	{
+		display_sendblock((unsigned char)(i/256), (unsigned char)(i%256), temp_row, 64);
 	}
 	
 	for (int i=0; i<display_height; i++)
@@ -467,12 +807,11 @@ void keyboard_clearscreen()
 		}
 	}
 
+	for (int i=0; i<64; i++) temp_row[i] = keyboard_invert;
+
 	for (int i=display_top; i<display_height+display_top+4; i++)
 	{
-		for (int j=display_left; j<display_width+display_left; j++)
-		{
-			display_sendcharacter(i, j, keyboard_invert);
-		}
+		display_sendblock((unsigned char)((i & 0xFC) >> 2), (unsigned char)(display_left + ((i & 0x03) << 6)), temp_row, display_width);
 	}
 
 	keyboard_pos_x = (unsigned char)display_left;
@@ -512,7 +851,7 @@ void keyboard_menu()
 
 			if (serial_output)
 			{
-				Serial.println("");
+				serial_newline();
 			}
 		}
 		else
@@ -525,7 +864,7 @@ void keyboard_menu()
 
 	if (serial_output)
 	{
-		Serial.println("");
+		serial_newline();
 	}
 
 	keyboard_mode = temp_mode;
@@ -534,140 +873,200 @@ void keyboard_menu()
 
 	keyboard_pos_x = (unsigned char)display_left;
 	keyboard_pos_y = (unsigned char)display_top;
-	display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+0x80+keyboard_invert)); // cursor
+	display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(keyboard_under()+0x80+keyboard_invert)); // cursor
 };
 
-void keyboard_verticalscroll()
+void keyboard_flushrow() // sends the cells printed on one row together
 {
-	for (int i=0; i<display_height; i++)
+	unsigned char temp_row[64];
+
+	if (keyboard_dirty_y == 0xFF) return;
+
+	for (int j=keyboard_dirty_first; j<=keyboard_dirty_last; j++)
 	{
-		for (int j=0; j<display_width; j++)
-		{
-			screen_memory[i*display_width+j] = screen_memory[(i+1)*display_width+j];
-		}
+		temp_row[j-keyboard_dirty_first] = (unsigned char)(screen_memory[keyboard_dirty_y*display_width+j]+keyboard_invert);
 	}
-		
-	for (int j=0; j<display_width; j++)
+
+	display_sendblock((unsigned char)(((keyboard_dirty_y+display_top) & 0xFC) >> 2), 
+		(unsigned char)(display_left + keyboard_dirty_first + (((keyboard_dirty_y+display_top) & 0x03) << 6)), 
+		temp_row, (unsigned int)(keyboard_dirty_last-keyboard_dirty_first+1));
+
+	keyboard_dirty_y = 0xFF;
+};
+
+void keyboard_flush() // whatever keyboard_print() has not sent yet, then the cursor
+{
+	keyboard_flushrow();
+
+	if (keyboard_cursor != 0x00)
 	{
-		screen_memory[(display_height-1)*display_width+j] = 0x00;
+		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(keyboard_under()+keyboard_invert+0x80));
+
+		keyboard_cursor = 0x00;
 	}
+};
 
-	for (int i=0; i<display_height; i++)
+void keyboard_mark() // the cell under the cursor is sent later, with the rest of its row
+{
+	unsigned char temp_y = (unsigned char)(keyboard_pos_y-display_top);
+	unsigned char temp_x = (unsigned char)(keyboard_pos_x-display_left);
+
+	if (keyboard_pos_y < display_top || keyboard_pos_y >= display_top+display_height) // the menu below the text area is not kept
 	{
-		for (int j=0; j<display_width; j++)
-		{
-			display_sendcharacter(i+display_top, j+display_left, screen_memory[i*display_width+j]+keyboard_invert);
-		}
+		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(keyboard_invert));
+
+		return;
 	}
 
-	return;
+	if (keyboard_dirty_y != 0xFF && keyboard_dirty_y != temp_y) keyboard_flushrow();
+
+	if (keyboard_dirty_y == 0xFF)
+	{
+		keyboard_dirty_y = temp_y;
+		keyboard_dirty_first = temp_x;
+		keyboard_dirty_last = temp_x;
+	}
+	else if (temp_x < keyboard_dirty_first) keyboard_dirty_first = temp_x;
+	else if (temp_x > keyboard_dirty_last) keyboard_dirty_last = temp_x;
 };
 
-unsigned char keyboard_character()
+void keyboard_verticalscroll() // only sends the part of each row that changes, the screen already shows the rest
 {
-	unsigned char temp_value = 0x00;
-	unsigned char temp_second = 0x00;
+	unsigned char temp_row[64];
+	int temp_first;
+	int temp_last;
+
+	keyboard_flushrow();
 
-	if (keyboard_read_pos != keyboard_write_pos)
+	for (int i=0; i<display_height; i++)
 	{
-		temp_value = keyboard_buffer[keyboard_read_pos];
+		temp_first = display_width;
+		temp_last = -1;
 
-		if (temp_value == 0xF0) // release
-		{
-			keyboard_release = 0xF0;
-		}
-		else if (temp_value == 0xE0) // extended
-		{
-			keyboard_extended = 0xE0;
-		}
-		else
+		for (int j=0; j<display_width; j++)
 		{
-			if (keyboard_release > 0x00)
-			{
-				if (temp_value == 0x12 || temp_value == 0x59) keyboard_shift = 0x00;
-			}
-			else
+			if (i < display_height-1) temp_row[j] = screen_memory[(i+1)*display_width+j];
+			else temp_row[j] = 0x00;
+
+			if (temp_row[j] != screen_memory[i*display_width+j])
 			{
-				if (temp_value == 0x58) keyboard_capslock += 0x80;
-				else if (temp_value == 0x12 || temp_value == 0x59) keyboard_shift = 0xFF;
+				if (temp_first > j) temp_first = j;
 
-				if (keyboard_capslock != 0x00) temp_value += 0x80;
+				temp_last = j;
+			}
 
-				if (keyboard_shift == 0xFF) temp_value += 0x80;
+			screen_memory[i*display_width+j] = temp_row[j];
 
-				if (keyboard_extended > 0x00)
-				{
-					if (temp_value == 0x4A || temp_value == 0xCA) temp_value += 0x80; // numpad slash
-					
-					temp_second = (unsigned char)pgm_read_byte_near(keyboard_conversion + (unsigned char)(temp_value+0x80));
-				}
-				else
-				{
-					temp_second = (unsigned char)pgm_read_byte_near(keyboard_conversion + (unsigned char)(temp_value+0x00));
-				}
-			}
+			temp_row[j] = (unsigned char)(temp_row[j]+keyboard_invert);
+		}
 
-			keyboard_release = 0x00;
-			keyboard_extended = 0x00;
+		if (temp_last >= temp_first)
+		{
+			display_sendblock((unsigned char)(((i+display_top) & 0xFC) >> 2), (unsigned char)(display_left + temp_first + (((i+display_top) & 0x03) << 6)), 
+				&temp_row[temp_first], (unsigned int)(temp_last-temp_first+1));
 		}
+	}
 
-		keyboard_read_pos++;
-		if (keyboard_read_pos >= 0x10) keyboard_read_pos = 0x00;
+	return;
+};
 
-		return temp_second;
+void keyboard_late() // when something waits to be sent
+{
+	if ((unsigned char)((unsigned char)millis()-keyboard_pending) >= keyboard_latency)
+	{
+		keyboard_flush(); // printing stopped for a while, or it has waited long enough
 	}
-	else
+};
+
+unsigned char keyboard_room() // free places in the buffer
+{
+	return (unsigned char)((keyboard_read_pos - keyboard_write_pos - 1) & (keyboard_size - 1));
+};
+
+ISR(USART_RX_vect) // serial input into the same buffer, each byte after the special serial key 0x10
+{
+	unsigned char temp_value;
+
+	if (keyboard_room() < 2) // the rest waits in the USART until keyboard_receive() finds room
 	{
-		if (serial_input)
-		{
-			if (Serial.available() > 0)
-			{
-				if (serial_last == 0x10) // special serial key
-				{
-					serial_last = Serial.read();
-				}
-				else
-				{
-					serial_last = 0x10;
-				}
+		UCSR0B &= (unsigned char)~(1 << RXCIE0);
 
-				delay(1);
+		return;
+	}
 
-				return (unsigned char)serial_last;					
-			}
-			else
-			{
-				if (serial_last == 0x10)
-				{
-					serial_last = 0x0D;
-				}
-				else if (serial_last == 0x0D)
-				{
-					serial_last = 0x00;
-				}
-				else if (serial_last != 0x00)
-				{
-					serial_last = 0x10;
-				}
+	temp_value = UDR0;
 
-				delay(1);
+	serial_time = (unsigned char)millis();
 
-				return serial_last;
-			}
+	if (temp_value == 0x0A && serial_line == 0x02) // after a carriage return
+	{
+		serial_line = 0x00;
+
+		return;
+	}
+
+	keyboard_push(0x10);
+
+	if (temp_value == 0x0D || temp_value == 0x0A) keyboard_push(0x0D);
+	else keyboard_push(temp_value);
+
+	if (temp_value == 0x0D) serial_line = 0x02;
+	else if (temp_value == 0x0A) serial_line = 0x00;
+	else serial_line = 0x01;
+};
+
+void keyboard_receive() // the end of a serial line that has no line ending, and serial input again once there is room
+{
+	noInterrupts();
+
+	if (keyboard_room() >= 2) UCSR0B |= (unsigned char)(1 << RXCIE0);
+
+	if (serial_line != 0x00 && (UCSR0A & (1 << RXC0)) == 0x00 && (unsigned char)((unsigned char)millis()-serial_time) >= serial_idle && keyboard_room() >= 2) // nothing waiting in the USART
+	{
+		if (serial_line == 0x01) // no line ending, so the pause is the return
+		{
+			keyboard_push(0x10);
+			keyboard_push(0x0D);
 		}
-	
-		return 0x00;
+
+		serial_line = 0x00;
 	}
+
+	interrupts();
 };
 
-void keyboard_print(unsigned char value)
+unsigned char keyboard_character()
 {
 	unsigned char temp_value = 0x00;
-	unsigned char temp_x = 0x00;
-	unsigned char temp_y = 0x00;
 
+	if (keyboard_dirty_y != 0xFF || keyboard_cursor != 0x00) keyboard_late();
+
+	if (serial_input) keyboard_receive();
+
+	if (keyboard_overflow != 0x00) // keys were lost while the buffer was full
+	{
+		keyboard_overflow = 0x00;
+
+		audio_note(500); // higher than the menu beep
+	}
+
+	if (keyboard_read_pos != keyboard_write_pos) // already decoded
+	{
+		temp_value = keyboard_buffer[keyboard_read_pos];
+
+		keyboard_read_pos = (unsigned char)((keyboard_read_pos + 1) & (keyboard_size - 1));
+	}
+
+	return temp_value;
+};
+
+void keyboard_print(unsigned char value)
+{
 	if (value == 0x00) return;
-	else if (value == 0x10) // special serial key
+
+	if (keyboard_dirty_y == 0xFF && keyboard_cursor == 0x00) keyboard_pending = (unsigned char)millis(); // nothing was waiting
+
+	if (value == 0x10) // special serial key
 	{
 		keyboard_serial = 0x01;
 	}
@@ -713,7 +1112,7 @@ void keyboard_print(unsigned char value)
 	}
 	else if (value == 0x0D || value == 0x8D) // carriage return
 	{
-		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x00));
+		keyboard_mark();
 
 		keyboard_pos_x = (unsigned char)display_left;
 		if (keyboard_pos_y < (unsigned char)(display_height+display_top)-1) keyboard_pos_y++;
@@ -724,13 +1123,13 @@ void keyboard_print(unsigned char value)
 			keyboard_pos_y = (unsigned char)(display_height+display_top)-1;
 		}
 
-		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+		keyboard_cursor = 0x01;
 
 		if (serial_output)
 		{
 			if (keyboard_serial == 0x00)
 			{
-				Serial.println("");
+				serial_newline();
 				delay(1);
 			}
 		}
@@ -739,44 +1138,44 @@ void keyboard_print(unsigned char value)
 	{
 		if (keyboard_mode == 0x00)
 		{
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x00));
+			keyboard_mark();
 	
 			if (keyboard_pos_y > (unsigned char)display_top) keyboard_pos_y--;
 	
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+			keyboard_cursor = 0x01;
 		}
 	}
 	else if (value == 0x12 || value == 0x92) // down arrow
 	{
 		if (keyboard_mode == 0x00)
 		{
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x00));
+			keyboard_mark();
 	
 			if (keyboard_pos_y < (unsigned char)(display_height+display_top)-1) keyboard_pos_y++;
 	
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+			keyboard_cursor = 0x01;
 		}
 	}
 	else if (value == 0x08 || value == 0x13 || value == 0x88 || value == 0x93) // backspace or left arrow
 	{
 		if (keyboard_mode == 0x00 || value == 0x08 || value == 0x88)
 		{
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x00));
+			keyboard_mark();
 
 			if (keyboard_pos_x > (unsigned char)display_left) keyboard_pos_x--;
 
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+			keyboard_cursor = 0x01;
 		}
 	}
 	else if (value == 0x09 || value == 0x14 || value == 0x89 || value == 0x94) // tab or right arrow
 	{
 		if (keyboard_mode == 0x00 || value == 0x09 || value == 0x89)
 		{
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x00));
+			keyboard_mark();
 
 			if (keyboard_pos_x < (unsigned char)(display_width+display_left-1)) keyboard_pos_x++;
 
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+			keyboard_cursor = 0x01;
 		}
 	}
 	else if (value == 0x1B || value == 0x9B) // escape
@@ -791,7 +1190,7 @@ void keyboard_print(unsigned char value)
 			{
 				if (keyboard_serial == 0x00)
 				{
-					Serial.println("");
+					serial_newline();
 					delay(1);
 				}
 			}
@@ -804,8 +1203,16 @@ void keyboard_print(unsigned char value)
 			if (value > 0x60 && value <= 0x7A) value = (unsigned char)(value - 0x20); // upper case only
 		}
 
-		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(value+keyboard_invert));
-		screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left] = (unsigned char)value;
+		if (keyboard_pos_y >= display_top && keyboard_pos_y < display_top+display_height) // the menu is printed below the text area
+		{
+			screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left] = (unsigned char)value;
+
+			keyboard_mark(); // sent with the rest of the row
+		}
+		else
+		{
+			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(value+keyboard_invert));
+		}
 
 		if (keyboard_pos_x < (unsigned char)display_width+display_left-1) keyboard_pos_x++;
 		else
@@ -819,13 +1226,13 @@ void keyboard_print(unsigned char value)
 			}
 		}
 
-		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+		keyboard_cursor = 0x01;
 
 		if (serial_output)
 		{
 			if (keyboard_serial == 0x00)
 			{
-				Serial.print((char)value);
+				serial_write((unsigned char)value);
 				delay(1);
 			}
 		}
@@ -843,6 +1250,13 @@ const int sdcard_mosi = 11;
 const int sdcard_miso = 12;
 const int sdcard_sclk = 13;
 
+const int sdcard_transport = 1; // 0 = digitalWrite(), 1 = SPI peripheral on the same pins
+const unsigned int sdcard_busy = 500; // milliseconds a card may take to finish a write
+const unsigned int sdcard_readtime = 100; // milliseconds a card may take to answer a command, or to start a block it reads
+
+unsigned char sdcard_ready = 0x00; // 0x01 after sdcard_initialize(), cleared when a transfer fails
+unsigned char sdcard_sdhc = 0x00; // 0x01 for SDHC and SDXC, which take block numbers instead of byte addresses
+
 void sdcard_enable()
 {
 	digitalWrite(sdcard_ss, LOW);
@@ -864,10 +1278,26 @@ void sdcard_longdelay()
 	delay(10);
 };
 
+unsigned char sdcard_transfer(unsigned char value) // one byte each way through the SPI peripheral
+{
+	SPDR = value;
+
+	while ((SPSR & (1 << SPIF)) == 0x00) {}
+
+	return SPDR;
+};
+
 void sdcard_sendbyte(unsigned char value)
 {
 	unsigned char temp_value = value;
 
+	if (sdcard_transport == 1)
+	{
+		sdcard_transfer(value);
+
+		return;
+	}
+
 	for (int i=0; i<8; i++)
 	{
 		if (temp_value >= 0x80)
@@ -889,6 +1319,11 @@ unsigned char sdcard_receivebyte()
 {
 	unsigned char temp_value = 0x00;
 
+	if (sdcard_transport == 1)
+	{
+		return sdcard_transfer(0xFF);
+	}
+
 	for (int i=0; i<8; i++)
 	{
 		temp_value = temp_value << 1;
@@ -904,11 +1339,12 @@ unsigned char sdcard_receivebyte()
 	return temp_value;
 };
 
-unsigned char sdcard_waitresult()
+unsigned char sdcard_waitresult(const unsigned int timeout) // the first byte that is not 0xFF, or 0xFF after 'timeout' milliseconds
 {
 	unsigned char temp_value = 0xFF;
+	unsigned long temp_start = millis();
 
-	for (int i=0; i<2048; i++) // arbitrary wait time
+	while (true)
 	{
 		temp_value = sdcard_receivebyte();
 
@@ -916,9 +1352,21 @@ unsigned char sdcard_waitresult()
 		{
 			return temp_value;
 		}
+
+		if (millis() - temp_start > timeout) return 0xFF;
+	}
+};
+
+int sdcard_waitready() // the card holds its output low while busy
+{
+	unsigned long temp_start = millis();
+
+	while (sdcard_receivebyte() != 0xFF)
+	{
+		if (millis() - temp_start > sdcard_busy) return 0;
 	}
 
-	return 0xFF;
+	return 1;
 };
 
 void sdcard_pump()
@@ -928,6 +1376,16 @@ void sdcard_pump()
 
 	sdcard_longdelay();
 
+	if (sdcard_transport == 1)
+	{
+		for (int i=0; i<10; i++)
+		{
+			sdcard_transfer(0xFF); // mosi stays high too
+		}
+
+		return;
+	}
+
 	for (int i=0; i<80; i++)
 	{
 		sdcard_toggle();
@@ -937,8 +1395,12 @@ void sdcard_pump()
 int sdcard_initialize()
 {
 	unsigned char temp_value = 0x00;
+	unsigned char temp_version = 0x00; // 0x01 for cards before 2.00, which do not know CMD8
 
-	pinMode(sdcard_ss, OUTPUT);
+	sdcard_ready = 0x00;
+	sdcard_sdhc = 0x00;
+
+	pinMode(sdcard_ss, OUTPUT); // also keeps the SPI peripheral the master
 	pinMode(sdcard_mosi, OUTPUT);
 	pinMode(sdcard_miso, INPUT_PULLUP);
 	pinMode(sdcard_sclk, OUTPUT);
@@ -947,6 +1409,12 @@ int sdcard_initialize()
 	digitalWrite(sdcard_mosi, LOW);
 	digitalWrite(sdcard_sclk, LOW);
 
+	if (sdcard_transport == 1)
+	{
+		SPCR = (unsigned char)((1 << SPE) | (1 << MSTR) | (1 << SPR1) | (1 << SPR0)); // 125 kHz, below the 400 kHz allowed until ready
+		SPSR = 0x00;
+	}
+
 	sdcard_disable();
 	sdcard_pump();
 	sdcard_longdelay();
@@ -957,7 +1425,7 @@ int sdcard_initialize()
 	sdcard_sendbyte(0x00);
 	sdcard_sendbyte(0x00);
 	sdcard_sendbyte(0x95); // CRC for CMD0
-	temp_value = sdcard_waitresult(); // command response
+	temp_value = sdcard_waitresult(sdcard_readtime); // command response
 	if (temp_value == 0xFF) { return 0; }
 	sdcard_disable();
 	if (temp_value != 0x01) { return 0; } // expecting 0x01
@@ -970,16 +1438,23 @@ int sdcard_initialize()
 	sdcard_sendbyte(0x01);
 	sdcard_sendbyte(0xAA); 
 	sdcard_sendbyte(0x87); // CRC for CMD8
-	temp_value = sdcard_waitresult(); // command response
+	temp_value = sdcard_waitresult(sdcard_readtime); // command response
 	if (temp_value == 0xFF) { return 0; }
-	sdcard_disable();
-	if (temp_value != 0x01) { return 0; } // expecting 0x01
-	sdcard_enable();
-	temp_value = sdcard_receivebyte(); // 32-bit return value, ignore
-	temp_value = sdcard_receivebyte();
-	temp_value = sdcard_receivebyte();
-	temp_value = sdcard_receivebyte();
-	sdcard_disable();
+	if (temp_value == 0x05) // illegal command, so an older card
+	{
+		sdcard_disable();
+		temp_version = 0x01;
+	}
+	else
+	{
+		if (temp_value != 0x01) { sdcard_disable(); return 0; } // expecting 0x01
+		temp_value = sdcard_receivebyte(); // 32-bit return value, voltage then check pattern
+		temp_value = sdcard_receivebyte();
+		temp_value = sdcard_receivebyte();
+		temp_value = sdcard_receivebyte();
+		sdcard_disable();
+		if (temp_value != 0xAA) { return 0; } // check pattern comes back
+	}
 	do {
 		sdcard_pump();
 		sdcard_longdelay();
@@ -990,7 +1465,7 @@ int sdcard_initialize()
 		sdcard_sendbyte(0x00);
 		sdcard_sendbyte(0x00);
 		sdcard_sendbyte(0x01); // CRC (general)
-		temp_value = sdcard_waitresult(); // command response
+		temp_value = sdcard_waitresult(sdcard_readtime); // command response
 		if (temp_value == 0xFF) { return 0; }
 		sdcard_disable();
 		if (temp_value != 0x01) { return 0; } // expecting 0x01
@@ -998,2210 +1473,3316 @@ int sdcard_initialize()
 		sdcard_longdelay();
 		sdcard_enable();
 		sdcard_sendbyte(0x69); // CMD41 = 0x40 + 0x29 (41 in hex)
-		sdcard_sendbyte(0x40); // needed for CMD41?
+		sdcard_sendbyte(temp_version == 0x00 ? 0x40 : 0x00); // HCS, this host takes SDHC cards, but not for older cards
 		sdcard_sendbyte(0x00);
 		sdcard_sendbyte(0x00);
 		sdcard_sendbyte(0x00);
 		sdcard_sendbyte(0x01); // CRC (general)
-		temp_value = sdcard_waitresult(); // command response
+		temp_value = sdcard_waitresult(sdcard_readtime); // command response
 		if (temp_value == 0xFF) { return 0; }
 		sdcard_disable();
 		if (temp_value != 0x00 && temp_value != 0x01) { return 0; } // expecting 0x00, if 0x01 try again
 		sdcard_longdelay();
 	} while (temp_value == 0x01);
 
+	if (temp_version == 0x00)
+	{
+		sdcard_enable();
+		sdcard_sendbyte(0x7A); // CMD58 = 0x40 + 0x3A (58 in hex)
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x01); // CRC (general)
+		temp_value = sdcard_waitresult(sdcard_readtime); // command response
+		if (temp_value != 0x00) { sdcard_disable(); return 0; } // expecting 0x00
+		temp_value = sdcard_receivebyte(); // 32-bit OCR, CCS is bit 30
+		if (temp_value & 0x40) sdcard_sdhc = 0x01;
+		temp_value = sdcard_receivebyte();
+		temp_value = sdcard_receivebyte();
+		temp_value = sdcard_receivebyte();
+		sdcard_disable();
+	}
+
+	if (sdcard_sdhc == 0x00)
+	{
+		sdcard_enable();
+		sdcard_sendbyte(0x50); // CMD16 = 0x40 + 0x10 (16 in hex)
+		sdcard_sendbyte(0x00); // blocks of 512 bytes, as SDHC cards always are
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x02);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x01); // CRC (general)
+		temp_value = sdcard_waitresult(sdcard_readtime); // command response
+		sdcard_disable();
+		if (temp_value != 0x00) { return 0; } // expecting 0x00
+	}
+
+	if (sdcard_transport == 1)
+	{
+		SPCR = (unsigned char)((1 << SPE) | (1 << MSTR)); // full speed from here on, 8 MHz
+		SPSR = (unsigned char)(1 << SPI2X);
+	}
+
+	sdcard_ready = 0x01;
+
 	return 1;
 };
 
-int sdcard_readblock(unsigned char high, unsigned char low)
+int sdcard_command(unsigned char command, unsigned long block) // selects the card and sends a block command, no pump or delay needed once ready
 {
 	unsigned char temp_value = 0x00;
 
-	sdcard_disable();
-	sdcard_pump();
-	sdcard_longdelay();
+	if (sdcard_sdhc == 0x00) block = block << 9; // byte address of the block
+
 	sdcard_enable();
-	sdcard_sendbyte(0x51); // CMD17 = 0x40 + 0x11 (17 in hex)
-	sdcard_sendbyte(0x00);
-	sdcard_sendbyte(high);
-	sdcard_sendbyte(low&0xFE); // only blocks of 512 bytes
-	sdcard_sendbyte(0x00);
+	sdcard_receivebyte(); // one byte with the card selected before each command
+	sdcard_sendbyte(command);
+	sdcard_sendbyte((unsigned char)((block >> 24) & 0xFF));
+	sdcard_sendbyte((unsigned char)((block >> 16) & 0xFF));
+	sdcard_sendbyte((unsigned char)((block >> 8) & 0xFF));
+	sdcard_sendbyte((unsigned char)(block & 0xFF));
 	sdcard_sendbyte(0x01); // CRC (general)
-	temp_value = sdcard_waitresult(); // command response
-	if (temp_value == 0xFF) { return 0; }
-	else if (temp_value != 0x00) { return 0; } // expecting 0x00
-	temp_value = sdcard_waitresult(); // data packet starts with 0xFE
-	if (temp_value == 0xFF) { return 0; }
-	else if (temp_value != 0xFE) { return 0; }
-	for (int i=0; i<512; i++) // packet of 512 bytes
+	temp_value = sdcard_waitresult(sdcard_readtime); // command response
+	if (temp_value != 0x00) { sdcard_disable(); sdcard_ready = 0x00; return 0; } // expecting 0x00
+
+	return 1;
+};
+
+int sdcard_readsector(unsigned long block, unsigned char *buf) // one block into SRAM, 'buf' holds 512 bytes
+{
+	unsigned char temp_value = 0x00;
+
+	if (!sdcard_command(0x51, block)) { return 0; } // CMD17 = 0x40 + 0x11 (17 in hex)
+	temp_value = sdcard_waitresult(sdcard_readtime); // data packet starts with 0xFE
+	if (temp_value != 0xFE) { sdcard_disable(); sdcard_ready = 0x00; return 0; }
+	for (unsigned int i=0; i<512; i++) // packet of 512 bytes
 	{
-		temp_value = sdcard_receivebyte();
-		shared_memory[i] = temp_value;
+		buf[i] = sdcard_receivebyte();
 	}
-	temp_value = sdcard_receivebyte(); // data packet ends with 0x55 then 0xAA
-	temp_value = sdcard_receivebyte(); // ignore here
+	temp_value = sdcard_receivebyte(); // CRC, ignored in SPI mode
+	temp_value = sdcard_receivebyte();
 	sdcard_disable();
 
 	return 1;
 };
 
-int sdcard_writeblock(unsigned char high, unsigned char low)
+int sdcard_writesector(unsigned long block, unsigned char *buf) // one block from SRAM, 'buf' holds 512 bytes
 {
 	unsigned char temp_value = 0x00;
 
-	sdcard_disable();
-	sdcard_pump();
-	sdcard_longdelay();
-	sdcard_enable();
-	sdcard_sendbyte(0x58); // CMD24 = 0x40 + 0x18 (24 in hex)
-	sdcard_sendbyte(0x00);
-	sdcard_sendbyte(high);
-	sdcard_sendbyte(low&0xFE); // only blocks of 512 bytes
-	sdcard_sendbyte(0x00);
-	sdcard_sendbyte(0x01); // CRC (general)
-	temp_value = sdcard_waitresult(); // command response
-	if (temp_value == 0xFF) { return 0; }
-	else if (temp_value != 0x00) { return 0; } // expecting 0x00
+	if (!sdcard_command(0x58, block)) { return 0; } // CMD24 = 0x40 + 0x18 (24 in hex)
 	sdcard_sendbyte(0xFE); // data packet starts with 0xFE
-	for (int i=0; i<512; i++) // packet of 512 bytes
+	for (unsigned int i=0; i<512; i++) // packet of 512 bytes
 	{
-		temp_value = shared_memory[i]; 
-		sdcard_sendbyte(temp_value);
+		sdcard_sendbyte(buf[i]);
 	}
-	sdcard_sendbyte(0x55); // data packet ends with 0x55 then 0xAA
-	sdcard_sendbyte(0xAA);
-	temp_value = sdcard_receivebyte(); // toggle clock 8 times
+	sdcard_sendbyte(0xFF); // CRC, ignored in SPI mode
+	sdcard_sendbyte(0xFF);
+	temp_value = sdcard_waitresult(sdcard_busy); // data response
+	if ((temp_value & 0x1F) != 0x05 || !sdcard_waitready()) { sdcard_disable(); sdcard_ready = 0x00; return 0; } // accepted, then written
 	sdcard_disable();
 
 	return 1;
 };
 
-const int audio_output = 9;
-
-void audio_note(unsigned int value)
+int sdcard_readblocks(unsigned long block, const unsigned int count, unsigned int remote, unsigned char *buf, const unsigned int len) // 'count' blocks in a row into extended RAM, 'len' bytes at a time
 {
-	pinMode(audio_output, OUTPUT);
-
-	digitalWrite(audio_output, LOW);
-
 	unsigned char temp_value = 0x00;
 
-	for (unsigned long i=0; i<(unsigned long)(100000/(value+1)); i++) // needs modifying a litte
+	if (!sdcard_command((count > 1 ? 0x52 : 0x51), block)) { return 0; } // CMD18 = 0x40 + 0x12 (18 in hex), or CMD17 for one block
+
+	for (unsigned int b=0; b<count; b++)
 	{
-		digitalWrite(audio_output, HIGH);
+		temp_value = sdcard_waitresult(sdcard_readtime); // data packet starts with 0xFE
+		if (temp_value != 0xFE) { sdcard_disable(); sdcard_ready = 0x00; return 0; }
+		for (unsigned int i=0; i<512; i+=len) // packet of 512 bytes
+		{
+			for (unsigned int j=0; j<len; j++)
+			{
+				buf[j] = sdcard_receivebyte();
+			}
 
-		delayMicroseconds(value);
+			display_sendblock((unsigned char)((remote+i)/256), (unsigned char)((remote+i)%256), buf, len); // the card waits for the clock
+		}
+		temp_value = sdcard_receivebyte(); // CRC, ignored in SPI mode
+		temp_value = sdcard_receivebyte();
 
-		digitalWrite(audio_output, LOW);
+		remote += 512;
+	}
 
-		delayMicroseconds(value);
+	if (count > 1)
+	{
+		sdcard_sendbyte(0x4C); // CMD12 = 0x40 + 0x0C (12 in hex), stops the transmission
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x01); // CRC (general)
+		temp_value = sdcard_receivebyte(); // stuff byte
+		temp_value = sdcard_waitresult(sdcard_readtime); // command response
+		if (temp_value != 0x00 || !sdcard_waitready()) { sdcard_disable(); sdcard_ready = 0x00; return 0; }
 	}
-};
 
-unsigned char eeprom_read(unsigned char low, unsigned char high)
-{	
-	return EEPROM.read((unsigned int)((high*256)+low)%1024);
+	sdcard_disable();
+
+	return 1;
 };
 
-void eeprom_write(unsigned char low, unsigned char high, unsigned char data)
+int sdcard_writeblocks(unsigned long block, const unsigned int count, unsigned int remote, unsigned char *buf, const unsigned int len) // 'count' blocks in a row from extended RAM, 'len' bytes at a time
 {
-	EEPROM.write((unsigned int)((high*256)+low)%1024, (unsigned char)data);
-};
+	unsigned char temp_value = 0x00;
 
+	if (!sdcard_command((count > 1 ? 0x59 : 0x58), block)) { return 0; } // CMD25 = 0x40 + 0x19 (25 in hex), or CMD24 for one block
 
-unsigned char x6502_A = 0x00;
-unsigned char x6502_X = 0x00;
-unsigned char x6502_Y = 0x00;
-unsigned char x6502_L = 0x00;
-unsigned char x6502_H = 0x00;
-unsigned char x6502_S = 0x00;
-unsigned char x6502_F = 0x00;
+	for (unsigned int b=0; b<count; b++)
+	{
+		sdcard_sendbyte(count > 1 ? 0xFC : 0xFE); // data packet starts with 0xFC for each of many blocks, or 0xFE for one
+		for (unsigned int i=0; i<512; i+=len) // packet of 512 bytes
+		{
+			display_receiveblock((unsigned char)((remote+i)/256), (unsigned char)((remote+i)%256), buf, len);
 
-unsigned char x6502_U = 0x00;
-unsigned char x6502_V = 0x00;
-unsigned char x6502_W = 0x00;
+			for (unsigned int j=0; j<len; j++)
+			{
+				sdcard_sendbyte(buf[j]);
+			}
+		}
+		sdcard_sendbyte(0xFF); // CRC, ignored in SPI mode
+		sdcard_sendbyte(0xFF);
+		temp_value = sdcard_waitresult(sdcard_busy); // data response
+		if ((temp_value & 0x1F) != 0x05 || !sdcard_waitready()) { sdcard_disable(); sdcard_ready = 0x00; return 0; } // accepted, then written
 
-unsigned char x6502_read(unsigned char BL, unsigned char BH)
-{
-	if (BH < 0x40)
-	{
-		return (unsigned char)shared_memory[(unsigned int)((BH&0x01)*256+BL)]; // duplicated in first 16K from $0000-$3FFF
+		remote += 512;
 	}
-	else
-	{
-		return display_receivepacket((unsigned char)(BH&0x3F), BL); // duplicated on every other 16KB from $4000-$FFFF
-	}
-};
 
-void x6502_write(unsigned char BL, unsigned char BH, unsigned char BD)
-{
-	if (BH < 0x40)
+	if (count > 1)
 	{
-		shared_memory[(unsigned int)((BH&0x01)*256+BL)] = (unsigned char)BD; // duplicated in first 16K from $0000-$3FFF
+		sdcard_sendbyte(0xFD); // stop token
+		temp_value = sdcard_receivebyte(); // stuff byte
+		if (!sdcard_waitready()) { sdcard_disable(); sdcard_ready = 0x00; return 0; }
 	}
-	else
-	{
-		display_sendpacket((unsigned char)(BH&0x3F), BL, BD); // duplicated on every other 16KB from $4000-$FFFF
-	}	
+
+	sdcard_disable();
+
+	return 1;
 };
 
-void x6502_next()
+const int audio_output = 9; // OC1A, a PWM output that the speaker smooths into the sound
+
+// Timer1 counts to audio_top at 16 MHz in fast PWM mode, so each overflow is one sample, 15625 a second.
+// The overflow interrupt mixes the voices into OCR1A in roughly 150 of the 1024 cycles between samples,
+// so the keyboard interrupt waits no more than about ten microseconds, well inside a PS/2 clock pulse.
+
+const unsigned int audio_top = 1023;
+const unsigned char audio_voices = 3;
+const unsigned char audio_rate = 244; // samples each sequencer tick, 64 ticks a second
+const unsigned char audio_size = 8; // bytes of events waiting, a power of two
+const unsigned int audio_shortest = 64; // microseconds high and low for audio_note(), higher notes would alias
+
+const signed char audio_waves[128] PROGMEM = { // 32 samples each of square, triangle, saw, and sine
+	120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120,
+	-120, -104, -88, -72, -56, -40, -24, -8, 8, 24, 40, 56, 72, 88, 104, 120, 120, 104, 88, 72, 56, 40, 24, 8, -8, -24, -40, -56, -72, -88, -104, -120,
+	-120, -112, -105, -97, -89, -81, -74, -66, -58, -50, -43, -35, -27, -19, -12, -4, 4, 12, 19, 27, 35, 43, 50, 58, 66, 74, 81, 89, 97, 105, 112, 120,
+	0, 23, 46, 67, 85, 100, 111, 118, 120, 118, 111, 100, 85, 67, 46, 23, 0, -23, -46, -67, -85, -100, -111, -118, -120, -118, -111, -100, -85, -67, -46, -23 };
+
+const unsigned int audio_steps[12] PROGMEM = { 8779, 9301, 9854, 10440, 11060, 11718, 12415, 13153, 13935, 14764, 15642, 16572 }; // C7 to B7, halved for each octave below
+
+// Events, from a song in PROGMEM or from audio_queue, each note lasting until its voice gets another:
+//   0x01 to 0x3F, length    note on the current voice, C2 to D7, then 'length' ticks before the next event
+//   0x40, length            rest on the current voice
+//   0x41 to 0x43            current voice, 1 to 3
+//   0x48 to 0x4B            wave of the current voice, square, triangle, saw, or sine
+//   0x50, low, high, length square wave on voice 1 with that phase step, for audio_note()
+//   0x00                    end, the sound stops when nothing follows
+// A length of zero starts the next event at the same time, for chords.
+
+const unsigned char audio_event_rest = 0x40;
+const unsigned char audio_event_voice = 0x41;
+const unsigned char audio_event_wave = 0x48;
+const unsigned char audio_event_step = 0x50;
+
+volatile unsigned int audio_phase[audio_voices];
+volatile unsigned int audio_step[audio_voices]; // added to the phase each sample, zero when silent
+volatile unsigned char audio_shape = 0x00; // two bits for each voice, which of the four audio_waves it plays, voice 0 in the lowest, and the voice events are for in the top two
+
+volatile unsigned char audio_queue[audio_size];
+volatile unsigned char audio_head = 0x00; // written by audio_push()
+volatile unsigned char audio_tail = 0x00; // written by the Timer1 interrupt
+const unsigned char * volatile audio_song = NULL; // events in PROGMEM, played before audio_queue
+
+volatile unsigned char audio_wait = 0x00; // ticks left before the next event
+volatile unsigned char audio_count = 0x00; // samples left in this tick
+
+void audio_begin() // Timer1 as the DAC, starting at the middle level
 {
-	x6502_L += 0x01;
-	if (x6502_L == 0x00)
-	{
-		x6502_H += 0x01;
-	}
+	if (TIMSK1 != 0x00) return; // Timer1 runs already
+
+	audio_wait = 0x00;
+	audio_count = audio_rate;
+
+	pinMode(audio_output, OUTPUT);
+
+	TCCR1B = 0x00; // stopped while it changes
+	TCNT1 = 0;
+	ICR1 = audio_top;
+	OCR1A = (audio_top + 1) / 2;
+
+	TCCR1A = (unsigned char)((1 << COM1A1) | (1 << WGM11));
+	TCCR1B = (unsigned char)((1 << WGM13) | (1 << WGM12) | (1 << CS10));
+	TIMSK1 = (unsigned char)(1 << TOIE1);
 };
 
-void x6502_abs()
+void audio_silence() // stops Timer1 and every voice, and leaves the pin low
 {
-	x6502_U = x6502_read(x6502_L, x6502_H);
-	x6502_next();
-	x6502_V = x6502_read(x6502_L, x6502_H);
-	x6502_next();
+	TIMSK1 = 0x00;
+	TCCR1B = 0x00;
+	TCCR1A = 0x00;
+
+	digitalWrite(audio_output, LOW);
+
+	for (int i=0; i<audio_voices; i++) audio_step[i] = 0;
+
+	audio_song = NULL;
 };
 
-void x6502_absx()
+unsigned char audio_next() // the next byte of events, 0x00 when there are none yet
 {
-	x6502_U = x6502_read(x6502_L, x6502_H);
-	x6502_next();
-	x6502_V = x6502_read(x6502_L, x6502_H);
-	x6502_next();
-	
-	if ((int)x6502_U + (int)x6502_X > 255)
+	unsigned char temp_byte;
+
+	if (audio_song != NULL)
 	{
-		x6502_U += x6502_X;
-		x6502_V++;
+		temp_byte = pgm_read_byte(audio_song);
+
+		if (temp_byte != 0x00)
+		{
+			audio_song++;
+
+			return temp_byte;
+		}
+
+		audio_song = NULL;
 	}
-	else x6502_U += x6502_X;
+
+	if (audio_tail == audio_head) return 0x00;
+
+	temp_byte = audio_queue[audio_tail];
+
+	audio_tail = (unsigned char)((audio_tail + 1) & (audio_size - 1));
+
+	return temp_byte;
 };
 
-void x6502_absy()
+void audio_tick() // 64 times a second, from the interrupt
 {
-	x6502_U = x6502_read(x6502_L, x6502_H);
-	x6502_next();
-	x6502_V = x6502_read(x6502_L, x6502_H);
-	x6502_next();
-	
-	if ((int)x6502_U + (int)x6502_Y > 255)
+	unsigned char temp_byte;
+	unsigned int temp_step;
+	unsigned char temp_voice = (unsigned char)(audio_shape >> 6);
+
+	if (audio_wait > 1)
 	{
-		x6502_U += x6502_Y;
-		x6502_V++;
-	}
-	else x6502_U += x6502_Y;
-};
+		audio_wait--;
 
-void x6502_imm()
-{
-	x6502_U = x6502_read(x6502_L, x6502_H);
-	x6502_next();
-};
+		return;
+	}
 
-void x6502_rel()
-{
-	x6502_U = x6502_read(x6502_L, x6502_H);
-	x6502_next();
-};
+	audio_wait = 0x00;
 
-void x6502_zp()
-{
-	x6502_U = x6502_read(x6502_L, x6502_H);
-	x6502_next();
-};
+	for (int i=0; i<8; i++) // a few events starting together, the rest wait for the next tick
+	{
+		temp_byte = audio_next();
 
-void x6502_zpx()
-{
-	x6502_U = (unsigned char)(x6502_read(x6502_L, x6502_H) + x6502_X);
-	x6502_next();
-};
+		if (temp_byte == 0x00) // nothing more
+		{
+			if (i == 0) audio_silence(); // otherwise the rest of a chord may still be on its way
 
-void x6502_zpy()
-{
-	x6502_U = (unsigned char)(x6502_read(x6502_L, x6502_H) + x6502_X);
-	x6502_next();
-};
+			return;
+		}
+		else if (temp_byte <= audio_event_rest) // note or rest
+		{
+			if (temp_byte == audio_event_rest) temp_step = 0;
+			else temp_step = pgm_read_word(&audio_steps[(temp_byte - 1) % 12]) >> (5 - (temp_byte - 1) / 12);
 
-void x6502_jump(unsigned char BL, unsigned char BH)
-{
-	x6502_L = BL;
-	x6502_H = BH;
-};
+			audio_step[temp_voice] = temp_step;
 
-void x6502_jump_indirect(unsigned char BL, unsigned char BH)
-{
-	x6502_L = x6502_read(BL, BH);
-	if ((unsigned char)(BL+0x01) == 0x00)
-	{
-		x6502_H = x6502_read(0x00, (unsigned char)(BH+0x01));
-	}
-	else
-	{
-		x6502_H = x6502_read((unsigned char)(BL+0x01), BH);
-	}
-};
+			audio_wait = audio_next();
+		}
+		else if (temp_byte >= audio_event_voice && temp_byte < audio_event_voice + audio_voices)
+		{
+			temp_voice = (unsigned char)(temp_byte - audio_event_voice);
 
-void x6502_branch(unsigned char B)
-{
-	if (B >= 0x80)
-	{
-		if ((int)x6502_L - (int)(0xFF - B + 1) < 0)
+			audio_shape = (unsigned char)((audio_shape & 0x3F) | (temp_voice << 6));
+		}
+		else if (temp_byte >= audio_event_wave && temp_byte < audio_event_wave + 4)
 		{
-			x6502_L -= (0xFF - B + 1);
-			x6502_H--;
+			audio_shape = (unsigned char)((audio_shape & ~(0x03 << (temp_voice*2))) | ((temp_byte - audio_event_wave) << (temp_voice*2)));
 		}
-		else x6502_L -= (0xFF - B + 1);
-	}
-	else
-	{
-		if ((int)x6502_L + (int)B > 255)
+		else if (temp_byte == audio_event_step)
 		{
-			x6502_L += B;
-			x6502_H++;
+			temp_voice = 0x00;
+			audio_shape &= 0x3C; // voice 0, square
+
+			temp_step = (unsigned int)audio_next();
+			temp_step += (unsigned int)audio_next() * 256;
+
+			audio_step[0] = temp_step;
+
+			audio_wait = audio_next();
 		}
-		else x6502_L += B;
+
+		if (audio_wait > 0) return;
 	}
 };
 
-void x6502_push(unsigned char B)
+ISR(TIMER1_OVF_vect) // one sample, with the voices added up around the middle level
 {
-	x6502_write(x6502_S, 0x01, B);
-	x6502_S--;
-};
+	int temp_sample = (audio_top + 1) / 2;
+	unsigned char temp_shape = audio_shape;
 
-unsigned char x6502_pull()
-{
-	x6502_S++;
-	return x6502_read(x6502_S, 0x01);
-};
+	for (int i=0; i<audio_voices; i++)
+	{
+		if (audio_step[i] != 0)
+		{
+			audio_phase[i] += audio_step[i];
 
-void x6502_neg(unsigned char B)
-{
-	if (B > 0x00) x6502_F = x6502_F | 0x80;
-	else x6502_F = x6502_F & 0x7F;
-};
+			temp_sample += (signed char)pgm_read_byte(&audio_waves[((temp_shape & 0x03) << 5) + ((unsigned char)(audio_phase[i] >> 8) >> 3)]); // top five bits
+		}
 
-void x6502_over(unsigned char B)
-{
-	if (B > 0x00) x6502_F = x6502_F | 0x40;
-	else x6502_F = x6502_F & 0xBF;
-};
+		temp_shape >>= 2;
+	}
 
-void x6502_zero(unsigned char B)
-{
-	if (B > 0x00) x6502_F = x6502_F | 0x02;
-	else x6502_F = x6502_F & 0xFD;
+	OCR1A = (unsigned int)temp_sample; // used from the next sample
+
+	audio_count--;
+
+	if (audio_count == 0x00)
+	{
+		audio_count = audio_rate;
+
+		audio_tick();
+	}
 };
 
-void x6502_carry(unsigned char B)
+unsigned char audio_room() // bytes audio_push() can take without waiting
 {
-	if (B > 0x00) x6502_F = x6502_F | 0x01;
-	else x6502_F = x6502_F & 0xFE;
+	return (unsigned char)((audio_tail - audio_head - 1) & (audio_size - 1));
 };
 
-unsigned char x6502_adc(unsigned char B)
+void audio_push(const unsigned char *event, const unsigned char length) // queues one whole event, waiting for room if need be
 {
-	if ((int)x6502_A + (int)B + (int)(x6502_F & 0x01) > 255) x6502_over(0xFF);
+	while (audio_room() < length) delay(1); // until the interrupt takes some
 
-	unsigned char C = B + (x6502_F & 0x01);
-	
-	x6502_neg(C&0x80);
-	x6502_zero(C);
-	x6502_carry(0x00); // ???
+	noInterrupts();
 
-	return C;
-};
+	for (int i=0; i<length; i++) audio_queue[(audio_head + i) & (audio_size - 1)] = event[i];
 
-unsigned char x6502_and(unsigned char B)
-{
-	unsigned char C = x6502_A & B;
+	audio_head = (unsigned char)((audio_head + length) & (audio_size - 1)); // all of it at once
 
-	x6502_neg(C&0x80);
-	x6502_zero(C);
+	audio_begin();
 
-	return C;
+	interrupts();
 };
 
-unsigned char x6502_asl(unsigned char B)
+void audio_play(const unsigned char *song) // events in PROGMEM, ending with 0x00, instead of any song playing
 {
-	if (B >= 0x80) x6502_carry(0xFF);
-	else x6502_carry(0x00);
+	noInterrupts();
 
-	unsigned char C = B << 1;
-	
-	x6502_neg(C&0x80);
-	x6502_zero(C);
-	
-	return C;
-};
+	audio_song = song;
+	audio_wait = 0x00; // from the next tick
 
-void x6502_bit(unsigned char B)
-{
-	x6502_neg(B&0x80);
-	x6502_over(B&0x40);
-	x6502_zero(B);
+	audio_begin();
 
-	return;
+	interrupts();
 };
 
-void x6502_cmp(unsigned char B)
+void audio_note(unsigned int value) // 'value' microseconds high then low for about a fifth of a second, zero for a rest
 {
-	unsigned char C = x6502_A - B - (0x01 - (x6502_F&0x01));
+	unsigned char temp_event[4];
+	unsigned long temp_step;
 
-	if ((int)x6502_A - (int)B < 0) x6502_carry(0xFF);
-	else x6502_carry(0x00);
+	if (value == 0)
+	{
+		temp_event[0] = audio_event_voice;
+		temp_event[1] = audio_event_rest;
+		temp_event[2] = 13; // ticks
 
-	x6502_neg(C&0x80);
-	x6502_zero(C);
-	
-	return;
-};
+		audio_push(temp_event, 3);
 
-void x6502_cpx(unsigned char B)
-{
-	unsigned char C = x6502_X - B - (0x01 - (x6502_F&0x01));
+		return;
+	}
 
-	if ((int)x6502_X - (int)B < 0) x6502_carry(0xFF);
-	else x6502_carry(0x00);
+	if (value < audio_shortest) value = audio_shortest;
 
-	x6502_neg(C&0x80);
-	x6502_zero(C);
-	
-	return;
-};
+	temp_step = 2097152 / (unsigned long)value; // 65536 steps a period, at 15625 samples a second
 
-void x6502_cpy(unsigned char B)
-{
-	unsigned char C = x6502_Y - B - (0x01 - (x6502_F&0x01));
+	temp_event[0] = audio_event_step;
+	temp_event[1] = (unsigned char)(temp_step & 0xFF);
+	temp_event[2] = (unsigned char)((temp_step >> 8) & 0xFF);
+	temp_event[3] = 13;
 
-	if ((int)x6502_Y - (int)B < 0) x6502_carry(0xFF);
-	else x6502_carry(0x00);
+	audio_push(temp_event, 4);
+};
 
-	x6502_neg(C&0x80);
-	x6502_zero(C);
-	
-	return;
+unsigned char eeprom_read(unsigned char low, unsigned char high)
+{	
+	return EEPROM.read((unsigned int)((high*256)+low)%1024);
 };
 
-unsigned char x6502_dec(unsigned char B)
+void eeprom_write(unsigned char low, unsigned char high, unsigned char data) // 3.3 ms, but only when the byte is different
 {
-	unsigned char C = B - 1;
-	
-	x6502_neg(C&0x80);
-	x6502_zero(C);
-
-	return C;
+	EEPROM.update((unsigned int)((high*256)+low)%1024, (unsigned char)data);
 };
 
-unsigned char x6502_eor(unsigned char B)
-{
-	unsigned char C = x6502_A ^ B;
 
-	x6502_neg(C&0x80);
-	x6502_zero(C);
+unsigned char x6502_A = 0x00;
+unsigned char x6502_X = 0x00;
+unsigned char x6502_Y = 0x00;
+unsigned char x6502_L = 0x00;
+unsigned char x6502_H = 0x00;
+unsigned char x6502_S = 0x00;
+unsigned char x6502_F = 0x00;
 
-	return C;
-};
+unsigned char x6502_U = 0x00;
+unsigned char x6502_V = 0x00;
+unsigned char x6502_W = 0x00;
 
-unsigned char x6502_inc(unsigned char B)
-{
-	unsigned char C = B + 1;
-	
-	x6502_neg(C&0x80);
-	x6502_zero(C);
+const int x6502_cache_lines = 8; // lines of remote memory kept in SRAM, a power of two up to 8
+const int x6502_cache_size = 8; // bytes per line, a power of two, short lines so a loop over a few program lines stays cached in 64 bytes
+const unsigned int x6502_cache_span = x6502_cache_lines*x6502_cache_size; // remote addresses this far apart share a line
 
-	return C;
-};
+unsigned char x6502_cache[x6502_cache_span]; // direct mapped, write back
+unsigned char x6502_cache_tag[x6502_cache_lines]; // remote address of each line divided by x6502_cache_span, 0x00 when empty as the screen is never cached
+unsigned char x6502_cache_dirty = 0x00; // one bit per line
+unsigned char x6502_cache_alias = 0x1F; // remote pages repeat every 8KB until editor_checkmemory() finds 16KB
 
-void x6502_lda(unsigned char B)
-{
-	x6502_A = B;
+unsigned char x6502_shared_written = 0x01; // one bit for each page of shared_memory, set by x6502_write(), the zeroed variables are not what EEPROM holds yet
 
-	x6502_neg(x6502_A&0x80);
-	x6502_zero(x6502_A);
+//#define x6502_stats // counts for the monitor's '?' command, 16 bytes of SRAM, ArduinoHost.sh defines it
 
-	return;
-};
+#ifdef x6502_stats
+unsigned long x6502_cache_hits = 0;
+unsigned long x6502_cache_misses = 0;
+unsigned long x6502_cache_writebacks = 0;
+#endif
 
-void x6502_ldx(unsigned char B)
+unsigned int x6502_lineaddr(int line) // remote address of what a line holds
 {
-	x6502_X = B;
-
-	x6502_neg(x6502_X&0x80);
-	x6502_zero(x6502_X);
-
-	return;
+	return (unsigned int)(x6502_cache_tag[line] * x6502_cache_span + line * x6502_cache_size);
 };
 
-void x6502_ldy(unsigned char B)
+void x6502_flush() // writes back dirty lines, call before remote memory is used without the cache
 {
-	x6502_Y = B;
+	for (int i=0; i<x6502_cache_lines; i++)
+	{
+		if (x6502_cache_dirty & (0x01 << i))
+		{
+			display_sendblock((unsigned char)((x6502_lineaddr(i)&0xFF00)>>8), (unsigned char)(x6502_lineaddr(i)&0x00FF), 
+				&x6502_cache[i*x6502_cache_size], x6502_cache_size);
 
-	x6502_neg(x6502_Y&0x80);
-	x6502_zero(x6502_Y);
+#ifdef x6502_stats
+			x6502_cache_writebacks++;
+#endif
+		}
+	}
 
-	return;
+	x6502_cache_dirty = 0x00;
 };
 
-unsigned char x6502_lsr(unsigned char B)
+void x6502_invalidate() // call after remote memory was changed without the cache
 {
-	if ((B&0x01) > 0x00) x6502_carry(0xFF);
-	else x6502_carry(0x00);
-
-	unsigned char C = B >> 1;
+	x6502_flush();
 
-	x6502_neg(C&0x80);
-	x6502_zero(C);
-
-	return C;
+	for (int i=0; i<x6502_cache_lines; i++)
+	{
+		x6502_cache_tag[i] = 0x00;
+	}
 };
 
-unsigned char x6502_ora(unsigned char B)
+void x6502_forget(unsigned int start, unsigned int stop) // call after remote memory from 'start' up to 'stop' was changed without the cache, x6502_flush() first
 {
-	unsigned char C = x6502_A | B;
-
-	x6502_neg(C&0x80);
-	x6502_zero(C);
-
-	return C;
+	for (int i=0; i<x6502_cache_lines; i++)
+	{
+		if (x6502_cache_tag[i] != 0x00 && x6502_lineaddr(i) + x6502_cache_size > (start&0x3FFF) && x6502_lineaddr(i) < (stop&0x3FFF))
+		{
+			x6502_cache_tag[i] = 0x00;
+		}
+	}
 };
 
-unsigned char x6502_rol(unsigned char B)
+unsigned char *x6502_cacheline(unsigned char BL, unsigned char BH) // NULL for the screen, which is never cached
 {
-	unsigned char D = x6502_F & 0x01;
+	if ((unsigned char)(BH&x6502_cache_alias) < 0x08)
+	{
+		return NULL; // $4000-$47FF, also written by keyboard_print() and the other screen functions
+	}
 
-	if (B >= 0x80) x6502_carry(0xFF);
-	else x6502_carry(0x00);
+	unsigned int temp_addr = (unsigned int)((BH&x6502_cache_alias)*256+BL); // so addresses 8KB apart share a line until 16KB is found
+	unsigned char temp_tag = (unsigned char)(temp_addr / x6502_cache_span);
+	int temp_line = (int)((temp_addr / x6502_cache_size) & (x6502_cache_lines-1));
 
-	unsigned char C = B << 1;
+	if (x6502_cache_tag[temp_line] != temp_tag)
+	{
+#ifdef x6502_stats
+		x6502_cache_misses++;
+#endif
 
-	C += D;
+		if (x6502_cache_dirty & (0x01 << temp_line))
+		{
+			display_sendblock((unsigned char)((x6502_lineaddr(temp_line)&0xFF00)>>8), (unsigned char)(x6502_lineaddr(temp_line)&0x00FF), 
+				&x6502_cache[temp_line*x6502_cache_size], x6502_cache_size);
 
-	x6502_neg(C&0x80);
-	x6502_zero(C);
+			x6502_cache_dirty &= (unsigned char)(~(0x01 << temp_line));
+#ifdef x6502_stats
+			x6502_cache_writebacks++;
+#endif
+		}
 
-	return C;
-};
-	
-unsigned char x6502_ror(unsigned char B)
-{
-	unsigned char D = x6502_F & 0x80;
+		display_receiveblock((unsigned char)(((temp_addr & ~(x6502_cache_size-1))&0xFF00)>>8), (unsigned char)((temp_addr & ~(x6502_cache_size-1))&0x00FF), 
+			&x6502_cache[temp_line*x6502_cache_size], x6502_cache_size);
 
-	if ((B&0x01) > 0x00) x6502_carry(0xFF);
-	else x6502_carry(0x00);
+		x6502_cache_tag[temp_line] = temp_tag;
+	}
+#ifdef x6502_stats
+	else
+	{
+		x6502_cache_hits++;
+	}
+#endif
 
-	unsigned char C = B >> 1;
+	return &x6502_cache[temp_line*x6502_cache_size+(temp_addr&(x6502_cache_size-1))];
+};
 
-	C += D;
+unsigned char x6502_read(unsigned char BL, unsigned char BH)
+{
+	if (BH < 0x40)
+	{
+		return (unsigned char)shared_memory[(unsigned int)((BH&0x01)*256+BL)]; // duplicated in first 16K from $0000-$3FFF
+	}
+	else
+	{
+		unsigned char *temp_byte = x6502_cacheline(BL, BH);
 
-	x6502_neg(C&0x80);
-	x6502_zero(C);
+		if (temp_byte != NULL) return *temp_byte;
 
-	return C;
+		return display_receivepacket((unsigned char)(BH&0x3F), BL); // duplicated on every other 16KB from $4000-$FFFF
+	}
 };
 
-unsigned char x6502_sbc(unsigned char B)
+void x6502_write(unsigned char BL, unsigned char BH, unsigned char BD)
 {
-	unsigned char C = x6502_A - B - (0x01 - (x6502_F&0x01));
+	if (BH < 0x40)
+	{
+		shared_memory[(unsigned int)((BH&0x01)*256+BL)] = (unsigned char)BD; // duplicated in first 16K from $0000-$3FFF
 
-	if ((int)x6502_A - (int)B < 0) x6502_carry(0xFF);
-	else x6502_carry(0x00);
+		x6502_shared_written |= (unsigned char)(0x01 << (BH&0x01)); // for basic_keep()
+	}
+	else
+	{
+		unsigned char *temp_byte = x6502_cacheline(BL, BH);
 
-	x6502_neg(C&0x80);
-	x6502_zero(C);
+		if (temp_byte != NULL)
+		{
+			*temp_byte = BD;
 
-	return C;
+			x6502_cache_dirty |= (unsigned char)(0x01 << (int)((((BH&x6502_cache_alias)*256+BL) / x6502_cache_size) & (x6502_cache_lines-1)));
+		}
+		else
+		{
+			display_sendpacket((unsigned char)(BH&0x3F), BL, BD); // duplicated on every other 16KB from $4000-$FFFF
+		}
+	}	
 };
 
-void x6502_tax()
-{
-	x6502_X = x6502_A;
-	
-	x6502_neg(x6502_A&0x80);
-	x6502_zero(x6502_A);
-	
-	return;
+const bool x6502_brk_vector = false; // BRK jumps through $FFFE like a real 65C02, instead of stopping back in the monitor
+
+#ifdef x6502_stats
+unsigned long x6502_count = 0; // instructions run
+#endif
+
+// addressing modes, each leaves the effective address in x6502_U and x6502_V
+
+const unsigned char x6502_IMP = 0x00; // implied
+const unsigned char x6502_ACC = 0x01; // accumulator
+const unsigned char x6502_IMM = 0x02; // #
+const unsigned char x6502_ZP = 0x03; // zp
+const unsigned char x6502_ZPX = 0x04; // zp,x
+const unsigned char x6502_ZPY = 0x05; // zp,y
+const unsigned char x6502_ABS = 0x06; // a
+const unsigned char x6502_ABX = 0x07; // a,x
+const unsigned char x6502_ABY = 0x08; // a,y
+const unsigned char x6502_IND = 0x09; // (a)
+const unsigned char x6502_IAX = 0x0A; // (a,x)
+const unsigned char x6502_IZX = 0x0B; // (zp,x)
+const unsigned char x6502_IZY = 0x0C; // (zp),y
+const unsigned char x6502_IZP = 0x0D; // (zp)
+const unsigned char x6502_REL = 0x0E; // r
+const unsigned char x6502_ZPR = 0x0F; // zp,r with the zero page address in x6502_W
+
+// operations
+
+const unsigned char x6502_ADC = 0x00;
+const unsigned char x6502_AND = 0x01;
+const unsigned char x6502_ASL = 0x02;
+const unsigned char x6502_BBR = 0x03;
+const unsigned char x6502_BBS = 0x04;
+const unsigned char x6502_BXX = 0x05; // BPL, BMI, BVC, BVS, BCC, BCS, BNE, BEQ
+const unsigned char x6502_BIT = 0x06;
+const unsigned char x6502_BRA = 0x07;
+const unsigned char x6502_BRK = 0x08;
+const unsigned char x6502_CLC = 0x09;
+const unsigned char x6502_CLD = 0x0A;
+const unsigned char x6502_CLI = 0x0B;
+const unsigned char x6502_CLV = 0x0C;
+const unsigned char x6502_CMP = 0x0D;
+const unsigned char x6502_CPX = 0x0E;
+const unsigned char x6502_CPY = 0x0F;
+const unsigned char x6502_DEC = 0x10;
+const unsigned char x6502_DEX = 0x11;
+const unsigned char x6502_DEY = 0x12;
+const unsigned char x6502_EOR = 0x13;
+const unsigned char x6502_INC = 0x14;
+const unsigned char x6502_INX = 0x15;
+const unsigned char x6502_INY = 0x16;
+const unsigned char x6502_JMP = 0x17;
+const unsigned char x6502_JSR = 0x18;
+const unsigned char x6502_LDA = 0x19;
+const unsigned char x6502_LDX = 0x1A;
+const unsigned char x6502_LDY = 0x1B;
+const unsigned char x6502_LSR = 0x1C;
+const unsigned char x6502_NOP = 0x1D;
+const unsigned char x6502_ORA = 0x1E;
+const unsigned char x6502_PHA = 0x1F;
+const unsigned char x6502_PHP = 0x20;
+const unsigned char x6502_PHX = 0x21;
+const unsigned char x6502_PHY = 0x22;
+const unsigned char x6502_PLA = 0x23;
+const unsigned char x6502_PLP = 0x24;
+const unsigned char x6502_PLX = 0x25;
+const unsigned char x6502_PLY = 0x26;
+const unsigned char x6502_RMB = 0x27;
+const unsigned char x6502_ROL = 0x28;
+const unsigned char x6502_ROR = 0x29;
+const unsigned char x6502_RTI = 0x2A;
+const unsigned char x6502_RTS = 0x2B;
+const unsigned char x6502_SBC = 0x2C;
+const unsigned char x6502_SEC = 0x2D;
+const unsigned char x6502_SED = 0x2E;
+const unsigned char x6502_SEI = 0x2F;
+const unsigned char x6502_SMB = 0x30;
+const unsigned char x6502_STA = 0x31;
+const unsigned char x6502_STP = 0x32;
+const unsigned char x6502_STX = 0x33;
+const unsigned char x6502_STY = 0x34;
+const unsigned char x6502_STZ = 0x35;
+const unsigned char x6502_TAX = 0x36;
+const unsigned char x6502_TAY = 0x37;
+const unsigned char x6502_TRB = 0x38;
+const unsigned char x6502_TSB = 0x39;
+const unsigned char x6502_TSX = 0x3A;
+const unsigned char x6502_TXA = 0x3B;
+const unsigned char x6502_TXS = 0x3C;
+const unsigned char x6502_TYA = 0x3D;
+const unsigned char x6502_WAI = 0x3E;
+
+const unsigned char x6502_opcodes[512] PROGMEM = { // addressing mode and operation for each opcode, unused opcodes are NOPs of the same length as on the 65C02
+	x6502_IMM,x6502_BRK, x6502_IZX,x6502_ORA, x6502_IMM,x6502_NOP, x6502_IMP,x6502_NOP, x6502_ZP,x6502_TSB,  x6502_ZP,x6502_ORA,  x6502_ZP,x6502_ASL,  x6502_ZP,x6502_RMB, // 0x00
+	x6502_IMP,x6502_PHP, x6502_IMM,x6502_ORA, x6502_ACC,x6502_ASL, x6502_IMP,x6502_NOP, x6502_ABS,x6502_TSB, x6502_ABS,x6502_ORA, x6502_ABS,x6502_ASL, x6502_ZPR,x6502_BBR, // 0x08
+	x6502_REL,x6502_BXX, x6502_IZY,x6502_ORA, x6502_IZP,x6502_ORA, x6502_IMP,x6502_NOP, x6502_ZP,x6502_TRB,  x6502_ZPX,x6502_ORA, x6502_ZPX,x6502_ASL, x6502_ZP,x6502_RMB, // 0x10
+	x6502_IMP,x6502_CLC, x6502_ABY,x6502_ORA, x6502_ACC,x6502_INC, x6502_IMP,x6502_NOP, x6502_ABS,x6502_TRB, x6502_ABX,x6502_ORA, x6502_ABX,x6502_ASL, x6502_ZPR,x6502_BBR, // 0x18
+	x6502_ABS,x6502_JSR, x6502_IZX,x6502_AND, x6502_IMM,x6502_NOP, x6502_IMP,x6502_NOP, x6502_ZP,x6502_BIT,  x6502_ZP,x6502_AND,  x6502_ZP,x6502_ROL,  x6502_ZP,x6502_RMB, // 0x20
+	x6502_IMP,x6502_PLP, x6502_IMM,x6502_AND, x6502_ACC,x6502_ROL, x6502_IMP,x6502_NOP, x6502_ABS,x6502_BIT, x6502_ABS,x6502_AND, x6502_ABS,x6502_ROL, x6502_ZPR,x6502_BBR, // 0x28
+	x6502_REL,x6502_BXX, x6502_IZY,x6502_AND, x6502_IZP,x6502_AND, x6502_IMP,x6502_NOP, x6502_ZPX,x6502_BIT, x6502_ZPX,x6502_AND, x6502_ZPX,x6502_ROL, x6502_ZP,x6502_RMB, // 0x30
+	x6502_IMP,x6502_SEC, x6502_ABY,x6502_AND, x6502_ACC,x6502_DEC, x6502_IMP,x6502_NOP, x6502_ABX,x6502_BIT, x6502_ABX,x6502_AND, x6502_ABX,x6502_ROL, x6502_ZPR,x6502_BBR, // 0x38
+	x6502_IMP,x6502_RTI, x6502_IZX,x6502_EOR, x6502_IMM,x6502_NOP, x6502_IMP,x6502_NOP, x6502_ZP,x6502_NOP,  x6502_ZP,x6502_EOR,  x6502_ZP,x6502_LSR,  x6502_ZP,x6502_RMB, // 0x40
+	x6502_IMP,x6502_PHA, x6502_IMM,x6502_EOR, x6502_ACC,x6502_LSR, x6502_IMP,x6502_NOP, x6502_ABS,x6502_JMP, x6502_ABS,x6502_EOR, x6502_ABS,x6502_LSR, x6502_ZPR,x6502_BBR, // 0x48
+	x6502_REL,x6502_BXX, x6502_IZY,x6502_EOR, x6502_IZP,x6502_EOR, x6502_IMP,x6502_NOP, x6502_ZPX,x6502_NOP, x6502_ZPX,x6502_EOR, x6502_ZPX,x6502_LSR, x6502_ZP,x6502_RMB, // 0x50
+	x6502_IMP,x6502_CLI, x6502_ABY,x6502_EOR, x6502_IMP,x6502_PHY, x6502_IMP,x6502_NOP, x6502_ABS,x6502_NOP, x6502_ABX,x6502_EOR, x6502_ABX,x6502_LSR, x6502_ZPR,x6502_BBR, // 0x58
+	x6502_IMP,x6502_RTS, x6502_IZX,x6502_ADC, x6502_IMM,x6502_NOP, x6502_IMP,x6502_NOP, x6502_ZP,x6502_STZ,  x6502_ZP,x6502_ADC,  x6502_ZP,x6502_ROR,  x6502_ZP,x6502_RMB, // 0x60
+	x6502_IMP,x6502_PLA, x6502_IMM,x6502_ADC, x6502_ACC,x6502_ROR, x6502_IMP,x6502_NOP, x6502_IND,x6502_JMP, x6502_ABS,x6502_ADC, x6502_ABS,x6502_ROR, x6502_ZPR,x6502_BBR, // 0x68
+	x6502_REL,x6502_BXX, x6502_IZY,x6502_ADC, x6502_IZP,x6502_ADC, x6502_IMP,x6502_NOP, x6502_ZPX,x6502_STZ, x6502_ZPX,x6502_ADC, x6502_ZPX,x6502_ROR, x6502_ZP,x6502_RMB, // 0x70
+	x6502_IMP,x6502_SEI, x6502_ABY,x6502_ADC, x6502_IMP,x6502_PLY, x6502_IMP,x6502_NOP, x6502_IAX,x6502_JMP, x6502_ABX,x6502_ADC, x6502_ABX,x6502_ROR, x6502_ZPR,x6502_BBR, // 0x78
+	x6502_REL,x6502_BRA, x6502_IZX,x6502_STA, x6502_IMM,x6502_NOP, x6502_IMP,x6502_NOP, x6502_ZP,x6502_STY,  x6502_ZP,x6502_STA,  x6502_ZP,x6502_STX,  x6502_ZP,x6502_SMB, // 0x80
+	x6502_IMP,x6502_DEY, x6502_IMM,x6502_BIT, x6502_IMP,x6502_TXA, x6502_IMP,x6502_NOP, x6502_ABS,x6502_STY, x6502_ABS,x6502_STA, x6502_ABS,x6502_STX, x6502_ZPR,x6502_BBS, // 0x88
+	x6502_REL,x6502_BXX, x6502_IZY,x6502_STA, x6502_IZP,x6502_STA, x6502_IMP,x6502_NOP, x6502_ZPX,x6502_STY, x6502_ZPX,x6502_STA, x6502_ZPY,x6502_STX, x6502_ZP,x6502_SMB, // 0x90
+	x6502_IMP,x6502_TYA, x6502_ABY,x6502_STA, x6502_IMP,x6502_TXS, x6502_IMP,x6502_NOP, x6502_ABS,x6502_STZ, x6502_ABX,x6502_STA, x6502_ABX,x6502_STZ, x6502_ZPR,x6502_BBS, // 0x98
+	x6502_IMM,x6502_LDY, x6502_IZX,x6502_LDA, x6502_IMM,x6502_LDX, x6502_IMP,x6502_NOP, x6502_ZP,x6502_LDY,  x6502_ZP,x6502_LDA,  x6502_ZP,x6502_LDX,  x6502_ZP,x6502_SMB, // 0xA0
+	x6502_IMP,x6502_TAY, x6502_IMM,x6502_LDA, x6502_IMP,x6502_TAX, x6502_IMP,x6502_NOP, x6502_ABS,x6502_LDY, x6502_ABS,x6502_LDA, x6502_ABS,x6502_LDX, x6502_ZPR,x6502_BBS, // 0xA8
+	x6502_REL,x6502_BXX, x6502_IZY,x6502_LDA, x6502_IZP,x6502_LDA, x6502_IMP,x6502_NOP, x6502_ZPX,x6502_LDY, x6502_ZPX,x6502_LDA, x6502_ZPY,x6502_LDX, x6502_ZP,x6502_SMB, // 0xB0
+	x6502_IMP,x6502_CLV, x6502_ABY,x6502_LDA, x6502_IMP,x6502_TSX, x6502_IMP,x6502_NOP, x6502_ABX,x6502_LDY, x6502_ABX,x6502_LDA, x6502_ABY,x6502_LDX, x6502_ZPR,x6502_BBS, // 0xB8
+	x6502_IMM,x6502_CPY, x6502_IZX,x6502_CMP, x6502_IMM,x6502_NOP, x6502_IMP,x6502_NOP, x6502_ZP,x6502_CPY,  x6502_ZP,x6502_CMP,  x6502_ZP,x6502_DEC,  x6502_ZP,x6502_SMB, // 0xC0
+	x6502_IMP,x6502_INY, x6502_IMM,x6502_CMP, x6502_IMP,x6502_DEX, x6502_IMP,x6502_WAI, x6502_ABS,x6502_CPY, x6502_ABS,x6502_CMP, x6502_ABS,x6502_DEC, x6502_ZPR,x6502_BBS, // 0xC8
+	x6502_REL,x6502_BXX, x6502_IZY,x6502_CMP, x6502_IZP,x6502_CMP, x6502_IMP,x6502_NOP, x6502_ZPX,x6502_NOP, x6502_ZPX,x6502_CMP, x6502_ZPX,x6502_DEC, x6502_ZP,x6502_SMB, // 0xD0
+	x6502_IMP,x6502_CLD, x6502_ABY,x6502_CMP, x6502_IMP,x6502_PHX, x6502_IMP,x6502_STP, x6502_ABS,x6502_NOP, x6502_ABX,x6502_CMP, x6502_ABX,x6502_DEC, x6502_ZPR,x6502_BBS, // 0xD8
+	x6502_IMM,x6502_CPX, x6502_IZX,x6502_SBC, x6502_IMM,x6502_NOP, x6502_IMP,x6502_NOP, x6502_ZP,x6502_CPX,  x6502_ZP,x6502_SBC,  x6502_ZP,x6502_INC,  x6502_ZP,x6502_SMB, // 0xE0
+	x6502_IMP,x6502_INX, x6502_IMM,x6502_SBC, x6502_IMP,x6502_NOP, x6502_IMP,x6502_NOP, x6502_ABS,x6502_CPX, x6502_ABS,x6502_SBC, x6502_ABS,x6502_INC, x6502_ZPR,x6502_BBS, // 0xE8
+	x6502_REL,x6502_BXX, x6502_IZY,x6502_SBC, x6502_IZP,x6502_SBC, x6502_IMP,x6502_NOP, x6502_ZPX,x6502_NOP, x6502_ZPX,x6502_SBC, x6502_ZPX,x6502_INC, x6502_ZP,x6502_SMB, // 0xF0
+	x6502_IMP,x6502_SED, x6502_ABY,x6502_SBC, x6502_IMP,x6502_PLX, x6502_IMP,x6502_NOP, x6502_ABS,x6502_NOP, x6502_ABX,x6502_SBC, x6502_ABX,x6502_INC, x6502_ZPR,x6502_BBS  // 0xF8
 };
 
-void x6502_tay()
-{
-	x6502_Y = x6502_A;
-	
-	x6502_neg(x6502_A&0x80);
-	x6502_zero(x6502_A);
-	
-	return;
-};
+const unsigned char x6502_branches[4] PROGMEM = { 0x80, 0x40, 0x01, 0x02 }; // N, V, C, and Z for bits 6 and 7 of a branch opcode
 
-void x6502_txa()
+void x6502_next()
 {
-	x6502_A = x6502_X;
-	
-	x6502_neg(x6502_A&0x80);
-	x6502_zero(x6502_A);
-	
-	return;
+	x6502_L += 0x01;
+	if (x6502_L == 0x00)
+	{
+		x6502_H += 0x01;
+	}
 };
 
-void x6502_tya()
+void x6502_index(unsigned char B)
 {
-	x6502_A = x6502_Y;
-	
-	x6502_neg(x6502_A&0x80);
-	x6502_zero(x6502_A);
-	
-	return;
+	if ((int)x6502_U + (int)B > 255)
+	{
+		x6502_U += B;
+		x6502_V++;
+	}
+	else x6502_U += B;
 };
 
-void x6502_tsx()
+void x6502_pointer(unsigned char B) // zero page pointer, wrapping within zero page
 {
-	x6502_X = x6502_S;
-	
-	x6502_neg(x6502_X&0x80);
-	x6502_zero(x6502_X);
-	
-	return;
+	x6502_U = x6502_read(B, 0x00);
+	x6502_V = x6502_read((unsigned char)(B+0x01), 0x00);
 };
 
-void x6502_txs()
+void x6502_address(unsigned char mode)
 {
-	x6502_S = x6502_X;
-	
-	x6502_neg(x6502_X&0x80);
-	x6502_zero(x6502_X);
-	
-	return;
-};
-	
-int x6502_instruction()
-{
-	unsigned char B, C;
-
-	unsigned char inst = x6502_read(x6502_L, x6502_H);
-	x6502_next();
-
-	switch (inst)
+	switch (mode)
 	{
-		case 0x00: // BRK
-		{
-			return 0;
-		}
-		case 0x01: // ORA(zpx)
+		case x6502_IMM:
+		case x6502_REL:
 		{
-			x6502_zpx();
-			x6502_A = x6502_ora(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
+			x6502_U = x6502_L;
+			x6502_V = x6502_H;
+			x6502_next();
 			break;
 		}
-		case 0x05: // ORAzp
+		case x6502_ZP:
 		{
-			x6502_zp();
-			x6502_A = x6502_ora(x6502_read(x6502_U, 0x00));
+			x6502_U = x6502_read(x6502_L, x6502_H);
+			x6502_V = 0x00;
+			x6502_next();
 			break;
 		}
-		case 0x06: // ASLzp
-		{
-			x6502_zp();
-			x6502_write(x6502_U, 0x00, x6502_asl(x6502_read(x6502_U, 0x00)));
-			break;
-		}	
-		case 0x08: // PHP
+		case x6502_ZPX:
 		{
-			x6502_push(x6502_F);
+			x6502_U = (unsigned char)(x6502_read(x6502_L, x6502_H) + x6502_X);
+			x6502_V = 0x00;
+			x6502_next();
 			break;
 		}
-		case 0x09: // ORA#
+		case x6502_ZPY:
 		{
-			x6502_imm();
-			x6502_A = x6502_ora(x6502_U);
+			x6502_U = (unsigned char)(x6502_read(x6502_L, x6502_H) + x6502_Y);
+			x6502_V = 0x00;
+			x6502_next();
 			break;
 		}
-		case 0x0A: // ASLA
+		case x6502_ABS:
+		case x6502_ABX:
+		case x6502_ABY:
+		case x6502_IND:
+		case x6502_IAX:
 		{
-			x6502_A = x6502_asl(x6502_A);
+			x6502_U = x6502_read(x6502_L, x6502_H);
+			x6502_next();
+			x6502_V = x6502_read(x6502_L, x6502_H);
+			x6502_next();
+
+			if (mode == x6502_ABX || mode == x6502_IAX) x6502_index(x6502_X);
+			else if (mode == x6502_ABY) x6502_index(x6502_Y);
+
+			if (mode == x6502_IND || mode == x6502_IAX)
+			{
+				x6502_W = x6502_U;
+				x6502_U = x6502_read(x6502_W, x6502_V);
+				x6502_V = x6502_read((unsigned char)(x6502_W+0x01), (unsigned char)(x6502_V+(x6502_W == 0xFF ? 0x01 : 0x00)));
+			}
 			break;
 		}
-		case 0x0D: // ORAa
+		case x6502_IZX:
 		{
-			x6502_abs();
-			x6502_A = x6502_ora(x6502_read(x6502_U, x6502_V));
+			x6502_pointer((unsigned char)(x6502_read(x6502_L, x6502_H) + x6502_X));
+			x6502_next();
 			break;
 		}
-		case 0x0E: // ASLa
+		case x6502_IZY:
+		case x6502_IZP:
 		{
-			x6502_abs();
-			x6502_write(x6502_U, x6502_V, x6502_asl(x6502_read(x6502_U, x6502_V)));
+			x6502_pointer(x6502_read(x6502_L, x6502_H));
+			x6502_next();
+
+			if (mode == x6502_IZY) x6502_index(x6502_Y);
 			break;
 		}
-		case 0x10: // BPL
+		case x6502_ZPR:
 		{
-			x6502_rel();
-			if ((x6502_F&0x80) == 0x00) x6502_branch(x6502_U);
+			x6502_W = x6502_read(x6502_L, x6502_H);
+			x6502_next();
+			x6502_U = x6502_L;
+			x6502_V = x6502_H;
+			x6502_next();
 			break;
 		}
-		case 0x11: // ORA(zp)y
+		default: // implied and accumulator
 		{
-			x6502_zp();
-			x6502_A = x6502_ora(x6502_read(x6502_read(x6502_U, 0x00) + x6502_Y, 0x00));
 			break;
 		}
-		case 0x12: // ORA(zp)
+	}
+};
+
+void x6502_branch(unsigned char B)
+{
+	if (B >= 0x80)
+	{
+		if ((int)x6502_L - (int)(0xFF - B + 1) < 0)
 		{
-			x6502_zp();
-			x6502_A = x6502_ora(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
+			x6502_L -= (0xFF - B + 1);
+			x6502_H--;
 		}
-		case 0x15: // ORAzpx
+		else x6502_L -= (0xFF - B + 1);
+	}
+	else
+	{
+		if ((int)x6502_L + (int)B > 255)
 		{
-			x6502_zpx();
-			x6502_A = x6502_ora(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0x16: // ASLzpx
+			x6502_L += B;
+			x6502_H++;
+		}
+		else x6502_L += B;
+	}
+};
+
+void x6502_push(unsigned char B)
+{
+	x6502_write(x6502_S, 0x01, B);
+	x6502_S--;
+};
+
+unsigned char x6502_pull()
+{
+	x6502_S++;
+	return x6502_read(x6502_S, 0x01);
+};
+
+void x6502_over(unsigned char B)
+{
+	if (B > 0x00) x6502_F = x6502_F | 0x40;
+	else x6502_F = x6502_F & 0xBF;
+};
+
+void x6502_carry(unsigned char B)
+{
+	if (B > 0x00) x6502_F = x6502_F | 0x01;
+	else x6502_F = x6502_F & 0xFE;
+};
+
+unsigned char x6502_flags(unsigned char B) // negative and zero
+{
+	x6502_F = (unsigned char)((x6502_F & 0x7D) | (B & 0x80) | (B == 0x00 ? 0x02 : 0x00));
+
+	return B;
+};
+
+void x6502_adc(unsigned char B)
+{
+	int temp_value;
+
+	if (x6502_F & 0x08) // decimal
+	{
+		int temp_low = (int)(x6502_A & 0x0F) + (int)(B & 0x0F) + (int)(x6502_F & 0x01);
+
+		if (temp_low >= 0x0A) temp_low = ((temp_low + 0x06) & 0x0F) + 0x10;
+
+		temp_value = (int)(x6502_A & 0xF0) + (int)(B & 0xF0) + temp_low;
+
+		x6502_over(((signed char)(x6502_A & 0xF0) + (signed char)(B & 0xF0) + temp_low < -128 || 
+			(signed char)(x6502_A & 0xF0) + (signed char)(B & 0xF0) + temp_low > 127) ? 0x01 : 0x00);
+
+		if (temp_value >= 0xA0) temp_value += 0x60;
+	}
+	else
+	{
+		temp_value = (int)x6502_A + (int)B + (int)(x6502_F & 0x01);
+
+		x6502_over((~(x6502_A ^ B)) & (x6502_A ^ temp_value) & 0x80);
+	}
+
+	x6502_carry(temp_value >= 0x100 ? 0x01 : 0x00);
+
+	x6502_A = x6502_flags((unsigned char)temp_value);
+};
+
+void x6502_sbc(unsigned char B)
+{
+	int temp_borrow = (int)(0x01 - (x6502_F & 0x01));
+	int temp_value = (int)x6502_A - (int)B - temp_borrow;
+
+	x6502_over((x6502_A ^ B) & (x6502_A ^ temp_value) & 0x80);
+
+	x6502_carry(temp_value >= 0 ? 0x01 : 0x00);
+
+	if (x6502_F & 0x08) // decimal
+	{
+		if (temp_value < 0) temp_value -= 0x60;
+		if ((int)(x6502_A & 0x0F) - (int)(B & 0x0F) - temp_borrow < 0) temp_value -= 0x06;
+	}
+
+	x6502_A = x6502_flags((unsigned char)temp_value);
+};
+
+void x6502_compare(unsigned char R, unsigned char B)
+{
+	x6502_carry(R >= B ? 0x01 : 0x00);
+
+	x6502_flags((unsigned char)(R - B));
+};
+
+int x6502_instruction()
+{
+	unsigned char B;
+
+	unsigned char inst = x6502_read(x6502_L, x6502_H);
+	x6502_next();
+
+	unsigned char mode = pgm_read_byte_near(x6502_opcodes + inst*2);
+	unsigned char op = pgm_read_byte_near(x6502_opcodes + inst*2 + 1);
+
+#ifdef x6502_stats
+	x6502_count++;
+#endif
+
+	x6502_address(mode);
+
+	switch (op)
+	{
+		case x6502_ADC: { x6502_adc(x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_SBC: { x6502_sbc(x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_AND: { x6502_A = x6502_flags(x6502_A & x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_EOR: { x6502_A = x6502_flags(x6502_A ^ x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_ORA: { x6502_A = x6502_flags(x6502_A | x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_CMP: { x6502_compare(x6502_A, x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_CPX: { x6502_compare(x6502_X, x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_CPY: { x6502_compare(x6502_Y, x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_LDA: { x6502_A = x6502_flags(x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_LDX: { x6502_X = x6502_flags(x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_LDY: { x6502_Y = x6502_flags(x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_STA: { x6502_write(x6502_U, x6502_V, x6502_A); break; }
+		case x6502_STX: { x6502_write(x6502_U, x6502_V, x6502_X); break; }
+		case x6502_STY: { x6502_write(x6502_U, x6502_V, x6502_Y); break; }
+		case x6502_STZ: { x6502_write(x6502_U, x6502_V, 0x00); break; }
+		case x6502_BIT:
 		{
-			x6502_zpx();
-			x6502_write(x6502_U, 0x00, x6502_asl(x6502_read(x6502_U, 0x00)));
+			B = x6502_read(x6502_U, x6502_V);
+
+			if (mode != x6502_IMM) x6502_F = (unsigned char)((x6502_F & 0x3F) | (B & 0xC0));
+
+			x6502_F = (unsigned char)((x6502_F & 0xFD) | ((x6502_A & B) == 0x00 ? 0x02 : 0x00));
 			break;
-		}	
-		case 0x18: // CLC
+		}
+		case x6502_TRB:
+		case x6502_TSB:
 		{
-			x6502_carry(0x00);
+			B = x6502_read(x6502_U, x6502_V);
+
+			x6502_F = (unsigned char)((x6502_F & 0xFD) | ((x6502_A & B) == 0x00 ? 0x02 : 0x00));
+
+			x6502_write(x6502_U, x6502_V, (op == x6502_TSB) ? (unsigned char)(B | x6502_A) : (unsigned char)(B & ~x6502_A));
 			break;
 		}
-		case 0x19: // ORAay
+		case x6502_ASL:
+		case x6502_LSR:
+		case x6502_ROL:
+		case x6502_ROR:
+		case x6502_INC:
+		case x6502_DEC:
 		{
-			x6502_absy();
-			x6502_A = x6502_ora(x6502_read(x6502_U, x6502_V));
+			if (mode == x6502_ACC) B = x6502_A;
+			else B = x6502_read(x6502_U, x6502_V);
+
+			if (op == x6502_ASL) { x6502_carry(B & 0x80); B = (unsigned char)(B << 1); }
+			else if (op == x6502_LSR) { x6502_carry(B & 0x01); B = (unsigned char)(B >> 1); }
+			else if (op == x6502_ROL) { x6502_W = (unsigned char)(x6502_F & 0x01); x6502_carry(B & 0x80); B = (unsigned char)((B << 1) | x6502_W); }
+			else if (op == x6502_ROR) { x6502_W = (unsigned char)((x6502_F & 0x01) << 7); x6502_carry(B & 0x01); B = (unsigned char)((B >> 1) | x6502_W); }
+			else if (op == x6502_INC) B++;
+			else B--;
+
+			x6502_flags(B);
+
+			if (mode == x6502_ACC) x6502_A = B;
+			else x6502_write(x6502_U, x6502_V, B);
 			break;
 		}
-		case 0x1A: // INCA
+		case x6502_RMB:
+		case x6502_SMB:
 		{
-			x6502_A = x6502_inc(x6502_A);
+			B = x6502_read(x6502_U, x6502_V);
+
+			if (op == x6502_SMB) B = (unsigned char)(B | (0x01 << ((inst >> 4) & 0x07)));
+			else B = (unsigned char)(B & ~(0x01 << ((inst >> 4) & 0x07)));
+
+			x6502_write(x6502_U, x6502_V, B);
 			break;
 		}
-		case 0x1D: // ORAax
+		case x6502_BBR:
+		case x6502_BBS:
 		{
-			x6502_absx();
-			x6502_A = x6502_ora(x6502_read(x6502_U, x6502_V));
+			B = (unsigned char)((x6502_read(x6502_W, 0x00) >> ((inst >> 4) & 0x07)) & 0x01);
+
+			if (B == ((op == x6502_BBS) ? 0x01 : 0x00)) x6502_branch(x6502_read(x6502_U, x6502_V));
 			break;
 		}
-		case 0x1E: // ASLax
+		case x6502_BXX: // flag from bits 6 and 7, taken when it equals bit 5
 		{
-			x6502_absx();
-			x6502_write(x6502_U, x6502_V, x6502_asl(x6502_read(x6502_U, x6502_V)));
+			B = pgm_read_byte_near(x6502_branches + (inst >> 6));
+
+			if (((x6502_F & B) != 0x00) == ((inst & 0x20) != 0x00)) x6502_branch(x6502_read(x6502_U, x6502_V));
 			break;
 		}
-		case 0x20: // JSRa
+		case x6502_BRA: { x6502_branch(x6502_read(x6502_U, x6502_V)); break; }
+		case x6502_JMP: { x6502_L = x6502_U; x6502_H = x6502_V; break; }
+		case x6502_JSR:
 		{
-			x6502_abs();
+			if (x6502_L == 0x00) x6502_H--;
+			x6502_L--;
+
 			x6502_push(x6502_H);
 			x6502_push(x6502_L);
-			x6502_jump(x6502_U, x6502_V);
-			break;
-		}
-		case 0x21: // AND(zpx)
-		{
-			x6502_zpx();
-			x6502_A = x6502_and(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
+
+			x6502_L = x6502_U;
+			x6502_H = x6502_V;
 			break;
 		}
-		case 0x24: // BITzp
+		case x6502_RTS:
 		{
-			x6502_zp();
-			x6502_bit(x6502_read(x6502_U, 0x00));
+			x6502_L = x6502_pull();
+			x6502_H = x6502_pull();
+			x6502_next();
 			break;
 		}
-		case 0x25: // ANDzp
+		case x6502_RTI:
 		{
-			x6502_zp();
-			x6502_A = x6502_and(x6502_read(x6502_U, 0x00));
+			x6502_F = (unsigned char)(x6502_pull() & 0xCF);
+			x6502_L = x6502_pull();
+			x6502_H = x6502_pull();
 			break;
 		}
-		case 0x26: // ROLzp
+		case x6502_BRK:
 		{
-			x6502_zp();
-			x6502_write(x6502_U, 0x00, x6502_rol(x6502_read(x6502_U, 0x00)));
-			break;
-		}	
-		case 0x28: // PLP
+			if (!x6502_brk_vector) return 0; // back to the monitor
+
+			x6502_push(x6502_H);
+			x6502_push(x6502_L);
+			x6502_push((unsigned char)(x6502_F | 0x30));
+
+			x6502_F = (unsigned char)((x6502_F | 0x04) & 0xF7);
+
+			x6502_L = x6502_read(0xFE, 0xFF);
+			x6502_H = x6502_read(0xFF, 0xFF);
+			break;
+		}
+		case x6502_PHA: { x6502_push(x6502_A); break; }
+		case x6502_PHX: { x6502_push(x6502_X); break; }
+		case x6502_PHY: { x6502_push(x6502_Y); break; }
+		case x6502_PHP: { x6502_push((unsigned char)(x6502_F | 0x30)); break; }
+		case x6502_PLA: { x6502_A = x6502_flags(x6502_pull()); break; }
+		case x6502_PLX: { x6502_X = x6502_flags(x6502_pull()); break; }
+		case x6502_PLY: { x6502_Y = x6502_flags(x6502_pull()); break; }
+		case x6502_PLP: { x6502_F = (unsigned char)(x6502_pull() & 0xCF); break; }
+		case x6502_TAX: { x6502_X = x6502_flags(x6502_A); break; }
+		case x6502_TAY: { x6502_Y = x6502_flags(x6502_A); break; }
+		case x6502_TXA: { x6502_A = x6502_flags(x6502_X); break; }
+		case x6502_TYA: { x6502_A = x6502_flags(x6502_Y); break; }
+		case x6502_TSX: { x6502_X = x6502_flags(x6502_S); break; }
+		case x6502_TXS: { x6502_S = x6502_X; break; }
+		case x6502_INX: { x6502_X = x6502_flags((unsigned char)(x6502_X + 0x01)); break; }
+		case x6502_INY: { x6502_Y = x6502_flags((unsigned char)(x6502_Y + 0x01)); break; }
+		case x6502_DEX: { x6502_X = x6502_flags((unsigned char)(x6502_X - 0x01)); break; }
+		case x6502_DEY: { x6502_Y = x6502_flags((unsigned char)(x6502_Y - 0x01)); break; }
+		case x6502_CLC: { x6502_F &= 0xFE; break; }
+		case x6502_SEC: { x6502_F |= 0x01; break; }
+		case x6502_CLI: { x6502_F &= 0xFB; break; }
+		case x6502_SEI: { x6502_F |= 0x04; break; }
+		case x6502_CLV: { x6502_F &= 0xBF; break; }
+		case x6502_CLD: { x6502_F &= 0xF7; break; }
+		case x6502_SED: { x6502_F |= 0x08; break; }
+		case x6502_WAI: // no interrupts to wait for
+		case x6502_STP:
 		{
-			x6502_F = x6502_pull();
-			break;
+			return 0;
 		}
-		case 0x29: // AND#
+		default: // NOP
 		{
-			x6502_imm();
-			x6502_A = x6502_and(x6502_U);
 			break;
 		}
-		case 0x2A: // ROLA
+	}
+
+	return 1;
+};
+
+void x6502_reset()
+{
+	x6502_A = 0x00;
+	x6502_X = 0x00;
+	x6502_Y = 0x00;
+	x6502_L = 0x00;
+	x6502_H = 0x00;
+	x6502_S = 0xFF;
+	x6502_F = 0x00;
+};
+
+void x6502_run(unsigned char BL, unsigned char BH)
+{
+	x6502_L = BL;
+	x6502_H = BH;
+
+	while (x6502_instruction()) {} 
+
+	x6502_flush();
+
+	return;
+};
+
+
+const unsigned char command_size = 64;
+unsigned char command_string[command_size];
+
+const unsigned int editor_start = 0x5000; // after the screen and the line index
+unsigned int editor_end = 0x6000; // change later if need be
+unsigned int editor_total = editor_start + 256;
+char editor_character = 0x00;
+const char editor_prompt = '\\';
+const char editor_prompt_caps = '|';
+
+unsigned int monitor_addr = 0x0000; // the address typed last, kept from one line to the next
+
+const unsigned char basic_variables = 0x00; // 256 byte page
+
+const unsigned int basic_kept = 0x0000; // EEPROM, the variables as they were when the journal last filled
+const unsigned int basic_journal = 0x0100; // EEPROM, then a lap, place, and value for each byte changed since
+const int basic_journal_size = 255; // records, up to $03FC, so every cell is written once a lap
+const unsigned int basic_journal_lap = 0x03FF; // EEPROM, the lap of the records that count, 0x00 or 0xFF before the first
+
+const unsigned char basic_token_print = 0x80; // keywords are kept as one byte each
+const unsigned char basic_token_input = 0x81;
+const unsigned char basic_token_if = 0x82;
+const unsigned char basic_token_then = 0x83;
+const unsigned char basic_token_end = 0x84;
+const unsigned char basic_token_goto = 0x85;
+const unsigned char basic_token_sing = 0x86;
+const unsigned char basic_token_mon = 0x87;
+const unsigned char basic_token_byte = 0x88; // numbers of two digits or more, followed by 7 bits in each of one,
+const unsigned char basic_token_word = 0x89; // two, or three bytes with the top bit set, so never 0x00 or 0x10
+const unsigned char basic_token_long = 0x8A;
+
+const unsigned char basic_keywords[41] PROGMEM = "PRINTINPUTIF   THEN END  GOTO SING MON  "; // five characters each
+
+const unsigned char basic_index = 0x48; // $4800-$4FFF, line number and address for each line, after the screen
+const int basic_index_size = 512; // lines, four bytes each
+int basic_index_total = -1; // lines in the index, -1 to rebuild, -2 when too many lines
+const unsigned char basic_stashed = 0x4E; // $4E00-$4FFF, the top of the index, holds shared_memory while the FAT layer has it
+
+const unsigned char basic_compiled = 0x01; // 256 byte page, expressions turned into postfix while running, cleared by RUN and MON
+const int basic_compiled_slots = 16; // program address and code position of each, three bytes each from the bottom
+const int basic_jumps = 4; // last GOTO targets found, so loops skip the search
+const unsigned char basic_jumped = 0x30; // line number then address of each, four bytes each after the slots
+const unsigned char basic_compiled_code = 0x40; // postfix from here to the end of the page
+const unsigned char basic_compiled_room = 0x50; // any line fits in this much, less left starts over
+const unsigned char basic_compiled_full = 12; // slots used before starting over, so searches stay short
+unsigned char * const basic_code = &shared_memory[basic_compiled*256]; // read here directly, it is never remote
+unsigned char basic_compiled_next = basic_compiled_code;
+unsigned char basic_jump_next = 0x00;
+
+const int basic_depth = 8; // operators and parentheses waiting, and values while running
+
+const unsigned char basic_code_end = 0x00; // postfix uses digits, variables (lower case with an offset), '!', and +-*/%
+const unsigned char basic_code_byte = 0x01; // followed by the value
+const unsigned char basic_code_word = 0x02; // followed by low then high bytes
+const unsigned char basic_code_negate = '_';
+
+const unsigned char editor_text[480] PROGMEM = 
+	"BASIC Keywords:\n  IF [THEN or END], GOTO, MON\" \",\n  PRINT, INPUT, SING\nVariable Arrays: ABCDWXYZ! with ()\nMath Operators: +*-/% and ()\nComparator Operators: =#<>\nMonitor Example:\n  MON \"0000:EE0F00DC;JJJ,0000.000F\"\nPrime Numbers Example:\n  10 PRINT 'TYPE NUMBER'\n  20 INPUT X\n  30 A = 2\n  40 PRINT A, ';'\n  50 A = A + 1\n  60 IF A > X THEN GOTO 10000\n  70 B = A - 1\n  80 IF A % B = 0 THEN GOTO 50\n  90 B = B - 1\n  100 IF B = 1 THEN GOTO 40\n  110 GOTO 80_";
+
+
+unsigned char editor_key() // reads the next character into editor_character, for INPUT
+{
+	if (editor_character == editor_prompt || editor_character == editor_prompt_caps || editor_character == 0x1B)
+	{
+		return 0x01; // slash (or ESC) to break
+	}
+
+	editor_character = keyboard_character();
+	
+	return 0x00;
+};
+
+unsigned char editor_break() // for busy loops, only polls once keyboard_push() has seen a break key
+{
+	if (keyboard_dirty_y != 0xFF || keyboard_cursor != 0x00) keyboard_late();
+
+	if (serial_input) keyboard_receive(); // a break key by serial sets keyboard_stop from USART_RX_vect
+
+	if (keyboard_stop == 0x00 && editor_character == 0x00)
+	{
+		return 0x00; // other keys wait in the buffer until something reads them
+	}
+
+	return editor_key();
+};
+
+unsigned int editor_used() // end of the program, only zeros after it up to editor_total
+{
+	if (editor_total < editor_end) return editor_total - 256;
+	else return editor_total;
+};
+
+void editor_checkmemory()
+{
+	// checking for RAM expansion
+	x6502_write((unsigned char)(editor_start%256), (unsigned char)(editor_start/256), 0xA5);
+
+	x6502_invalidate();
+
+	if (display_receivepacket((unsigned char)((editor_start/256+0x20)&0x3F), (unsigned char)(editor_start%256)) == 0xA5) // around the cache, which would fold it onto editor_start
+	{
+		editor_end = editor_start + 0x1000; // only 8KB available, less the screen and the line index
+	}
+	else
+	{
+		editor_end = editor_start + 0x2800; // full 16KB available, less the screen, the line index, and the sector cache
+
+		x6502_cache_alias = 0x3F;
+	}
+
+	x6502_invalidate();
+
+	x6502_write((unsigned char)(editor_start%256), (unsigned char)(editor_start/256), 0x00);
+
+	fat_forget();
+};
+
+unsigned char editor_load() // LOAD, the program from the first blocks of the card and the variables from EEPROM
+{
+	unsigned char v = 0x00;
+
+	x6502_invalidate();
+
+	basic_index_total = -1;
+
+	for (int init=0; init<5; init++)
+	{
+		if (editor_break()) break;
+
+		if (sdcard_ready == 0x00 && !sdcard_initialize()) continue; // only once, unless a transfer failed
+
+		if (sdcard_readblocks(0, (editor_end - editor_start) / 512, editor_start, x6502_cache, x6502_cache_span)) // empty after x6502_invalidate()
 		{
-			x6502_A = x6502_rol(x6502_A);
+			basic_replay(basic_variables);
+
+			x6502_shared_written &= (unsigned char)(~(0x01 << basic_variables)); // EEPROM has them as they are now
+
+			v = 0x01;
+
 			break;
 		}
-		case 0x2C: // BITa
+	}
+
+	editor_crunch();
+
+	return v;
+};
+
+unsigned char editor_save() // SAVE, the program to the first blocks of the card and the variables to EEPROM
+{
+	unsigned char v = 0x00;
+
+	basic_keep();
+
+	x6502_invalidate();
+
+	for (int init=0; init<5; init++)
+	{
+		if (editor_break()) break;
+
+		if (sdcard_ready == 0x00 && !sdcard_initialize()) continue; // only once, unless a transfer failed
+
+		if (sdcard_writeblocks(0, (editor_end - editor_start) / 512, editor_start, x6502_cache, x6502_cache_span)) // empty after x6502_invalidate()
 		{
-			x6502_abs();
-			x6502_bit(x6502_read(x6502_U, x6502_V));
+			v = 0x01;
+
 			break;
 		}
-		case 0x2D: // ANDa
+	}
+
+	fat_forget(); // the first blocks of the card are not what was cached any more
+
+	return v;
+};
+	
+unsigned char fat_cluster = 0x00; // sectors in each cluster
+unsigned char fat_copies = 0x00; // FATs kept alike
+unsigned long fat_begin = 0; // first sector of the first FAT
+unsigned long fat_length = 0; // sectors in each FAT
+unsigned long fat_root = 0; // first sector of the root directory for FAT16, its first cluster for FAT32
+unsigned char fat_rootsectors = 0x00; // sectors of the FAT16 root directory, between the FATs and cluster 2
+unsigned long fat_clusters = 0; // one past the last cluster
+unsigned long fat_sector = 0xFFFFFFFF; // sector held in shared_memory, the only buffer in SRAM
+unsigned int fat_serial = 0; // low half of the volume serial number of the card that the sector cache holds sectors of
+
+const unsigned long fat_end = 0x0FFFFFF8; // this and above end a chain, FAT16 values are widened to match
+
+const int fat_cache_sectors = 4; // sectors kept in extended RAM from one file command to the next, only when editor_checkmemory() finds 16KB
+const unsigned int fat_cache_start = 0x7800; // $7800-$7FFF, above editor_end
+
+unsigned int fat_cache_tag[fat_cache_sectors]; // sector in each slot counted from fat_begin, 0xFFFF when empty
+unsigned char fat_cache_order = 0xE4; // two bits for each slot, the slot used last in the lowest two, the highest two are replaced first
+unsigned char fat_cache_dirty = 0x00; // one bit per slot, written to the card by fat_sync(), and fat_changed
+const unsigned char fat_changed = 0x80; // the sector in shared_memory was changed
+
+unsigned int fat_word(unsigned int offset) // little endian, from the sector in shared_memory
+{
+	return (unsigned int)shared_memory[offset] + (unsigned int)shared_memory[offset+1] * 256;
+};
+
+unsigned long fat_long(unsigned int offset)
+{
+	return (unsigned long)fat_word(offset) + (unsigned long)fat_word(offset+2) * 65536;
+};
+
+unsigned int fat_tagof(unsigned long sector) // what fat_cache_tag holds for a sector, 0xFFFF for one too far out to cache
+{
+	if (sector < fat_begin || sector - fat_begin >= 0xFFFF) return 0xFFFF;
+	else return (unsigned int)(sector - fat_begin);
+};
+
+int fat_cacheslots() // none with 8KB, where the top of extended RAM repeats the bottom
+{
+	if (x6502_cache_alias == 0x3F) return fat_cache_sectors;
+	else return 0;
+};
+
+unsigned char fat_slotpage(int slot) // high byte of the remote address of a slot, the low byte is zero
+{
+	return (unsigned char)(((fat_cache_start + (unsigned int)slot * 512) & 0x3F00) >> 8);
+};
+
+void fat_touch(int slot) // makes it the slot used last, the others keep their order behind it
+{
+	unsigned char temp_order = (unsigned char)slot;
+	unsigned char temp_slot;
+	int temp_shift = 2;
+
+	for (int i=0; i<fat_cache_sectors; i++)
+	{
+		temp_slot = (unsigned char)((fat_cache_order >> (i*2)) & 0x03);
+
+		if (temp_slot == (unsigned char)slot) continue;
+
+		temp_order |= (unsigned char)(temp_slot << temp_shift);
+		temp_shift += 2;
+	}
+
+	fat_cache_order = temp_order;
+};
+
+void fat_forget() // empties the sector cache without writing it back, for when the card or extended RAM was changed some other way
+{
+	for (int i=0; i<fat_cache_sectors; i++) fat_cache_tag[i] = 0xFFFF;
+
+	fat_cache_order = 0xE4; // slot 3 first
+
+	fat_cache_dirty = 0x00; // fat_changed too
+
+	fat_sector = 0xFFFFFFFF;
+};
+
+unsigned char fat_writeback(unsigned long sector) // shared_memory to the card, to every FAT when the sector is part of one
+{
+	if (sector >= fat_begin && sector < fat_begin + fat_length)
+	{
+		for (int i=0; i<fat_copies; i++)
 		{
-			x6502_abs();
-			x6502_A = x6502_and(x6502_read(x6502_U, x6502_V));
-			break;
+			if (!sdcard_writesector(sector + fat_length * i, shared_memory)) return 0x00;
 		}
-		case 0x2E: // ROLa
-		{
-			x6502_abs();	
-			x6502_write(x6502_U, x6502_V, x6502_rol(x6502_read(x6502_U, x6502_V)));
-			break;
-		}
-		case 0x30: // BMI
-		{
-			x6502_rel();	
-			if ((x6502_F&0x80) != 0x00) x6502_branch(x6502_U);
-			break;
-		}
-		case 0x31: // AND(zp)y
+
+		return 0x01;
+	}
+
+	return (unsigned char)sdcard_writesector(sector, shared_memory);
+};
+
+unsigned char fat_flush() // puts a changed sector in shared_memory back into its slot, or onto the card when it has none
+{
+	unsigned int temp_tag = fat_tagof(fat_sector);
+
+	if ((fat_cache_dirty & fat_changed) == 0x00) return 0x01;
+
+	fat_cache_dirty &= (unsigned char)(~fat_changed);
+
+	for (int i=0; i<fat_cacheslots(); i++)
+	{
+		if (temp_tag != 0xFFFF && fat_cache_tag[i] == temp_tag)
 		{
-			x6502_zp();
-			x6502_A = x6502_and(x6502_read(x6502_read(x6502_U, 0x00) + x6502_Y, 0x00));
-			break;
+			display_sendblock(fat_slotpage(i), 0x00, shared_memory, 512);
+
+			fat_cache_dirty |= (unsigned char)(0x01 << i);
+
+			return 0x01;
 		}
-		case 0x32: // AND(zp)
+	}
+
+	return fat_writeback(fat_sector);
+};
+
+unsigned char fat_load(unsigned long sector) // into shared_memory, from the sector cache when it is there
+{
+	unsigned int temp_tag = fat_tagof(sector);
+	int temp_slot = -1;
+
+	if (sector == fat_sector) return 0x01;
+
+	if (!fat_flush()) return 0x00;
+
+	fat_sector = 0xFFFFFFFF;
+
+	for (int i=0; i<fat_cacheslots(); i++)
+	{
+		if (temp_tag != 0xFFFF && fat_cache_tag[i] == temp_tag)
 		{
-			x6502_zp();
-			x6502_A = x6502_and(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
+			display_receiveblock(fat_slotpage(i), 0x00, shared_memory, 512);
+
+			fat_touch(i);
+
+			fat_sector = sector;
+
+			return 0x01;
 		}
-		case 0x34: // BITzpx
+	}
+
+	if (fat_cacheslots() > 0 && temp_tag != 0xFFFF) temp_slot = (int)(fat_cache_order >> 6); // least recently used
+
+	if (temp_slot >= 0)
+	{
+		if (fat_cache_dirty & (0x01 << temp_slot)) // written to the card before it is replaced
 		{
-			x6502_zpx();
-			x6502_bit(x6502_read(x6502_U, 0x00));
-			break;
+			display_receiveblock(fat_slotpage(temp_slot), 0x00, shared_memory, 512);
+
+			if (!fat_writeback(fat_begin + fat_cache_tag[temp_slot])) return 0x00;
+
+			fat_cache_dirty &= (unsigned char)(~(0x01 << temp_slot));
 		}
-		case 0x35: // ANDzpx
+
+		fat_cache_tag[temp_slot] = 0xFFFF;
+	}
+
+	if (!sdcard_readsector(sector, shared_memory)) return 0x00;
+
+	if (temp_slot >= 0)
+	{
+		display_sendblock(fat_slotpage(temp_slot), 0x00, shared_memory, 512);
+
+		fat_cache_tag[temp_slot] = temp_tag;
+
+		fat_touch(temp_slot);
+	}
+
+	fat_sector = sector;
+
+	return 0x01;
+};
+
+unsigned char fat_sync() // writes every changed sector to the card, which leaves shared_memory holding none of them
+{
+	unsigned char v = fat_flush();
+
+	fat_sector = 0xFFFFFFFF;
+
+	for (int i=0; i<fat_cacheslots(); i++)
+	{
+		if (fat_cache_dirty & (0x01 << i))
 		{
-			x6502_zpx();
-			x6502_A = x6502_and(x6502_read(x6502_U, 0x00));
-			break;
+			display_receiveblock(fat_slotpage(i), 0x00, shared_memory, 512);
+
+			if (fat_writeback(fat_begin + fat_cache_tag[i])) fat_cache_dirty &= (unsigned char)(~(0x01 << i));
+			else v = 0x00;
 		}
-		case 0x36: // ROLzpx
-		{
-			x6502_zpx();
-			x6502_write(x6502_U, 0x00, x6502_rol(x6502_read(x6502_U, 0x00)));
-			break;
-		}	
-		case 0x38: // SEC
+	}
+
+	return v;
+};
+
+void fat_release() // shared_memory goes back to BASIC and the 6502 as fat_mount() found it
+{
+	fat_sync();
+
+	basic_unstash();
+};
+
+unsigned char fat_mount() // finds the filesystem, on the whole card or in the first partition
+{
+	unsigned long temp_start = 0;
+	unsigned long temp_total = 0;
+	unsigned int temp_serial = 0;
+
+	basic_stash(); // the zero page and stack, until fat_release()
+
+	fat_sector = 0xFFFFFFFF; // the boot sector always comes from the card, never from the sector cache
+
+	if (sdcard_ready == 0x00 || !sdcard_readsector(0, shared_memory)) // a card put in since, powered up and not in SPI mode yet, fails its first read too
+	{
+		fat_forget();
+
+		if (!sdcard_initialize()) return 0x00;
+
+		if (!sdcard_readsector(0, shared_memory)) return 0x00;
+	}
+
+	if (fat_word(0x1FE) != 0xAA55) return 0x00;
+
+	if (fat_word(0x0B) != 512 || shared_memory[0x0D] == 0x00 || shared_memory[0x10] == 0x00 || shared_memory[0x10] > 0x02) // not a boot sector, so a partition table
+	{
+		temp_start = fat_long(0x1C6);
+
+		if (!sdcard_readsector(temp_start, shared_memory)) return 0x00;
+
+		if (fat_word(0x0B) != 512 || shared_memory[0x0D] == 0x00) return 0x00;
+	}
+
+	if (fat_word(0x16) == 0) temp_serial = fat_word(0x43); // FAT32
+	else temp_serial = fat_word(0x27);
+
+	if (temp_serial != fat_serial || temp_start + fat_word(0x0E) != fat_begin) // another card was put in since the last command, without a failed transfer to show it
+	{
+		fat_forget(); // the tags count from fat_begin too
+
+		fat_serial = temp_serial;
+	}
+
+	fat_sector = temp_start;
+
+	fat_cluster = shared_memory[0x0D];
+	fat_copies = shared_memory[0x10];
+	fat_begin = temp_start + fat_word(0x0E);
+	fat_length = fat_word(0x16);
+	if (fat_length == 0) fat_length = fat_long(0x24);
+	fat_root = fat_begin + fat_length * fat_copies;
+	if (fat_word(0x11) > 255 * 16) return 0x00; // a root directory this large is not supported
+	fat_rootsectors = (unsigned char)((fat_word(0x11) + 15) / 16); // 16 entries each, none for FAT32
+	temp_total = fat_word(0x13);
+	if (temp_total == 0) temp_total = fat_long(0x20);
+	fat_clusters = (temp_total - (fat_data() - temp_start)) / fat_cluster + 2;
+
+	if (fat_clusters < 4085 + 2) return 0x00; // FAT12 is not supported
+
+	if (fat_type() == 32) fat_root = fat_long(0x2C);
+
+	return 0x01;
+};
+
+unsigned char fat_type() // 16 or 32, told apart by the count of clusters as the specification does, once fat_mount() finds a filesystem
+{
+	if (fat_clusters < 65525 + 2) return 16;
+	else return 32;
+};
+
+unsigned long fat_data() // first sector of cluster 2
+{
+	return fat_begin + fat_length * fat_copies + fat_rootsectors;
+};
+
+unsigned long fat_sectorof(unsigned long cluster)
+{
+	return fat_data() + (cluster - 2) * fat_cluster;
+};
+
+unsigned long fat_next(unsigned long cluster) // the FAT entry for 'cluster', fat_end when it cannot be read
+{
+	unsigned long temp_offset = cluster * (fat_type() / 8);
+	unsigned long temp_value;
+
+	if (!fat_load(fat_begin + temp_offset / 512)) return fat_end;
+
+	if (fat_type() == 16)
+	{
+		temp_value = fat_word((unsigned int)(temp_offset % 512));
+
+		if (temp_value >= 0xFFF8) temp_value = fat_end;
+	}
+	else
+	{
+		temp_value = fat_long((unsigned int)(temp_offset % 512)) & 0x0FFFFFFF;
+	}
+
+	return temp_value;
+};
+
+void fat_set(unsigned long cluster, unsigned long value)
+{
+	unsigned long temp_offset = cluster * (fat_type() / 8);
+	unsigned int temp_place = (unsigned int)(temp_offset % 512);
+
+	if (!fat_load(fat_begin + temp_offset / 512)) return;
+
+	shared_memory[temp_place] = (unsigned char)(value & 0xFF);
+	shared_memory[temp_place+1] = (unsigned char)((value >> 8) & 0xFF);
+
+	if (fat_type() == 32)
+	{
+		shared_memory[temp_place+2] = (unsigned char)((value >> 16) & 0xFF);
+		shared_memory[temp_place+3] = (unsigned char)((shared_memory[temp_place+3] & 0xF0) | ((value >> 24) & 0x0F)); // top four bits are reserved
+	}
+
+	fat_cache_dirty |= fat_changed;
+};
+
+unsigned long fat_allocate(unsigned long previous) // a free cluster, chained after 'previous' unless that is zero, zero when the card is full
+{
+	unsigned long temp_cluster = previous + 1; // so appending does not scan the FAT again
+
+	for (unsigned long i=2; i<fat_clusters; i++)
+	{
+		if (temp_cluster < 2 || temp_cluster >= fat_clusters) temp_cluster = 2;
+
+		if (fat_next(temp_cluster) == 0)
 		{
-			x6502_carry(0xFF);
-			break;
+			fat_set(temp_cluster, 0x0FFFFFFF); // end of chain
+
+			if (previous != 0) fat_set(previous, temp_cluster);
+
+			return temp_cluster;
 		}
-		case 0x39: // ANDay
+
+		temp_cluster++;
+	}
+
+	return 0;
+};
+
+void fat_unchain(unsigned long cluster) // frees a whole chain
+{
+	unsigned long temp_next;
+
+	while (cluster >= 2 && cluster < fat_clusters)
+	{
+		temp_next = fat_next(cluster);
+
+		fat_set(cluster, 0);
+
+		cluster = temp_next;
+	}
+};
+
+unsigned char *fat_directory(unsigned int index) // entry 'index' of the root directory in shared_memory, NULL past its end
+{
+	unsigned long temp_sector;
+	unsigned long temp_cluster = fat_root;
+
+	if (fat_type() == 16)
+	{
+		temp_sector = fat_root + index / 16;
+
+		if (temp_sector >= fat_data()) return NULL;
+	}
+	else
+	{
+		for (unsigned int i=index/16/fat_cluster; i>0; i--)
 		{
-			x6502_absy();
-			x6502_A = x6502_and(x6502_read(x6502_U, x6502_V));
-			break;
+			temp_cluster = fat_next(temp_cluster);
+
+			if (temp_cluster < 2 || temp_cluster >= fat_end) return NULL;
 		}
-		case 0x3A: // DECA
+
+		temp_sector = fat_sectorof(temp_cluster) + (index / 16) % fat_cluster;
+	}
+
+	if (!fat_load(temp_sector)) return NULL;
+
+	return &shared_memory[(index % 16) * 32];
+};
+
+unsigned int fat_find(unsigned char *name, unsigned char &found) // index of the entry named 'name', or of a free one, 0xFFFF when neither
+{
+	unsigned char *temp_entry;
+	unsigned int temp_free = 0xFFFF;
+
+	found = 0x00;
+
+	for (unsigned int i=0; i<0xFFFF; i++)
+	{
+		temp_entry = fat_directory(i);
+
+		if (temp_entry == NULL) break;
+
+		if (temp_entry[0] == 0x00) // nothing after this
 		{
-			x6502_A = x6502_dec(x6502_A);
+			if (temp_free == 0xFFFF) temp_free = i;
+
 			break;
 		}
-		case 0x3C: // BITax
+
+		if (temp_entry[0] == 0xE5) // deleted
 		{
-			x6502_absx();
-			x6502_bit(x6502_read(x6502_U, x6502_V));
-			break;
+			if (temp_free == 0xFFFF) temp_free = i;
+
+			continue;
 		}
-		case 0x3D: // ANDax
+
+		if ((temp_entry[11] & 0x18) != 0x00) continue; // long names, volume labels, and directories
+
+		for (int j=0; j<11; j++)
 		{
-			x6502_absx();	
-			x6502_A = x6502_and(x6502_read(x6502_U, x6502_V));
-			break;
+			if (temp_entry[j] != name[j]) break;
+
+			if (j == 10)
+			{
+				found = 0x01;
+
+				return i;
+			}
 		}
-		case 0x3E: // ROLax
+	}
+
+	return temp_free;
+};
+
+unsigned char fat_filename(int start, unsigned char *name) // the quoted name in command_string as 8.3, with BAS when there is no extension
+{
+	unsigned char temp_pos = 0;
+
+	for (int j=0; j<11; j++) name[j] = ' ';
+
+	name[8] = 'B';
+	name[9] = 'A';
+	name[10] = 'S';
+
+	for (int j=start; j<command_size; j++)
+	{
+		if (command_string[j] == '"' || command_string[j] == '\'')
 		{
-			x6502_absx();
-			x6502_write(x6502_U, x6502_V, x6502_rol(x6502_read(x6502_U, x6502_V)));
-			break;
+			for (int k=j+1; k<command_size; k++)
+			{
+				if (command_string[k] == '"' || command_string[k] == '\'' || command_string[k] == 0x00) break;
+
+				if (command_string[k] == '.')
+				{
+					temp_pos = 8;
+
+					name[8] = ' ';
+					name[9] = ' ';
+					name[10] = ' ';
+				}
+				else if (command_string[k] > 0x20 && temp_pos < 11 && (temp_pos != 8 || command_string[k-1] == '.'))
+				{
+					if (command_string[k] >= 'a' && command_string[k] <= 'z') name[temp_pos++] = command_string[k] - 0x20;
+					else name[temp_pos++] = command_string[k];
+				}
+			}
+
+			return (name[0] != ' ' ? 0x01 : 0x00);
 		}
-		case 0x40: // RTI
+	}
+
+	return 0x00;
+};
+
+unsigned char fat_quoted(int start) // 0x01 when a command has a quote after it, for a file
+{
+	for (int j=start; j<command_size; j++)
+	{
+		if (command_string[j] == '"' || command_string[j] == '\'') return 0x01;
+	}
+
+	return 0x00;
+};
+
+unsigned char editor_loadfile(int start) // LOAD "NAME"
+{
+	unsigned char temp_name[11];
+	unsigned char temp_found = 0x00;
+	unsigned char *temp_entry;
+	unsigned int temp_index;
+	unsigned int temp_remote = editor_start;
+	unsigned long temp_cluster;
+	unsigned long temp_size;
+	unsigned long temp_count;
+
+	unsigned char v = 0x00;
+
+	if (!fat_filename(start, temp_name)) return 0x00;
+
+	x6502_invalidate();
+
+	if (fat_mount())
+	{
+		temp_index = fat_find(temp_name, temp_found);
+
+		if (temp_found == 0x01 && (temp_entry = fat_directory(temp_index)) != NULL)
 		{
-			x6502_F = x6502_pull();
-			x6502_L = x6502_pull();
-			x6502_H = x6502_pull();
-			break;
+			temp_cluster = (unsigned long)fat_word((unsigned int)(temp_entry - shared_memory) + 20) * 65536 + fat_word((unsigned int)(temp_entry - shared_memory) + 26);
+			temp_size = fat_long((unsigned int)(temp_entry - shared_memory) + 28);
+
+			if (temp_size > (unsigned long)(editor_end - editor_start)) temp_size = (unsigned long)(editor_end - editor_start);
+
+			display_fill((unsigned char)(editor_start/256), (unsigned char)(editor_start%256), 0x00, editor_end-editor_start);
+
+			v = 0x01;
+
+			while (temp_size > (unsigned long)(temp_remote - editor_start))
+			{
+				if (editor_break() || temp_cluster < 2 || temp_cluster >= fat_end) { v = 0x00; break; }
+
+				temp_count = (temp_size - (unsigned long)(temp_remote - editor_start) + 511) / 512; // blocks left
+
+				if (temp_count > fat_cluster) temp_count = fat_cluster;
+
+				if (!sdcard_readblocks(fat_sectorof(temp_cluster), (unsigned int)temp_count, temp_remote, x6502_cache, x6502_cache_span)) { v = 0x00; break; }
+
+				temp_remote += (unsigned int)(temp_count * 512);
+
+				temp_cluster = fat_next(temp_cluster);
+			}
+
+			if (temp_remote > editor_start + temp_size) // the rest of the last block
+			{
+				display_fill((unsigned char)((editor_start+temp_size)/256), (unsigned char)((editor_start+temp_size)%256), 0x00, temp_remote-editor_start-(unsigned int)temp_size);
+			}
 		}
-		case 0x41: // EOR(zpx)
+	}
+
+	fat_release();
+
+	basic_index_total = -1;
+
+	editor_crunch();
+
+	return v;
+};
+
+unsigned char editor_savefile(int start) // SAVE "NAME", replacing a file of that name
+{
+	unsigned char temp_name[11];
+	unsigned char temp_found = 0x00;
+	unsigned char *temp_entry;
+	unsigned int temp_index;
+	unsigned int temp_remote = editor_start;
+	unsigned int temp_size = editor_used() - editor_start;
+	unsigned long temp_first = 0;
+	unsigned long temp_cluster = 0;
+	unsigned long temp_old = 0;
+	unsigned long temp_count;
+
+	unsigned char v = 0x00;
+
+	if (!fat_filename(start, temp_name)) return 0x00;
+
+	x6502_invalidate();
+
+	if (fat_mount())
+	{
+		temp_index = fat_find(temp_name, temp_found);
+
+		if (temp_index != 0xFFFF && (temp_entry = fat_directory(temp_index)) != NULL)
 		{
-			x6502_zpx();
-			x6502_A = x6502_eor(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
-		}
-		case 0x45: // EORzp
-		{
-			x6502_zp();
-			x6502_A = x6502_eor(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0x46: // LSRzp
-		{
-			x6502_zp();
-			x6502_write(x6502_U, 0x00, x6502_lsr(x6502_read(x6502_U, 0x00)));
-			break;
-		}	
-		case 0x48: // PHA
-		{
-			x6502_push(x6502_A);
-			break;
-		}
-		case 0x49: // EOR#
-		{
-			x6502_imm();
-			x6502_A = x6502_eor(x6502_U);
-			break;
-		}
-		case 0x4A: // LSRA
-		{
-			x6502_A = x6502_lsr(x6502_A);
-			break;
-		}
-		case 0x4C: // JMPa
-		{
-			x6502_abs();	
-			x6502_jump(x6502_U, x6502_V);
-			break;
-		}
-		case 0x4D: // EORa
-		{	
-			x6502_abs();
-			x6502_A = x6502_eor(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0x4E: // LSRa
-		{
-			x6502_abs();
-			x6502_write(x6502_U, x6502_V, x6502_eor(x6502_read(x6502_U, x6502_V)));
-			break;
-		}
-		case 0x50: // BVC
-		{
-			x6502_rel();
-			if ((x6502_F&0x40) == 0x00) x6502_branch(x6502_U);
-			break;
-		}
-		case 0x51: // EOR(zp)y
-		{
-			x6502_zp();
-			x6502_A = x6502_eor(x6502_read(x6502_read(x6502_U, 0x00) + x6502_Y, 0x00));
-			break;
-		}
-		case 0x52: // EOR(zp)
-		{
-			x6502_zp();
-			x6502_A = x6502_eor(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
-		}
-		case 0x55: // EORzpx
-		{
-			x6502_zpx();
-			x6502_A = x6502_eor(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0x56: // LSRzpx
-		{
-			x6502_zpx();
-			x6502_write(x6502_U, 0x00, x6502_lsr(x6502_read(x6502_U, 0x00)));
-			break;
-		}	
-		case 0x58: // CLI
-		{
-			x6502_F = x6502_F & 0xFB;
-			break;
-		}
-		case 0x59: // EORay
-		{
-			x6502_absy();
-			x6502_A = x6502_eor(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0x5A: // PHY
-		{
-			x6502_push(x6502_Y);
-			break;
-		}
-		case 0x5D: // EORax
-		{	
-			x6502_absx();
-			x6502_A = x6502_eor(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0x5E: // LSRax
-		{
-			x6502_absx();
-			x6502_write(x6502_U, x6502_V, x6502_lsr(x6502_read(x6502_U, x6502_V)));
-			break;
-		}
-		case 0x60: // RTS
-		{
-			x6502_L = x6502_pull();
-			x6502_H = x6502_pull();
-			break;
-		}
-		case 0x61: // ADC(zpx)
-		{
-			x6502_zpx();
-			x6502_A = x6502_adc(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
-		}
-		case 0x64: // STZzp
-		{
-			x6502_zp();
-			x6502_write(x6502_U, 0x00, 0x00);
-			break;
-		}
-		case 0x65: // ADCzp
-		{
-			x6502_zp();
-			x6502_A = x6502_adc(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0x66: // RORzp
-		{
-			x6502_zp();
-			x6502_write(x6502_U, 0x00, x6502_ror(x6502_read(x6502_U, 0x00)));
-			break;
-		}	
-		case 0x68: // PLA
-		{
-			x6502_A = x6502_pull();
-			break;
-		}
-		case 0x69: // ADC#
-		{
-			x6502_imm();
-			x6502_A = x6502_adc(x6502_U);
-			break;
-		}
-		case 0x6A: // RORA
-		{	
-			x6502_A = x6502_ror(x6502_A);
-			break;
-		}
-		case 0x6C: // JMP(a)
-		{
-			x6502_abs();
-			x6502_jump_indirect(x6502_U, x6502_V);
-			break;
-		}
-		case 0x6D: // ADCa
-		{	
-			x6502_abs();
-			x6502_A = x6502_adc(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0x6E: // RORa
-		{
-			x6502_abs();
-			x6502_write(x6502_U, x6502_V, x6502_ror(x6502_read(x6502_U, x6502_V)));
-			break;
-		}
-		case 0x70: // BVS
-		{
-			x6502_rel();
-			if ((x6502_F&0x40) != 0x00) x6502_branch(x6502_U);
-			break;
-		}
-		case 0x71: // ADC(zp)y
-		{
-			x6502_zp();
-			x6502_A = x6502_adc(x6502_read(x6502_read(x6502_U, 0x00) + x6502_Y, 0x00));
-			break;
-		}
-		case 0x72: // ADC(zp)
-		{
-			x6502_zp();
-			x6502_A = x6502_adc(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
-		}
-		case 0x74: // STZzpx
-		{
-			x6502_zpx();
-			x6502_write(x6502_U, 0x00, 0x00);
-			break;
-		}
-		case 0x75: // ADCzpx
-		{
-			x6502_zpx();
-			x6502_A = x6502_adc(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0x76: // RORzpx
-		{
-			x6502_zpx();
-			x6502_write(x6502_U, 0x00, x6502_ror(x6502_read(x6502_U, 0x00)));
-			break;
-		}	
-		case 0x78: // SEI
-		{
-			x6502_F = x6502_F | 0x04;
-			break;
-		}	
-		case 0x79: // ADCay
-		{	
-			x6502_absy();
-			x6502_A = x6502_adc(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0x7A: // PLY
-		{
-			x6502_Y = x6502_pull();
-			break;
-		}
-		case 0x7C: // JMP(ax)
-		{
-			x6502_absx();
-			x6502_jump_indirect(x6502_U, x6502_V);
-			break;
-		}
-		case 0x7D: // ADCax
-		{
-			x6502_absx();
-			x6502_A = x6502_adc(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0x7E: // RORax
-		{
-			x6502_absx();
-			x6502_write(x6502_U, x6502_V, x6502_ror(x6502_read(x6502_U, x6502_V)));
-			break;
-		}
-		case 0x80: // BRA
-		{
-			x6502_rel();
-			x6502_branch(x6502_U);
-			break;
-		}
-		case 0x81: // STA(zpx)
-		{
-			x6502_zpx();
-			x6502_write(x6502_read(x6502_read(x6502_U, 0x00), 0x00), 0x00, x6502_A);
-			break;
-		}
-		case 0x84: // STYzp
-		{
-			x6502_zp();
-			x6502_write(x6502_U, 0x00, x6502_Y);
-			break;
-		}
-		case 0x85: // STAzp
-		{
-			x6502_zp();
-			x6502_write(x6502_U, 0x00, x6502_A);
-			break;
-		}
-		case 0x86: // STXzp
-		{
-			x6502_zp();
-			x6502_write(x6502_U, 0x00, x6502_X);
-			break;
-		}	
-		case 0x88: // DEY
-		{
-			x6502_Y = x6502_dec(x6502_Y);
-			break;
-		}
-		case 0x89: // BIT#
-		{
-			x6502_imm();
-			x6502_bit(x6502_U);
-			break;
-		}
-		case 0x8A: // TXA
-		{
-			x6502_txa();
-			break;
-		}
-		case 0x8C: // STYa
-		{
-			x6502_abs();
-			x6502_write(x6502_U, x6502_V, x6502_Y);
-			break;
-		}
-		case 0x8D: // STAa
-		{	
-			x6502_abs();
-			x6502_write(x6502_U, x6502_V, x6502_A);
-			break;
-		}
-		case 0x8E: // STXa
-		{
-			x6502_abs();
-			x6502_write(x6502_U, x6502_V, x6502_X);
-			break;
-		}
-		case 0x90: // BCC
-		{
-			x6502_rel();
-			if ((x6502_F&0x01) == 0x00) x6502_branch(x6502_U);
-			break;
-		}
-		case 0x91: // STA(zp)y
-		{
-			x6502_zp();
-			x6502_write(x6502_read(x6502_read(x6502_U, 0x00) + x6502_Y, 0x00), 0x00, x6502_A);
-			break;
-		}
-		case 0x92: // STA(zp)
-		{
-			x6502_zp();
-			x6502_write(x6502_read(x6502_read(x6502_U, 0x00), 0x00), 0x00, x6502_A);
-			break;
-		}
-		case 0x94: // STYzpx
-		{
-			x6502_zpx();
-			x6502_write(x6502_U, 0x00, x6502_Y);
-			break;
-		}
-		case 0x95: // STAzpx
-		{
-			x6502_zpx();
-			x6502_write(x6502_U, 0x00, x6502_A);
-			break;
-		}
-		case 0x96: // STXzpy
-		{
-			x6502_zpy();
-			x6502_write(x6502_U, 0x00, x6502_X);
-			break;
-		}	
-		case 0x98: // TYA
-		{
-			x6502_tya();
-			break;
-		}
-		case 0x99: // STAay
-		{
-			x6502_absy();
-			x6502_write(x6502_U, x6502_V, x6502_A);
-			break;
-		}
-		case 0x9A: // TXS
-		{
-			x6502_txs();
-			break;
-		}
-		case 0x9C: // STZa
-		{
-			x6502_abs();
-			x6502_write(x6502_U, x6502_V, 0x00);
-			break;
-		}
-		case 0x9D: // STAax
-		{
-			x6502_absx();
-			x6502_write(x6502_U, x6502_V, x6502_A);
-			break;
-		}	
-		case 0x9E: // STZax
-		{
-			x6502_absx();
-			x6502_write(x6502_U, x6502_V, 0x00);
-			break;
-		}
-		case 0xA0: // LDY#
-		{
-			x6502_imm();
-			x6502_ldy(x6502_U);
-			break;
-		}
-		case 0xA1: // LDA(zpx)
-		{
-			x6502_zpx();
-			x6502_lda(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
-		}
-		case 0xA2: // LDX#
-		{
-			x6502_imm();
-			x6502_ldx(x6502_U);
-			break;
-		}
-		case 0xA4: // LDYzp
-		{
-			x6502_zp();
-			x6502_ldy(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0xA5: // LDAzp
-		{
-			x6502_zp();
-			x6502_lda(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0xA6: // LDXzp
-		{
-			x6502_zp();
-			x6502_ldx(x6502_read(x6502_U, 0x00));
-			break;
-		}	
-		case 0xA8: // TAY
-		{
-			x6502_tay();
-			break;
-		}
-		case 0xA9: // LDA#
-		{
-			x6502_imm();
-			x6502_lda(x6502_U);
-			break;
-		}
-		case 0xAA: // TAX
-		{
-			x6502_tax();
-			break;
-		}
-		case 0xAC: // LDYa
-		{
-			x6502_abs();
-			x6502_ldy(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xAD: // LDAa
-		{
-			x6502_abs();
-			x6502_lda(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xAE: // LDXa
-		{
-			x6502_absx();
-			x6502_ldx(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xB0: // BCS
-		{
-			x6502_rel();
-			if ((x6502_F&0x01) > 0x00) x6502_branch(x6502_U);
-			break;
-		}
-		case 0xB1: // LDA(zp)y
-		{
-			x6502_zp();
-			x6502_lda(x6502_read(x6502_read(x6502_U, 0x00) + x6502_Y, 0x00));
-			break;
-		}
-		case 0xB2: // LDA(zp)
-		{
-			x6502_zp();
-			x6502_lda(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
-		}
-		case 0xB4: // LDYzpx
-		{
-			x6502_zpx();
-			x6502_ldy(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0xB5: // LDAzpx
-		{
-			x6502_zpx();
-			x6502_lda(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0xB6: // LDXzpy
-		{
-			x6502_zpy();
-			x6502_ldx(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0xB8: // CLV
-		{
-			x6502_over(0x00);
-			break;
-		}
-		case 0xB9: // LDAay
-		{
-			x6502_absy();
-			x6502_lda(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xBA: // TSX
-		{
-			x6502_tsx();
-			break;
-		}
-		case 0xBC: // LDYax
-		{
-			x6502_absx();
-			x6502_ldy(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xBD: // LDAax
-		{
-			x6502_absx();
-			x6502_lda(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xBE: // LDXay
-		{
-			x6502_absy();
-			x6502_ldx(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xC0: // CPY#
-		{
-			x6502_imm();
-			x6502_cpy(x6502_U);
-			break;
-		}
-		case 0xC1: // CMP(zpx)
-		{
-			x6502_zpx();
-			x6502_cmp(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
-		}
-		case 0xC4: // CPYzp
-		{
-			x6502_zp();
-			x6502_cpy(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0xC5: // CMPzp
-		{
-			x6502_zp();
-			x6502_cmp(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0xC6: // DECzp
-		{
-			x6502_zp();
-			x6502_write(x6502_U, 0x00, x6502_dec(x6502_read(x6502_U, 0x00)));
-			break;
-		}
-		case 0xC8: // INY
-		{
-			x6502_Y = x6502_inc(x6502_Y);
-			break;
-		}
-		case 0xC9: // CMP#
-		{
-			x6502_imm();
-			x6502_cmp(x6502_U);
-			break;
-		}
-		case 0xCA: // DEX
-		{
-			x6502_X = x6502_dec(x6502_X);
-			break;
-		}
-		case 0xCB: // WAI
-		{
-			return 0;
-		}
-		case 0xCC: // CPYa
-		{
-			x6502_abs();
-			x6502_cpy(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xCD: // CMPa
-		{
-			x6502_abs();
-			x6502_cmp(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xCE: // DECa
-		{
-			x6502_abs();
-			x6502_write(x6502_U, x6502_V, x6502_dec(x6502_read(x6502_U, x6502_V)));
-			break;
-		}
-		case 0xD0: // BNE
-		{
-			x6502_rel();
-			if ((x6502_F&0x02) != 0x00) x6502_branch(x6502_U);
-			break;
-		}
-		case 0xD1: // CMP(zp)y
-		{
-			x6502_zp();
-			x6502_cmp(x6502_read(x6502_read(x6502_U, 0x00) + x6502_Y, 0x00));
-			break;
-		}
-		case 0xD2: // CMP(zp)
-		{
-			x6502_zp();
-			x6502_cmp(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
-		}
-		case 0xD5: // CMPzpx
-		{
-			x6502_zpx();
-			x6502_cmp(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0xD6: // DECzpx
-		{
-			x6502_zpx();
-			x6502_write(x6502_U, 0x00, x6502_dec(x6502_read(x6502_U, 0x00)));
-			break;
-		}
-		case 0xD8: // CLD
-		{
-			return;
-		}
-		case 0xD9: // CMPay
-		{
-			x6502_absy();
-			x6502_cmp(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xDA: // PHX
-		{
-			x6502_push(x6502_X);
-			break;
-		}
-		case 0xDB: // STP
-		{
-			return 0;
-		}
-		case 0xDD: // CMPax
-		{
-			x6502_absx();
-			x6502_cmp(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xDE: // DECax
-		{
-			x6502_absx();
-			x6502_write(x6502_U, x6502_V, x6502_dec(x6502_read(x6502_U, x6502_V)));
-			break;
-		}
-		case 0xE0: // CPX#
-		{
-			x6502_imm();
-			x6502_cpx(x6502_read(x6502_U, x6502_V));
-			break;
-		}
-		case 0xE1: // SBC(zpx)
-		{
-			x6502_zpx();
-			x6502_A = x6502_sbc(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
-		}
-		case 0xE4: // CPXzp
-		{
-			x6502_zp();
-			x6502_cpx(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0xE5: // SBCzp
-		{
-			x6502_zp();
-			x6502_A = x6502_sbc(x6502_read(x6502_U, 0x00));
-			break;
-		}
-		case 0xE6: // INCzp
-		{
-			x6502_zp();
-			x6502_write(x6502_U, 0x00, x6502_inc(x6502_read(x6502_U, 0x00)));
-			break;
+			if (temp_found == 0x01) // freed once the new copy is written
+			{
+				temp_old = (unsigned long)fat_word((unsigned int)(temp_entry - shared_memory) + 20) * 65536 + fat_word((unsigned int)(temp_entry - shared_memory) + 26);
+			}
+
+			v = 0x01;
+
+			while (temp_remote < editor_start + temp_size)
+			{
+				if (editor_break()) { v = 0x00; break; }
+
+				temp_cluster = fat_allocate(temp_cluster);
+
+				if (temp_cluster == 0) { v = 0x00; break; } // card is full
+
+				if (temp_first == 0) temp_first = temp_cluster;
+
+				temp_count = (unsigned long)(editor_start + temp_size - temp_remote + 511) / 512; // blocks left
+
+				if (temp_count > fat_cluster) temp_count = fat_cluster;
+
+				if (!sdcard_writeblocks(fat_sectorof(temp_cluster), (unsigned int)temp_count, temp_remote, x6502_cache, x6502_cache_span)) { v = 0x00; break; }
+
+				temp_remote += (unsigned int)(temp_count * 512);
+			}
+
+			if ((temp_entry = fat_directory(temp_index)) == NULL) v = 0x00;
+
+			if (v == 0x01)
+			{
+				for (int i=0; i<32; i++) temp_entry[i] = 0x00;
+				for (int i=0; i<11; i++) temp_entry[i] = temp_name[i];
+
+				temp_entry[11] = 0x20; // archive
+				temp_entry[16] = 0x21; // created, read, and written on the first of January 1980
+				temp_entry[18] = 0x21;
+				temp_entry[24] = 0x21;
+				temp_entry[20] = (unsigned char)((temp_first >> 16) & 0xFF);
+				temp_entry[21] = (unsigned char)((temp_first >> 24) & 0xFF);
+				temp_entry[26] = (unsigned char)(temp_first & 0xFF);
+				temp_entry[27] = (unsigned char)((temp_first >> 8) & 0xFF);
+				temp_entry[28] = (unsigned char)(temp_size & 0xFF);
+				temp_entry[29] = (unsigned char)((temp_size >> 8) & 0xFF);
+
+				fat_cache_dirty |= fat_changed;
+
+				fat_unchain(temp_old);
+			}
+			else if (temp_first != 0) // nothing points to these
+			{
+				fat_unchain(temp_first);
+			}
+
+			if (!fat_sync()) v = 0x00;
 		}
-		case 0xE8: // INX
+	}
+
+	fat_release();
+
+	return v;
+};
+
+unsigned char editor_dirfiles() // DIR "", the files on the card with their sizes
+{
+	unsigned char *temp_entry;
+	unsigned long temp_size;
+
+	x6502_invalidate();
+
+	if (!fat_mount()) { fat_release(); return 0x00; }
+
+	for (unsigned int i=0; i<0xFFFF; i++)
+	{
+		if (editor_break()) break;
+
+		temp_entry = fat_directory(i);
+
+		if (temp_entry == NULL || temp_entry[0] == 0x00) break;
+
+		if (temp_entry[0] == 0xE5 || (temp_entry[11] & 0x18) != 0x00) continue; // deleted, long names, volume labels, and directories
+
+		temp_size = fat_long((unsigned int)(temp_entry - shared_memory) + 28);
+
+		keyboard_print(0x0D);
+
+		for (int j=0; j<11; j++)
 		{
-			x6502_X = x6502_inc(x6502_X);
-			break;
+			if (j == 8 && temp_entry[8] != ' ') keyboard_print('.');
+
+			if (temp_entry[j] != ' ') keyboard_print((char)temp_entry[j]);
 		}
-		case 0xE9: // SBC#
+
+		keyboard_print(' ');
+
+		if (temp_size > 0xFFFF) keyboard_print('+');
+		else basic_printnumber((unsigned int)temp_size);
+	}
+
+	fat_release();
+
+	return 0x01;
+};
+
+void monitor_printcount(unsigned long value) // as ': ' and eight hex digits, then a space
+{
+	keyboard_print(':');
+	keyboard_print(' ');
+
+	for (int i=7; i>=0; i--)
+	{
+		if ((unsigned char)((value>>(i*4))&0x0F) <= 0x09) keyboard_print(((value>>(i*4))&0x0F) + '0');
+		else keyboard_print(((value>>(i*4))&0x0F) + 'A' - 0x0A);
+	}
+
+	keyboard_print(' ');
+};
+
+void monitor_execute(int start, int end)
+{
+	unsigned char addr_pos = 0x00;
+	unsigned char addr_offset = 0x00;
+	unsigned char data_pos = 0x00;
+
+	unsigned int temp_addr;
+	unsigned int temp_offset;
+	unsigned int temp_stop = 0x0000;
+	unsigned char temp_data;
+	unsigned char temp_byte = 0x00;
+
+	bool printed = false;
+
+	if (start < 0 || end > command_size) return;
+
+	fat_forget(); // which may be written over from here
+
+	for (int i=start; i<end; i++)
+	{
+		if (editor_break()) break;
+
+		if (command_string[i] == 'J') // jump
 		{
-			x6502_imm();
-			x6502_A = x6502_sbc(x6502_U);
-			break;
+			addr_offset = 0x00;
+
+			temp_addr = (unsigned int)(monitor_addr + addr_offset);
+
+			x6502_run((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
+
+			basic_index_total = -1; // program could have changed
+
+			addr_pos = 0x00;
+			addr_offset = 0x00;
+			data_pos = 0x00;
 		}
-		case 0xEA: // NOP
+		else if ((command_string[i] >= 0x30 && command_string[i] <= 0x39) || 
+			(command_string[i] >= 0x41 && command_string[i] <= 0x46))
 		{
-			break;
+			if (command_string[i] >= 0x30 && command_string[i] <= 0x39)
+			{
+				temp_data = (unsigned char)(command_string[i] - 0x30);
+			}
+			else if (command_string[i] >= 0x41 && command_string[i] <= 0x46)
+			{
+				temp_data = (unsigned char)(command_string[i] - 0x41 + 0x0A);
+			}
+
+			if (data_pos == 0x00)
+			{
+				if (addr_pos < 0x04)
+				{
+					monitor_addr = (unsigned int)((monitor_addr & ~(0xF000 >> (addr_pos*4))) | ((unsigned int)temp_data << (12 - addr_pos*4))); // one hex digit, the others as they were
+					addr_pos++;
+
+					if (addr_pos == 0x04)
+					{
+						addr_pos = 0x00;
+	
+						keyboard_print(0x0D);
+
+						addr_offset = 0x00;
+	
+						temp_addr = (unsigned int)(monitor_addr + addr_offset);
+	
+						if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x09) keyboard_print(((temp_addr&0xF000)>>12) + '0');
+						else if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x0F) keyboard_print(((temp_addr&0xF000)>>12) + 'A' - 0x0A);
+	
+						if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x09) keyboard_print(((temp_addr&0x0F00)>>8) + '0');
+						else if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x0F) keyboard_print(((temp_addr&0x0F00)>>8) + 'A' - 0x0A);
+	
+						if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x09) keyboard_print(((temp_addr&0x00F0)>>4) + '0');
+						else if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x0F) keyboard_print(((temp_addr&0x00F0)>>4) + 'A' - 0x0A);
+	
+						if ((unsigned char)(temp_addr&0x000F) <= 0x09) keyboard_print((temp_addr&0x000F) + '0');
+						else if ((unsigned char)(temp_addr&0x00F) <= 0x0F) keyboard_print((temp_addr&0x000F) + 'A' - 0x0A);
+	
+						keyboard_print(':');
+						keyboard_print(' ');
+				
+						temp_data = x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
+	
+						if ((unsigned char)((temp_data&0xF0)>>4) <= 0x09) keyboard_print(((temp_data&0xF0)>>4) + '0');
+						else if ((unsigned char)((temp_data&0xF0)>>4) <= 0x0F) keyboard_print(((temp_data&0xF0)>>4) + 'A' - 0x0A);
+						
+						if ((unsigned char)(temp_data&0x0F) <= 0x09) keyboard_print((temp_data&0x0F) + '0');
+						else if ((unsigned char)(temp_data&0x0F) <= 0x0F) keyboard_print((temp_data&0x0F) + 'A' - 0x0A);
+
+						keyboard_print(' ');
+
+						printed = true;
+					}
+				}
+				else
+				{
+					temp_stop = (unsigned int)((temp_stop << 4) | temp_data); // all four digits come in this line
+					addr_pos++;
+
+					if (addr_pos == 0x0C)
+					{
+						addr_pos = 0x08;
+
+						addr_offset = 0x00;
+
+						temp_addr = (unsigned int)(monitor_addr + addr_offset);
+
+						temp_offset = (unsigned int)(temp_stop + addr_offset);
+	
+						if (!printed)
+						{
+							keyboard_print(0x0D);
+
+							temp_addr = (unsigned int)(monitor_addr + addr_offset);
+	
+							if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x09) keyboard_print(((temp_addr&0xF000)>>12) + '0');
+							else if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x0F) keyboard_print(((temp_addr&0xF000)>>12) + 'A' - 0x0A);
+	
+							if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x09) keyboard_print(((temp_addr&0x0F00)>>8) + '0');
+							else if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x0F) keyboard_print(((temp_addr&0x0F00)>>8) + 'A' - 0x0A);
+	
+							if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x09) keyboard_print(((temp_addr&0x00F0)>>4) + '0');
+							else if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x0F) keyboard_print(((temp_addr&0x00F0)>>4) + 'A' - 0x0A);
+	
+							if ((unsigned char)(temp_addr&0x000F) <= 0x09) keyboard_print((temp_addr&0x000F) + '0');
+							else if ((unsigned char)(temp_addr&0x00F) <= 0x0F) keyboard_print((temp_addr&0x000F) + 'A' - 0x0A);
+	
+							keyboard_print(':');
+							keyboard_print(' ');
+				
+							temp_data = x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
+	
+							if ((unsigned char)((temp_data&0xF0)>>4) <= 0x09) keyboard_print(((temp_data&0xF0)>>4) + '0');
+							else if ((unsigned char)((temp_data&0xF0)>>4) <= 0x0F) keyboard_print(((temp_data&0xF0)>>4) + 'A' - 0x0A);
+						
+							if ((unsigned char)(temp_data&0x0F) <= 0x09) keyboard_print((temp_data&0x0F) + '0');
+							else if ((unsigned char)(temp_data&0x0F) <= 0x0F) keyboard_print((temp_data&0x0F) + 'A' - 0x0A);
+
+							keyboard_print(' ');
+
+							printed = true;
+						}
+
+						while (temp_addr < temp_offset)
+						{
+							if (editor_break()) break;
+
+							temp_addr++;
+	
+							if (temp_addr % 0x08 == 0x00)
+							{
+								keyboard_print(0x0D);
+	
+								if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x09) keyboard_print(((temp_addr&0xF000)>>12) + '0');
+								else if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x0F) keyboard_print(((temp_addr&0xF000)>>12) + 'A' - 0x0A);
+	
+								if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x09) keyboard_print(((temp_addr&0x0F00)>>8) + '0');
+								else if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x0F) keyboard_print(((temp_addr&0x0F00)>>8) + 'A' - 0x0A);
+	
+								if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x09) keyboard_print(((temp_addr&0x00F0)>>4) + '0');
+								else if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x0F) keyboard_print(((temp_addr&0x00F0)>>4) + 'A' - 0x0A);
+	
+								if ((unsigned char)(temp_addr&0x000F) <= 0x09) keyboard_print((temp_addr&0x000F) + '0');
+								else if ((unsigned char)(temp_addr&0x00F) <= 0x0F) keyboard_print((temp_addr&0x000F) + 'A' - 0x0A);
+	
+								keyboard_print(':');
+								keyboard_print(' ');
+							}
+				
+							temp_data = x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
+	
+							if ((unsigned char)((temp_data&0xF0)>>4) <= 0x09) keyboard_print(((temp_data&0xF0)>>4) + '0');
+							else if ((unsigned char)((temp_data&0xF0)>>4) <= 0x0F) keyboard_print(((temp_data&0xF0)>>4) + 'A' - 0x0A);
+						
+							if ((unsigned char)(temp_data&0x0F) <= 0x09) keyboard_print((temp_data&0x0F) + '0');
+							else if ((unsigned char)(temp_data&0x0F) <= 0x0F) keyboard_print((temp_data&0x0F) + 'A' - 0x0A);
+
+							keyboard_print(' ');
+
+							printed = true;
+						}
+					}
+				}
+			}
+			else
+			{
+				temp_byte = (unsigned char)((temp_byte << 4) | temp_data);
+				data_pos++;
+
+				if (data_pos == 0x03)
+				{
+					data_pos = 0x01;
+					
+					temp_addr = (unsigned int)(monitor_addr + addr_offset);
+
+					x6502_write((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8), 
+						temp_byte);
+
+					if (temp_addr >= editor_start && temp_addr < editor_total) basic_index_total = -1;
+
+					addr_offset++;
+				}
+			}
 		}
-		case 0xEC: // CPXa
+		else if (command_string[i] == '.')
 		{
-			x6502_abs();
-			x6502_cpx(x6502_read(x6502_U, x6502_V));
-			break;
+			addr_pos = 0x08;
 		}
-		case 0xED: // SBCa
+		else if (command_string[i] == ',')
 		{
-			x6502_abs();
-			x6502_A = x6502_sbc(x6502_read(x6502_U, x6502_V));
-			break;
+			addr_pos = 0x00;
 		}
-		case 0xEE: // INCa
+		else if (command_string[i] == ':')
 		{
-			x6502_abs();
-			x6502_write(x6502_U, x6502_V, x6502_inc(x6502_read(x6502_U, x6502_V)));
-			break;
+			data_pos = 0x01;
 		}
-		case 0xF0: // BEQ
+		else if (command_string[i] == ';')
 		{
-			x6502_rel();
-			if ((x6502_F&0x02) == 0x00) x6502_branch(x6502_U);
-			break;
+			data_pos = 0x00;
 		}
-		case 0xF1: // SBC(zp)y
+#ifdef x6502_stats
+		else if (command_string[i] == '?') // cache hits, misses, write backs, and instructions run, then clear them
 		{
-			x6502_zp();
-			x6502_A = x6502_sbc(x6502_read(x6502_read(x6502_U, 0x00) + x6502_Y, 0x00));
-			break;
+			keyboard_print(0x0D);
+			keyboard_print('H');
+			monitor_printcount(x6502_cache_hits);
+			keyboard_print(0x0D);
+			keyboard_print('M');
+			monitor_printcount(x6502_cache_misses);
+			keyboard_print(0x0D);
+			keyboard_print('W');
+			monitor_printcount(x6502_cache_writebacks);
+			keyboard_print(0x0D);
+			keyboard_print('I');
+			monitor_printcount(x6502_count);
+
+			x6502_cache_hits = 0;
+			x6502_cache_misses = 0;
+			x6502_cache_writebacks = 0;
+			x6502_count = 0;
+
+			printed = true;
 		}
-		case 0xF2: // SBC(zp)
+#endif
+		else
 		{
-			x6502_zp();
-			x6502_A = x6502_sbc(x6502_read(x6502_read(x6502_U, 0x00), 0x00));
-			break;
+			// ignore
 		}
-		case 0xF5: // SBCzpx
+	}
+
+	if (!printed)
+	{
+		keyboard_print(0x0D);
+
+		addr_offset = 0x00;
+
+		temp_addr = (unsigned int)(monitor_addr + addr_offset);
+	
+		if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x09) keyboard_print(((temp_addr&0xF000)>>12) + '0');
+		else if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x0F) keyboard_print(((temp_addr&0xF000)>>12) + 'A' - 0x0A);
+	
+		if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x09) keyboard_print(((temp_addr&0x0F00)>>8) + '0');
+		else if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x0F) keyboard_print(((temp_addr&0x0F00)>>8) + 'A' - 0x0A);
+	
+		if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x09) keyboard_print(((temp_addr&0x00F0)>>4) + '0');
+		else if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x0F) keyboard_print(((temp_addr&0x00F0)>>4) + 'A' - 0x0A);
+	
+		if ((unsigned char)(temp_addr&0x000F) <= 0x09) keyboard_print((temp_addr&0x000F) + '0');
+		else if ((unsigned char)(temp_addr&0x00F) <= 0x0F) keyboard_print((temp_addr&0x000F) + 'A' - 0x0A);
+	
+		keyboard_print(':');
+		keyboard_print(' ');
+				
+		temp_data = x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
+	
+		if ((unsigned char)((temp_data&0xF0)>>4) <= 0x09) keyboard_print(((temp_data&0xF0)>>4) + '0');
+		else if ((unsigned char)((temp_data&0xF0)>>4) <= 0x0F) keyboard_print(((temp_data&0xF0)>>4) + 'A' - 0x0A);
+						
+		if ((unsigned char)(temp_data&0x0F) <= 0x09) keyboard_print((temp_data&0x0F) + '0');
+		else if ((unsigned char)(temp_data&0x0F) <= 0x0F) keyboard_print((temp_data&0x0F) + 'A' - 0x0A);
+
+		keyboard_print(' ');
+	}
+
+	return;
+};
+
+void basic_crunch(int start) // keywords and numbers in command_string to tokens, never longer than what was typed
+{
+	int temp_out = start;
+	int temp_length;
+	int temp_digits;
+	unsigned char temp_quote = 0x00;
+	unsigned char temp_match;
+	unsigned int temp_value;
+
+	for (int i=start; i<command_size; i++)
+	{
+		if (command_string[i] == 0x00) continue; // left by tab
+
+		if (command_string[i] == '"' || command_string[i] == '\'') temp_quote = 0x01 - temp_quote;
+
+		if (temp_quote == 0x00 && command_string[i] >= 0x30 && command_string[i] <= 0x39) // number value
 		{
-			x6502_zpx();
-			x6502_A = x6502_sbc(x6502_read(x6502_U, 0x00));
-			break;
+			temp_value = 0;
+			temp_digits = 0;
+
+			while (i < command_size && command_string[i] >= 0x30 && command_string[i] <= 0x39)
+			{
+				temp_value = temp_value * 10 + (unsigned int)(command_string[i] - 0x30);
+				temp_digits++;
+				i++;
+			}
+
+			i--;
+
+			if (temp_digits == 1)
+			{
+				command_string[temp_out++] = (unsigned char)(temp_value + 0x30);
+			}
+			else if (temp_value < 0x0080)
+			{
+				command_string[temp_out++] = basic_token_byte;
+				command_string[temp_out++] = (unsigned char)(0x80 | temp_value);
+			}
+			else if (temp_value < 0x4000)
+			{
+				command_string[temp_out++] = basic_token_word;
+				command_string[temp_out++] = (unsigned char)(0x80 | (temp_value >> 7));
+				command_string[temp_out++] = (unsigned char)(0x80 | (temp_value & 0x7F));
+			}
+			else
+			{
+				command_string[temp_out++] = basic_token_long;
+				command_string[temp_out++] = (unsigned char)(0x80 | (temp_value >> 14));
+				command_string[temp_out++] = (unsigned char)(0x80 | ((temp_value >> 7) & 0x7F));
+				command_string[temp_out++] = (unsigned char)(0x80 | (temp_value & 0x7F));
+			}
+
+			continue;
 		}
-		case 0xF6: // INCzpx
+
+		temp_match = 0x00;
+
+		if (temp_quote == 0x00 && command_string[i] >= 0x41 && command_string[i] <= 0x5A)
 		{
-			x6502_zpx();
-			x6502_write(x6502_U, 0x00, x6502_inc(x6502_read(x6502_U, 0x00)));
-			break;
+			for (int k=0; k<=(int)(basic_token_mon-basic_token_print); k++)
+			{
+				temp_length = 0;
+
+				while (temp_length < 5 && pgm_read_byte_near(basic_keywords + k*5 + temp_length) != ' ' &&
+					i+temp_length < command_size && command_string[i+temp_length] == pgm_read_byte_near(basic_keywords + k*5 + temp_length))
+				{
+					temp_length++;
+				}
+
+				if (temp_length == 5 || (temp_length > 0 && pgm_read_byte_near(basic_keywords + k*5 + temp_length) == ' '))
+				{
+					command_string[temp_out++] = (unsigned char)(basic_token_print + k);
+
+					i += temp_length - 1;
+
+					temp_match = 0x01;
+
+					break;
+				}
+			}
 		}
-		case 0xF8: // SED
+
+		if (temp_match == 0x00) command_string[temp_out++] = command_string[i];
+	}
+
+	for (int i=temp_out; i<command_size; i++) command_string[i] = 0x00;
+};
+
+unsigned int basic_constant(unsigned char token, unsigned int &addr) // the value after a number token, moving past it
+{
+	unsigned int temp_value = 0;
+
+	for (unsigned char i=basic_token_byte; i<=token; i++)
+	{
+		temp_value = (temp_value << 7) + (unsigned int)(x6502_read((unsigned char)(addr&0x00FF), (unsigned char)((addr&0xFF00)>>8)) & 0x7F);
+
+		addr++;
+	}
+
+	return temp_value;
+};
+
+void basic_printnumber(unsigned int value)
+{
+	unsigned int temp_place = 10000;
+
+	while (temp_place > 1 && value < temp_place) temp_place /= 10;
+
+	while (temp_place > 0)
+	{
+		keyboard_print((char)((unsigned char)(value/temp_place)+0x30));
+
+		value = value % temp_place;
+
+		temp_place /= 10;
+	}
+};
+
+unsigned int basic_list(unsigned char value, unsigned int addr, unsigned char show) // a token as it was typed, returns the address after it
+{
+	if (value >= basic_token_byte && value <= basic_token_long)
+	{
+		unsigned int temp_value = basic_constant(value, addr);
+
+		if (show) basic_printnumber(temp_value);
+	}
+	else if (value >= basic_token_print && value <= basic_token_mon)
+	{
+		for (int i=0; i<5; i++)
 		{
-			return 0;
+			unsigned char temp_char = pgm_read_byte_near(basic_keywords + (int)(value-basic_token_print)*5 + i);
+
+			if (temp_char == ' ') break;
+
+			if (show) keyboard_print((char)temp_char);
 		}
-		case 0xF9: // SBCay
+	}
+	else if (show)
+	{
+		keyboard_print((char)value);
+	}
+
+	return addr;
+};
+
+void editor_crunch() // after LOAD, programs saved before tokens are converted, and the end is found
+{
+	unsigned int temp_read = editor_start;
+	unsigned int temp_write = editor_start;
+	unsigned char temp_char;
+	int temp_pos;
+
+	while (temp_read + 1 < editor_end)
+	{
+		if (x6502_read((unsigned char)(temp_read&0x00FF), (unsigned char)((temp_read&0xFF00)>>8)) == 0x00 &&
+			x6502_read((unsigned char)((temp_read+1)&0x00FF), (unsigned char)(((temp_read+1)&0xFF00)>>8)) == 0x00) break; // line zero is the end
+
+		for (int i=0; i<2; i++) // line number
 		{
-			x6502_absy();
-			x6502_A = x6502_sbc(x6502_read(x6502_U, x6502_V));
-			break;
+			x6502_write((unsigned char)(temp_write&0x00FF), (unsigned char)((temp_write&0xFF00)>>8),
+				x6502_read((unsigned char)(temp_read&0x00FF), (unsigned char)((temp_read&0xFF00)>>8)));
+
+			temp_read++;
+			temp_write++;
 		}
-		case 0xFA: // PLX
+
+		for (int i=0; i<command_size; i++) command_string[i] = 0x00;
+
+		temp_pos = 0;
+
+		while (temp_read < editor_end)
 		{
-			x6502_X = x6502_pull();
-			break;
+			temp_char = x6502_read((unsigned char)(temp_read&0x00FF), (unsigned char)((temp_read&0xFF00)>>8));
+
+			temp_read++;
+
+			if (temp_char == 0x10) break;
+
+			if (temp_pos < command_size) command_string[temp_pos++] = temp_char;
 		}
-		case 0xFD: // SBCax
+
+		basic_crunch(0);
+
+		for (int i=0; i<command_size; i++)
 		{
-			x6502_absx();
-			x6502_A = x6502_sbc(x6502_read(x6502_U, x6502_V));
-			break;
+			if (command_string[i] == 0x00) break;
+
+			x6502_write((unsigned char)(temp_write&0x00FF), (unsigned char)((temp_write&0xFF00)>>8), command_string[i]);
+
+			temp_write++;
 		}
-		case 0xFE: // INCax
+
+		x6502_write((unsigned char)(temp_write&0x00FF), (unsigned char)((temp_write&0xFF00)>>8), 0x10);
+
+		temp_write++;
+	}
+
+	for (unsigned int j=temp_write; j<temp_read; j++)
+	{
+		x6502_write((unsigned char)(j&0x00FF), (unsigned char)((j&0xFF00)>>8), 0x00);
+	}
+
+	editor_total = temp_write + 256;
+
+	if (editor_total > editor_end) editor_total = editor_end;
+
+	for (int i=0; i<command_size; i++) command_string[i] = 0x00;
+};
+
+unsigned int basic_indexline(int pos)
+{
+	return (unsigned int)x6502_read((unsigned char)((pos*4)%256), (unsigned char)(basic_index+(pos*4)/256)) * 256 +
+		(unsigned int)x6502_read((unsigned char)((pos*4+1)%256), (unsigned char)(basic_index+(pos*4)/256));
+};
+
+unsigned int basic_indexaddr(int pos)
+{
+	return (unsigned int)x6502_read((unsigned char)((pos*4+2)%256), (unsigned char)(basic_index+(pos*4)/256)) * 256 +
+		(unsigned int)x6502_read((unsigned char)((pos*4+3)%256), (unsigned char)(basic_index+(pos*4)/256));
+};
+
+void basic_indexset(int pos, unsigned int line, unsigned int addr)
+{
+	x6502_write((unsigned char)((pos*4)%256), (unsigned char)(basic_index+(pos*4)/256), (unsigned char)(line/256));
+	x6502_write((unsigned char)((pos*4+1)%256), (unsigned char)(basic_index+(pos*4)/256), (unsigned char)(line%256));
+	x6502_write((unsigned char)((pos*4+2)%256), (unsigned char)(basic_index+(pos*4)/256), (unsigned char)(addr/256));
+	x6502_write((unsigned char)((pos*4+3)%256), (unsigned char)(basic_index+(pos*4)/256), (unsigned char)(addr%256));
+};
+
+int basic_indexfind(unsigned int line) // first position with a line number of at least 'line'
+{
+	int temp_low = 0;
+	int temp_high = basic_index_total;
+	int temp_mid;
+
+	while (temp_low < temp_high)
+	{
+		temp_mid = (temp_low + temp_high) / 2;
+
+		if (basic_indexline(temp_mid) < line) temp_low = temp_mid + 1;
+		else temp_high = temp_mid;
+	}
+
+	return temp_low;
+};
+
+void basic_jumpclear()
+{
+	for (int i=0; i<basic_jumps; i++)
+	{
+		basic_code[basic_jumped+i*4] = 0x00;
+		basic_code[basic_jumped+i*4+1] = 0x00;
+	}
+};
+
+void basic_indexbuild() // one pass over the program
+{
+	unsigned int temp_addr = editor_start;
+	unsigned int temp_line;
+
+	basic_jumpclear();
+
+	basic_index_total = 0;
+
+	while (temp_addr + 1 < editor_total)
+	{
+		temp_line = (unsigned int)x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
+		
+		temp_line *= (unsigned int)256;
+		
+		temp_line += (unsigned int)x6502_read((unsigned char)((temp_addr+1)&0x00FF), (unsigned char)(((temp_addr+1)&0xFF00)>>8));
+
+		temp_line = temp_line % 32768;
+
+		if (temp_line == 0x0000) break;
+
+		if (basic_index_total >= basic_index_size)
 		{
-			x6502_absx();
-			x6502_write(x6502_U, x6502_V, x6502_inc(x6502_read(x6502_U, x6502_V)));
-			break;
+			basic_index_total = -2; // GOTO goes back to scanning
+
+			return;
 		}
-		default:
+
+		basic_indexset(basic_index_total, temp_line, temp_addr);
+
+		basic_index_total++;
+
+		temp_addr += 2;
+
+		while (temp_addr < editor_total)
 		{
-			return 0;
+			if (x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8)) == 0x10) break;
+
+			temp_addr++;
 		}
+
+		temp_addr++;
 	}
+};
 
-	return 1;
+void basic_indexinsert(unsigned int line, unsigned int addr, unsigned int len) // after the editor moved later lines up by 'len'
+{
+	if (basic_index_total < 0)
+	{
+		basic_index_total = -1; // try again on the next GOTO
+
+		return;
+	}
+
+	basic_jumpclear();
+
+	if (basic_index_total >= basic_index_size)
+	{
+		basic_index_total = -1;
+
+		return;
+	}
+
+	int temp_pos = basic_indexfind(line);
+
+	for (int i=basic_index_total; i>temp_pos; i--)
+	{
+		basic_indexset(i, basic_indexline(i-1), basic_indexaddr(i-1) + len);
+	}
+
+	basic_indexset(temp_pos, line, addr);
+
+	basic_index_total++;
 };
 
-void x6502_reset()
+void basic_indexdelete(unsigned int line, unsigned int len) // after the editor moved later lines down by 'len'
 {
-	x6502_A = 0x00;
-	x6502_X = 0x00;
-	x6502_Y = 0x00;
-	x6502_L = 0x00;
-	x6502_H = 0x00;
-	x6502_S = 0xFF;
-	x6502_F = 0x00;
+	if (basic_index_total < 0)
+	{
+		basic_index_total = -1; // try again on the next GOTO
+
+		return;
+	}
+
+	basic_jumpclear();
+
+	int temp_pos = basic_indexfind(line);
+
+	if (temp_pos >= basic_index_total || basic_indexline(temp_pos) != line)
+	{
+		basic_index_total = -1;
+
+		return;
+	}
+
+	for (int i=temp_pos; i<basic_index_total-1; i++)
+	{
+		basic_indexset(i, basic_indexline(i+1), basic_indexaddr(i+1) - len);
+	}
+
+	basic_index_total--;
 };
 
-void x6502_run(unsigned char BL, unsigned char BH)
+int basic_variable(unsigned char place, int offset) // kept with the sign in the top bit, read straight from SRAM
 {
-	x6502_L = BL;
-	x6502_H = BH;
+	int temp_value;
+	unsigned char temp_low;
 
-	while (x6502_instruction()) {} 
+	if (place < 'W') temp_low = (unsigned char)((int)(place-'A')*32+(int)(offset%16)*2);
+	else temp_low = (unsigned char)((int)(place-'W')*32+128+(int)(offset%16)*2);
 
-	return;
+	temp_value = (int)shared_memory[basic_variables*256+temp_low];
+
+	temp_low++;
+
+	if (shared_memory[basic_variables*256+temp_low] >= 0x80) // negative
+	{
+		temp_value += (int)((int)(shared_memory[basic_variables*256+temp_low]&0x7F)*256);
+
+		temp_value *= -1;
+	}
+	else
+	{
+		temp_value += (int)((int)shared_memory[basic_variables*256+temp_low]*256);
+	}
+
+	return temp_value;
 };
 
+void basic_stash() // both pages of shared_memory into extended RAM, the index is rebuilt once they are back
+{
+	display_sendblock((unsigned char)(basic_stashed&0x3F), 0x00, shared_memory, 512);
 
-const unsigned char command_size = 64;
-unsigned char command_string[command_size];
+	basic_index_total = -1;
+};
 
-unsigned int editor_start = 0x5000; // change later if need be
-unsigned int editor_end = 0x6000; // change later if need be
-unsigned int editor_blocks = 8; // 512 blocks to be saved to SD card
-unsigned int editor_total = editor_start + 256;
-char editor_character = 0x00;
-char editor_prompt = '\\';
-char editor_prompt_caps = '|';
+void basic_unstash()
+{
+	display_receiveblock((unsigned char)(basic_stashed&0x3F), 0x00, shared_memory, 512);
+};
+
+int basic_replay(unsigned char page) // the variables as EEPROM holds them, into a page of shared_memory, returns the records in use
+{
+	unsigned char temp_lap = eeprom_read((unsigned char)(basic_journal_lap%256), (unsigned char)(basic_journal_lap/256));
+	unsigned int temp_addr;
+	int temp_used = 0;
 
-unsigned char monitor_addr_start_nibble[4];
-unsigned char monitor_addr_stop_nibble[4];
-unsigned char monitor_data_nibble[2];
+	if (temp_lap == 0x00 || temp_lap == 0xFF) // never saved, and full so that the first basic_keep() writes every byte
+	{
+		for (int i=0; i<256; i++) shared_memory[page*256+i] = 0x00;
+
+		return basic_journal_size;
+	}
 
-unsigned char basic_variables = 0x00; // 256 byte page
+	eeprom_read_block(&shared_memory[page*256], (const void *)basic_kept, 256);
 
-const unsigned char editor_text[480] PROGMEM = 
-	"BASIC Keywords:\n  IF [THEN or END], GOTO, MON\" \",\n  PRINT, INPUT, SING\nVariable Arrays: ABCDWXYZ! with ()\nMath Operators: +*-/%\nComparator Operators: =#<>\nMonitor Example:\n  MON \"0000:EE0F00DC;JJJ,0000.000F\"\nPrime Numbers Example:\n  10 PRINT 'TYPE NUMBER'\n  20 INPUT X\n  30 A = 2\n  40 PRINT A, ';'\n  50 A = A + 1\n  60 IF A > X THEN GOTO 10000\n  70 B = A - 1\n  80 IF A % B = 0 THEN GOTO 50\n  90 B = B - 1\n  100 IF B = 1 THEN GOTO 40\n  110 GOTO 80_";
+	while (temp_used < basic_journal_size)
+	{
+		temp_addr = basic_journal + (unsigned int)temp_used*3;
+
+		if (eeprom_read((unsigned char)(temp_addr%256), (unsigned char)(temp_addr/256)) != temp_lap) break; // left from the last lap
+
+		shared_memory[page*256+eeprom_read((unsigned char)((temp_addr+1)%256), (unsigned char)((temp_addr+1)/256))] =
+			eeprom_read((unsigned char)((temp_addr+2)%256), (unsigned char)((temp_addr+2)/256));
+
+		temp_used++;
+	}
 
+	return temp_used;
+};
 
-unsigned char editor_break()
+void basic_keep() // adds the variables that changed to the journal in EEPROM, using the postfix page to compare
 {
-	if (editor_character == editor_prompt || editor_character == editor_prompt_caps || editor_character == 0x1B)
+	unsigned char temp_lap;
+	unsigned int temp_addr;
+	int temp_used;
+
+	if ((x6502_shared_written & (0x01 << basic_variables)) == 0x00) return; // EEPROM already has them, or they are all still zero
+
+	basic_stash(); // the postfix page is the 6502 stack too
+
+	temp_lap = eeprom_read((unsigned char)(basic_journal_lap%256), (unsigned char)(basic_journal_lap/256));
+	temp_used = basic_replay(basic_compiled);
+
+	for (int i=0; i<256; i++)
 	{
-		return 0x01; // slash (or ESC) to break
+		if (shared_memory[basic_variables*256+i] == shared_memory[basic_compiled*256+i]) continue;
+
+		if (temp_used >= basic_journal_size) // the whole page replaces the old one, then a new lap starts
+		{
+			for (int j=0; j<256; j++)
+			{
+				eeprom_write((unsigned char)((basic_kept+j)%256), (unsigned char)((basic_kept+j)/256), shared_memory[basic_variables*256+j]);
+			}
+
+			if (temp_lap == 0x00 || temp_lap >= 0xFE) temp_lap = 0x01;
+			else temp_lap++;
+
+			if (eeprom_read((unsigned char)(basic_journal%256), (unsigned char)(basic_journal/256)) == temp_lap) // older bytes that happen to match
+			{
+				eeprom_write((unsigned char)(basic_journal%256), (unsigned char)(basic_journal/256), 0x00);
+			}
+
+			eeprom_write((unsigned char)(basic_journal_lap%256), (unsigned char)(basic_journal_lap/256), temp_lap);
+
+			break;
+		}
+
+		temp_addr = basic_journal + (unsigned int)temp_used*3;
+
+		eeprom_write((unsigned char)((temp_addr+1)%256), (unsigned char)((temp_addr+1)/256), (unsigned char)i);
+		eeprom_write((unsigned char)((temp_addr+2)%256), (unsigned char)((temp_addr+2)/256), shared_memory[basic_variables*256+i]);
+
+		if (temp_used+1 < basic_journal_size && eeprom_read((unsigned char)((temp_addr+3)%256), (unsigned char)((temp_addr+3)/256)) == temp_lap)
+		{
+			eeprom_write((unsigned char)((temp_addr+3)%256), (unsigned char)((temp_addr+3)/256), 0x00); // so the next record cannot count before it is written
+		}
+
+		eeprom_write((unsigned char)(temp_addr%256), (unsigned char)(temp_addr/256), temp_lap); // last, so a record only counts once it is whole
+
+		temp_used++;
 	}
 
-	editor_character = keyboard_character();
-	
-	return 0x00;
+	basic_unstash();
+
+	x6502_shared_written &= (unsigned char)(~(0x01 << basic_variables));
 };
 
-void editor_checkmemory()
+void basic_compiledclear()
 {
-	// checking for RAM expansion
-	x6502_write((unsigned char)(editor_start%256), (unsigned char)(editor_start/256), 0xA5);
+	for (int i=0; i<basic_compiled_slots; i++) basic_code[(unsigned char)(i*3+2)] = 0x00;
 
-	if (x6502_read((unsigned char)(editor_start%256), (unsigned char)(editor_start/256+0x20)) == 0xA5)
+	basic_compiled_next = basic_compiled_code;
+};
+
+void basic_emit(unsigned char &code, unsigned char value) // one byte of postfix, the last byte of the page is left for the end
+{
+	if (code < 0xFF)
+	{
+		basic_code[code] = value;
+
+		code++;
+	}
+};
+
+void basic_emitnumber(unsigned char &code, int value)
+{
+	if (value >= 0 && value <= 9)
+	{
+		basic_emit(code, (unsigned char)(value + 0x30));
+	}
+	else if (value >= 0 && value <= 255)
 	{
-		editor_end = editor_start + 0x1800; // only 8KB available
-		editor_blocks = 12;
+		basic_emit(code, basic_code_byte);
+		basic_emit(code, (unsigned char)value);
 	}
 	else
 	{
-		editor_end = editor_start + 0x3800; // full 16KB available
-		editor_blocks = 28;
+		basic_emit(code, basic_code_word);
+		basic_emit(code, (unsigned char)((unsigned int)value%256));
+		basic_emit(code, (unsigned char)(((unsigned int)value/256)%256));
 	}
+};
 
-	x6502_write((unsigned char)(editor_start%256), (unsigned char)(editor_start/256), 0x00);
+unsigned char basic_precedence(unsigned char operation) // zero for open parentheses, which only a close takes off
+{
+	if (operation == basic_code_negate) return 0x03;
+	else if (operation == '*' || operation == '/' || operation == '%') return 0x02;
+	else if (operation == '+' || operation == '-') return 0x01;
+	else return 0x00;
 };
 
-unsigned char editor_load()
+int basic_compile(unsigned int &addr, unsigned char &code) // one expression into postfix, stopping where basic_number() always has
 {
-	unsigned char v = 0x00;
+	unsigned char temp_stack[basic_depth]; // operators waiting for their second value, '(' and lower case variables for open parentheses
+	int temp_top = 0;
 
-	for (int init=0; init<5; init++)
+	unsigned char temp_char;
+	unsigned char temp_next;
+	unsigned char temp_operand = 0x00; // 0x01 after a value, when an operator comes next
+	unsigned char temp_digits = 0x00; // 0x01 while ASCII digits add up
+	int temp_value = 0;
+
+	int key = 0;
+
+	while (addr < editor_total)
 	{
-		if (editor_break()) break;
+		if (editor_break()) { key = 1; break; }
 
-		if (sdcard_initialize())
+		temp_char = (unsigned int)x6502_read((unsigned char)(addr&0x00FF), (unsigned char)((addr&0xFF00)>>8));
+
+		addr++;
+
+		if (temp_digits == 0x01)
 		{
-			v = 0x01;
+			if (temp_char >= 0x30 && temp_char <= 0x39) // number value, as typed before keywords were tokens
+			{
+				temp_value *= 10;
+				temp_value += (int)(temp_char - 0x30);
+
+				continue;
+			}
 
-			for (int i=0; i<editor_blocks; i++)
+			basic_emitnumber(code, temp_value);
+
+			temp_digits = 0x00;
+		}
+
+		if (temp_char == 'A' || temp_char == 'B' || temp_char == 'C' || temp_char == 'D' ||
+			temp_char == 'W' || temp_char == 'X' || temp_char == 'Y' || temp_char == 'Z' || temp_char == '!' ||
+			(temp_char >= 0x30 && temp_char <= 0x39) || (temp_char >= basic_token_byte && temp_char <= basic_token_long))
+		{
+			if (temp_operand == 0x01) // two values in a row, the second starts something else
 			{
-				if (editor_break()) break;
+				addr--;
+
+				break;
+			}
+
+			if (temp_char == '!') // random number
+			{
+				basic_emit(code, '!');
+			}
+			else if (temp_char >= 0x30 && temp_char <= 0x39)
+			{
+				temp_value = (int)(temp_char - 0x30);
+
+				temp_digits = 0x01;
+			}
+			else if (temp_char >= basic_token_byte) // number value, two digits or more
+			{
+				basic_emitnumber(code, (int)basic_constant(temp_char, addr));
+			}
+			else // variable value
+			{
+				temp_next = (unsigned int)x6502_read((unsigned char)(addr&0x00FF), (unsigned char)((addr&0xFF00)>>8));
 
-				if (!sdcard_readblock(0x00,(unsigned char)(0x02*i)))
+				if ((temp_next == '(' || temp_next == '[') && temp_top < basic_depth)
 				{
-					v = 0x00;
+					addr++;
+
+					temp_stack[temp_top] = temp_char + 0x20; // looked up when its parenthesis closes
+					temp_top++;
+
+					continue;
 				}
-			
-				for (int j=0; j<512; j++)
-				{
-					if (editor_break()) break;
 
-					x6502_write((unsigned char)(j%256), (unsigned char)(((editor_start&0xFF00)>>8)+(int)(0x02*i)+(int)(j/256)), shared_memory[j]);
+				basic_emit(code, temp_char);
+			}
+
+			temp_operand = 0x01;
+		}
+		else if (temp_char == '+' || temp_char == '-' || temp_char == '*' || temp_char == '/' || temp_char == '%')
+		{
+			if (temp_operand == 0x00)
+			{
+				if (temp_char == '-' && temp_top < basic_depth) // negative
+				{
+					temp_stack[temp_top] = basic_code_negate;
+					temp_top++;
 				}
+
+				continue; // and plus does nothing
+			}
+
+			while (temp_top > 0 && basic_precedence(temp_stack[temp_top-1]) >= basic_precedence(temp_char))
+			{
+				temp_top--;
+
+				basic_emit(code, temp_stack[temp_top]);
+			}
+
+			if (temp_top >= basic_depth)
+			{
+				addr--;
+
+				break;
+			}
+
+			temp_stack[temp_top] = temp_char;
+			temp_top++;
+
+			temp_operand = 0x00;
+		}
+		else if (temp_char == '(' || temp_char == '[')
+		{
+			if (temp_operand == 0x01 || temp_top >= basic_depth)
+			{
+				addr--;
+
+				break;
 			}
+
+			temp_stack[temp_top] = '(';
+			temp_top++;
 		}
-	}
+		else if (temp_char == ')' || temp_char == ']')
+		{
+			if (temp_operand == 0x00) basic_emit(code, '0');
 
-	for (int i=0; i<512; i++) shared_memory[i] = eeprom_read((unsigned char)(i%256), (unsigned char)(i/256));
+			temp_operand = 0x01;
 
-	return v;
-};
+			while (temp_top > 0 && basic_precedence(temp_stack[temp_top-1]) > 0x00)
+			{
+				temp_top--;
 
-unsigned char editor_save()
-{
-	unsigned char v = 0x00;
+				basic_emit(code, temp_stack[temp_top]);
+			}
 
-	unsigned char key = 0x00;
+			if (temp_top == 0) break; // closes a variable's parentheses, as before
 
-	for (int i=0; i<512; i++) eeprom_write((unsigned char)(i%256), (unsigned char)(i/256), shared_memory[i]);
+			temp_top--;
 
-	for (int init=0; init<5; init++)
-	{
-		if (editor_break()) break;
+			if (temp_stack[temp_top] != '(') basic_emit(code, temp_stack[temp_top]);
+		}
+		else if (temp_char == '=' || temp_char == '#' || temp_char == '<' || temp_char == '>' || temp_char == 'T' ||
+			temp_char == '"' || temp_char == '\'' || temp_char == ',' || temp_char == '.' || temp_char == ':' || temp_char == ';' ||
+			(temp_char >= basic_token_print && temp_char <= basic_token_mon) || temp_char == 0x10)
+		{
+			addr--;
 
-		if (sdcard_initialize())
-		{	
-			v = 0x01;
+			break;
+		}
+		else
+		{
+			// ignore
+		}
+	}
 
-			for (int i=0; i<editor_blocks; i++)
-			{
-				if (editor_break()) break;
+	if (temp_digits == 0x01) basic_emitnumber(code, temp_value);
 
-				for (int j=0; j<512; j++)
-				{
-					if (editor_break()) break;
+	if (temp_operand == 0x00) basic_emit(code, '0'); // nothing after the last operator counts as zero
 
-					shared_memory[j] = x6502_read((unsigned char)(j%256), (unsigned char)(((editor_start&0xFF00)>>8)+(int)(0x02*i)+(int)(j/256)));
-				}
+	while (temp_top > 0)
+	{
+		temp_top--;
 
-				if (!sdcard_writeblock(0x00,(unsigned char)(0x02*i)))
-				{
-					v = 0x00;
-				}
-			}
-		}
+		if (temp_stack[temp_top] != '(') basic_emit(code, temp_stack[temp_top]);
 	}
 
-	for (int i=0; i<512; i++) shared_memory[i] = eeprom_read((unsigned char)(i%256), (unsigned char)(i/256));
+	basic_emit(code, basic_code_end);
 
-	return v;
-};
-	
-void monitor_execute(int start, int end)
-{
-	unsigned char addr_pos = 0x00;
-	unsigned char addr_offset = 0x00;
-	unsigned char data_pos = 0x00;
+	if (code == 0xFF) basic_code[code] = basic_code_end; // cut short at the end of the page
 
-	unsigned int temp_addr;
-	unsigned int temp_offset;
-	unsigned char temp_data;
+	return key;
+};
 
-	//for (int i=0; i<4; i++) monitor_addr_start_nibble[i] = 0x00;
-	//for (int i=0; i<4; i++) monitor_addr_stop_nibble[i] = 0x00;
-	//for (int i=0; i<2; i++) monitor_data_nibble[i] = 0x00;
+int basic_run(unsigned char code) // postfix from basic_compile(), touching nothing but the variables
+{
+	int temp_stack[basic_depth+1];
+	int temp_top = 0;
 
-	unsigned char key = 0x00;
+	int temp_value;
+	int temp_left;
+	unsigned char temp_char;
 
-	bool printed = false;
+	while (1)
+	{
+		temp_char = basic_code[code];
 
-	if (start < 0 || end > command_size) return;
+		code++;
 
-	for (int i=start; i<end; i++)
-	{
-		if (editor_break()) break;
+		if (temp_char == basic_code_end) break;
+		else if (temp_char >= 0x30 && temp_char <= 0x39)
+		{
+			temp_value = (int)(temp_char - 0x30);
+		}
+		else if (temp_char == basic_code_byte)
+		{
+			temp_value = (int)basic_code[code];
 
-		if (command_string[i] == 'J') // jump
+			code++;
+		}
+		else if (temp_char == basic_code_word)
 		{
-			addr_offset = 0x00;
+			temp_value = (int)((unsigned int)basic_code[code] + (unsigned int)basic_code[code+1] * 256);
 
-			temp_addr = (unsigned int)((monitor_addr_start_nibble[0] << 12) + (monitor_addr_start_nibble[1] << 8) + 
-				(monitor_addr_start_nibble[2] << 4) + monitor_addr_start_nibble[3] + addr_offset);
+			code += 2;
+		}
+		else if (temp_char >= 'A' && temp_char <= 'Z')
+		{
+			temp_value = basic_variable(temp_char, 0);
+		}
+		else if (temp_char >= 'a' && temp_char <= 'z') // with the offset on the stack
+		{
+			if (temp_top > 0) temp_top--;
 
-			x6502_run((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
+			temp_value = basic_variable(temp_char - 0x20, temp_stack[temp_top]);
+		}
+		else if (temp_char == '!') // random number
+		{
+			temp_value = random(32768);
+		}
+		else if (temp_char == basic_code_negate)
+		{
+			if (temp_top > 0) temp_stack[temp_top-1] *= -1;
 
-			addr_pos = 0x00;
-			addr_offset = 0x00;
-			data_pos = 0x00;
+			continue;
 		}
-		else if ((command_string[i] >= 0x30 && command_string[i] <= 0x39) || 
-			(command_string[i] >= 0x41 && command_string[i] <= 0x46))
+		else
 		{
-			if (command_string[i] >= 0x30 && command_string[i] <= 0x39)
+			temp_value = 0;
+			temp_left = 0;
+
+			if (temp_top > 0) { temp_top--; temp_value = temp_stack[temp_top]; }
+			if (temp_top > 0) { temp_top--; temp_left = temp_stack[temp_top]; }
+
+			if (temp_char == '+') // add
 			{
-				temp_data = (unsigned char)(command_string[i] - 0x30);
+				temp_value = temp_left + temp_value;
 			}
-			else if (command_string[i] >= 0x41 && command_string[i] <= 0x46)
+			else if (temp_char == '-') // sub
 			{
-				temp_data = (unsigned char)(command_string[i] - 0x41 + 0x0A);
+				temp_value = temp_left - temp_value;
 			}
-
-			if (data_pos == 0x00)
+			else if (temp_char == '*') // mul
 			{
-				if (addr_pos < 0x04)
-				{
-					monitor_addr_start_nibble[addr_pos] = temp_data;
-					addr_pos++;
+				temp_value = temp_left * temp_value;
+			}
+			else if (temp_char == '/') // div
+			{
+				temp_value = temp_left / temp_value;
+			}
+			else if (temp_char == '%') // mod
+			{
+				temp_value = temp_left % temp_value;
+			}
+		}
 
-					if (addr_pos == 0x04)
-					{
-						addr_pos = 0x00;
-	
-						keyboard_print(0x0D);
+		if (temp_top <= basic_depth)
+		{
+			temp_stack[temp_top] = temp_value;
+			temp_top++;
+		}
+	}
 
-						addr_offset = 0x00;
-	
-						temp_addr = (unsigned int)((monitor_addr_start_nibble[0] << 12) + (monitor_addr_start_nibble[1] << 8) + 
-							(monitor_addr_start_nibble[2] << 4) + monitor_addr_start_nibble[3] + addr_offset);
-	
-						if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x09) keyboard_print(((temp_addr&0xF000)>>12) + '0');
-						else if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x0F) keyboard_print(((temp_addr&0xF000)>>12) + 'A' - 0x0A);
-	
-						if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x09) keyboard_print(((temp_addr&0x0F00)>>8) + '0');
-						else if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x0F) keyboard_print(((temp_addr&0x0F00)>>8) + 'A' - 0x0A);
-	
-						if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x09) keyboard_print(((temp_addr&0x00F0)>>4) + '0');
-						else if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x0F) keyboard_print(((temp_addr&0x00F0)>>4) + 'A' - 0x0A);
-	
-						if ((unsigned char)(temp_addr&0x000F) <= 0x09) keyboard_print((temp_addr&0x000F) + '0');
-						else if ((unsigned char)(temp_addr&0x00F) <= 0x0F) keyboard_print((temp_addr&0x000F) + 'A' - 0x0A);
-	
-						keyboard_print(':');
-						keyboard_print(' ');
-				
-						temp_data = x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
-	
-						if ((unsigned char)((temp_data&0xF0)>>4) <= 0x09) keyboard_print(((temp_data&0xF0)>>4) + '0');
-						else if ((unsigned char)((temp_data&0xF0)>>4) <= 0x0F) keyboard_print(((temp_data&0xF0)>>4) + 'A' - 0x0A);
-						
-						if ((unsigned char)(temp_data&0x0F) <= 0x09) keyboard_print((temp_data&0x0F) + '0');
-						else if ((unsigned char)(temp_data&0x0F) <= 0x0F) keyboard_print((temp_data&0x0F) + 'A' - 0x0A);
+	if (temp_top > 0) return temp_stack[temp_top-1];
+	else return 0;
+};
 
-						keyboard_print(' ');
+int basic_number(unsigned int &addr, int &num) // the expression at 'addr' is compiled the first time, and only run after that
+{
+	unsigned char temp_slot = (unsigned char)((addr ^ (addr >> 4)) & (basic_compiled_slots-1));
+	unsigned char temp_code;
+	unsigned char temp_end;
+	unsigned char temp_used = 0x00; // slots
+	unsigned int temp_start = addr;
 
-						printed = true;
-					}
-				}
-				else
-				{
-					monitor_addr_stop_nibble[addr_pos-0x08] = temp_data;
-					addr_pos++;
+	int key = 0;
 
-					if (addr_pos == 0x0C)
-					{
-						addr_pos = 0x08;
+	for (int i=0; i<basic_compiled_slots; i++)
+	{
+		temp_code = basic_code[(unsigned char)(temp_slot*3+2)];
 
-						addr_offset = 0x00;
+		if (temp_code == 0x00) break; // not here yet
 
-						temp_addr = (unsigned int)((monitor_addr_start_nibble[0] << 12) + (monitor_addr_start_nibble[1] << 8) + 
-							(monitor_addr_start_nibble[2] << 4) + monitor_addr_start_nibble[3] + addr_offset);
+		if (basic_code[(unsigned char)(temp_slot*3)] == (unsigned char)(addr/256) &&
+			basic_code[(unsigned char)(temp_slot*3+1)] == (unsigned char)(addr%256))
+		{
+			addr += (unsigned int)basic_code[temp_code]; // where the text of the expression ends
 
-						temp_offset = (unsigned int)((monitor_addr_stop_nibble[0] << 12) + (monitor_addr_stop_nibble[1] << 8) + 
-							(monitor_addr_stop_nibble[2] << 4) + monitor_addr_stop_nibble[3] + addr_offset);
-	
-						if (!printed)
-						{
-							keyboard_print(0x0D);
+			num = basic_run(temp_code+1);
 
-							temp_addr = (unsigned int)((monitor_addr_start_nibble[0] << 12) + (monitor_addr_start_nibble[1] << 8) + 
-								(monitor_addr_start_nibble[2] << 4) + monitor_addr_start_nibble[3] + addr_offset);
-	
-							if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x09) keyboard_print(((temp_addr&0xF000)>>12) + '0');
-							else if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x0F) keyboard_print(((temp_addr&0xF000)>>12) + 'A' - 0x0A);
-	
-							if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x09) keyboard_print(((temp_addr&0x0F00)>>8) + '0');
-							else if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x0F) keyboard_print(((temp_addr&0x0F00)>>8) + 'A' - 0x0A);
-	
-							if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x09) keyboard_print(((temp_addr&0x00F0)>>4) + '0');
-							else if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x0F) keyboard_print(((temp_addr&0x00F0)>>4) + 'A' - 0x0A);
-	
-							if ((unsigned char)(temp_addr&0x000F) <= 0x09) keyboard_print((temp_addr&0x000F) + '0');
-							else if ((unsigned char)(temp_addr&0x00F) <= 0x0F) keyboard_print((temp_addr&0x000F) + 'A' - 0x0A);
-	
-							keyboard_print(':');
-							keyboard_print(' ');
-				
-							temp_data = x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
-	
-							if ((unsigned char)((temp_data&0xF0)>>4) <= 0x09) keyboard_print(((temp_data&0xF0)>>4) + '0');
-							else if ((unsigned char)((temp_data&0xF0)>>4) <= 0x0F) keyboard_print(((temp_data&0xF0)>>4) + 'A' - 0x0A);
-						
-							if ((unsigned char)(temp_data&0x0F) <= 0x09) keyboard_print((temp_data&0x0F) + '0');
-							else if ((unsigned char)(temp_data&0x0F) <= 0x0F) keyboard_print((temp_data&0x0F) + 'A' - 0x0A);
+			return key;
+		}
 
-							keyboard_print(' ');
+		temp_slot = (temp_slot + 1) % basic_compiled_slots;
+	}
 
-							printed = true;
-						}
+	for (int i=0; i<basic_compiled_slots; i++)
+	{
+		if (basic_code[(unsigned char)(i*3+2)] != 0x00) temp_used++;
+	}
 
-						while (temp_addr < temp_offset)
-						{
-							if (editor_break()) break;
+	if (temp_used >= basic_compiled_full || basic_compiled_next > 0xFF - basic_compiled_room)
+	{
+		basic_compiledclear(); // start over, loops soon fill it again with what they use
 
-							temp_addr++;
-	
-							if (temp_addr % 0x08 == 0x00)
-							{
-								keyboard_print(0x0D);
-	
-								if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x09) keyboard_print(((temp_addr&0xF000)>>12) + '0');
-								else if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x0F) keyboard_print(((temp_addr&0xF000)>>12) + 'A' - 0x0A);
-	
-								if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x09) keyboard_print(((temp_addr&0x0F00)>>8) + '0');
-								else if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x0F) keyboard_print(((temp_addr&0x0F00)>>8) + 'A' - 0x0A);
-	
-								if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x09) keyboard_print(((temp_addr&0x00F0)>>4) + '0');
-								else if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x0F) keyboard_print(((temp_addr&0x00F0)>>4) + 'A' - 0x0A);
-	
-								if ((unsigned char)(temp_addr&0x000F) <= 0x09) keyboard_print((temp_addr&0x000F) + '0');
-								else if ((unsigned char)(temp_addr&0x00F) <= 0x0F) keyboard_print((temp_addr&0x000F) + 'A' - 0x0A);
-	
-								keyboard_print(':');
-								keyboard_print(' ');
-							}
-				
-							temp_data = x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
-	
-							if ((unsigned char)((temp_data&0xF0)>>4) <= 0x09) keyboard_print(((temp_data&0xF0)>>4) + '0');
-							else if ((unsigned char)((temp_data&0xF0)>>4) <= 0x0F) keyboard_print(((temp_data&0xF0)>>4) + 'A' - 0x0A);
-						
-							if ((unsigned char)(temp_data&0x0F) <= 0x09) keyboard_print((temp_data&0x0F) + '0');
-							else if ((unsigned char)(temp_data&0x0F) <= 0x0F) keyboard_print((temp_data&0x0F) + 'A' - 0x0A);
+		temp_slot = (unsigned char)((addr ^ (addr >> 4)) & (basic_compiled_slots-1));
+	}
 
-							keyboard_print(' ');
+	temp_code = basic_compiled_next;
+	temp_end = temp_code + 1; // after the length
 
-							printed = true;
-						}
-					}
-				}
-			}
-			else
-			{
-				monitor_data_nibble[data_pos - 0x01] = temp_data;
-				data_pos++;
+	num = 0;
 
-				if (data_pos == 0x03)
-				{
-					data_pos = 0x01;
-					
-					temp_addr = (unsigned int)((monitor_addr_start_nibble[0] << 12) + (monitor_addr_start_nibble[1] << 8) + 
-						(monitor_addr_start_nibble[2] << 4) + monitor_addr_start_nibble[3] + addr_offset);
+	key = basic_compile(addr, temp_end);
 
-					x6502_write((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8), 
-						(unsigned char)((monitor_data_nibble[0] << 4) + monitor_data_nibble[1]));
+	if (key == 1) return key;
 
-					addr_offset++;
-				}
-			}
-		}
-		else if (command_string[i] == '.')
-		{
-			addr_pos = 0x08;
-		}
-		else if (command_string[i] == ',')
-		{
-			addr_pos = 0x00;
-		}
-		else if (command_string[i] == ':')
-		{
-			data_pos = 0x01;
-		}
-		else if (command_string[i] == ';')
-		{
-			data_pos = 0x00;
-		}
-		else
-		{
-			// ignore
-		}
+	if (addr - temp_start < 256) // otherwise only used this once
+	{
+		basic_code[temp_code] = (unsigned char)(addr - temp_start);
+
+		basic_code[(unsigned char)(temp_slot*3)] = (unsigned char)(temp_start/256);
+		basic_code[(unsigned char)(temp_slot*3+1)] = (unsigned char)(temp_start%256);
+		basic_code[(unsigned char)(temp_slot*3+2)] = temp_code;
+
+		basic_compiled_next = temp_end;
 	}
 
-	if (!printed)
-	{
-		keyboard_print(0x0D);
+	num = basic_run(temp_code+1);
 
-		addr_offset = 0x00;
+	return key;
+};
 
-		temp_addr = (unsigned int)((monitor_addr_start_nibble[0] << 12) + (monitor_addr_start_nibble[1] << 8) + 
-			(monitor_addr_start_nibble[2] << 4) + monitor_addr_start_nibble[3] + addr_offset);
-	
-		if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x09) keyboard_print(((temp_addr&0xF000)>>12) + '0');
-		else if ((unsigned char)((temp_addr&0xF000)>>12) <= 0x0F) keyboard_print(((temp_addr&0xF000)>>12) + 'A' - 0x0A);
-	
-		if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x09) keyboard_print(((temp_addr&0x0F00)>>8) + '0');
-		else if ((unsigned char)((temp_addr&0x0F00)>>8) <= 0x0F) keyboard_print(((temp_addr&0x0F00)>>8) + 'A' - 0x0A);
-	
-		if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x09) keyboard_print(((temp_addr&0x00F0)>>4) + '0');
-		else if ((unsigned char)((temp_addr&0x00F0)>>4) <= 0x0F) keyboard_print(((temp_addr&0x00F0)>>4) + 'A' - 0x0A);
-	
-		if ((unsigned char)(temp_addr&0x000F) <= 0x09) keyboard_print((temp_addr&0x000F) + '0');
-		else if ((unsigned char)(temp_addr&0x00F) <= 0x0F) keyboard_print((temp_addr&0x000F) + 'A' - 0x0A);
-	
-		keyboard_print(':');
-		keyboard_print(' ');
-				
-		temp_data = x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
-	
-		if ((unsigned char)((temp_data&0xF0)>>4) <= 0x09) keyboard_print(((temp_data&0xF0)>>4) + '0');
-		else if ((unsigned char)((temp_data&0xF0)>>4) <= 0x0F) keyboard_print(((temp_data&0xF0)>>4) + 'A' - 0x0A);
-						
-		if ((unsigned char)(temp_data&0x0F) <= 0x09) keyboard_print((temp_data&0x0F) + '0');
-		else if ((unsigned char)(temp_data&0x0F) <= 0x0F) keyboard_print((temp_data&0x0F) + 'A' - 0x0A);
 
-		keyboard_print(' ');
+const unsigned char basic_tones[7] PROGMEM = { 9, 11, 0, 2, 4, 5, 7 }; // semitones above C for A to G
+
+unsigned char basic_song(unsigned int &addr) // 0x01 and past the quote when SING is followed by music in quotes
+{
+	unsigned int temp_addr = addr;
+	unsigned char temp_char = ' ';
+
+	while (temp_addr < editor_total && temp_char == ' ')
+	{
+		temp_char = x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
+
+		temp_addr++;
 	}
 
-	return;
+	if (temp_char != '"' && temp_char != '\'') return 0x00;
+
+	addr = temp_addr;
+
+	return 0x01;
 };
 
-int basic_number(unsigned int &addr, int &num)
+unsigned char basic_queue(const unsigned char *event, const unsigned char length) // 0x01 on break while the queue is full
 {
-	num = 0;
+	while (audio_room() < length)
+	{
+		if (editor_break()) return 0x01;
 
-	int temp_value = 0;
-	unsigned char temp_char;
-	unsigned char temp_place;
-	int temp_offset;
-	unsigned char temp_byte;
-	unsigned char temp_operation = '=';
+		delay(1);
+	}
 
-	int key = 0;
+	audio_push(event, length);
 
-	temp_offset = 0; // up to 16 each
+	return 0x00;
+};
+
+// SING "V1W3 O4L16 CDEF G32 O5 C+V2E+V3G64 R8" plays notes A to G, with # for sharps and a length in 64ths of a second,
+// + to start the next note at the same time, R to rest, O for the octave from 2 to 7, L for the length when none is given,
+// V for the voice from 1 to 3, and W for its wave, 0 square, 1 triangle, 2 saw, and 3 sine.
+
+unsigned char basic_sing(unsigned int &addr) // the music in quotes, 0x01 on break
+{
+	unsigned char temp_event[2];
+	unsigned char temp_char;
+	unsigned char temp_command = 0x00; // waiting for its number, 'N' for a note
+	unsigned char temp_note = 0x00;
+	unsigned char temp_octave = 4;
+	unsigned char temp_length = 16;
+	unsigned int temp_number = 0;
+	unsigned char temp_digits = 0x00;
 
 	while (addr < editor_total)
 	{
-		if (editor_break()) { key = 1; break; }
-	
-		temp_char = (unsigned int)x6502_read((unsigned char)(addr&0x00FF), (unsigned char)((addr&0xFF00)>>8));
+		if (editor_break()) return 0x01;
+
+		temp_char = x6502_read((unsigned char)(addr&0x00FF), (unsigned char)((addr&0xFF00)>>8));
 
 		addr++;
 
-		if (temp_char == 'A' || temp_char == 'B' || temp_char == 'C' || temp_char == 'D' ||
-			temp_char == 'W' || temp_char == 'X' || temp_char == 'Y' || temp_char == 'Z') // variable value
+		if (temp_char >= 'a' && temp_char <= 'z') temp_char -= 0x20;
+
+		if (temp_char >= '0' && temp_char <= '9')
 		{
-			temp_place = temp_char;
+			temp_number = temp_number * 10 + (unsigned int)(temp_char - '0');
 
-			temp_offset = 0;
+			if (temp_number > 255) temp_number = 255;
 
-			temp_char = (unsigned int)x6502_read((unsigned char)(addr&0x00FF), (unsigned char)((addr&0xFF00)>>8));
+			temp_digits = 0x01;
 
-			if (temp_char == '(' || temp_char == '[')
-			{
-				addr++;
-	
-				key = basic_number(addr, temp_offset);
+			continue;
+		}
 
-				if (key == 1) break;
-			}
+		if (temp_char == '#' && temp_command == 'N')
+		{
+			temp_note++;
 
-			if (temp_place < 'W') temp_byte = x6502_read((unsigned char)((int)(temp_place-'A')*32+(int)(temp_offset%16)*2), basic_variables);
-			else temp_byte = x6502_read((unsigned char)((int)(temp_place-'W')*32+128+(int)(temp_offset%16)*2), basic_variables);
-	
-			temp_value = (int)temp_byte;
-			
-			if (temp_place < 'W') temp_byte = x6502_read((unsigned char)((int)(temp_place-'A')*32+(int)(temp_offset%16)*2+1), basic_variables);
-			else temp_byte = x6502_read((unsigned char)((int)(temp_place-'W')*32+128+(int)(temp_offset%16)*2+1), basic_variables);
+			continue;
+		}
 
-			if (temp_byte >= 0x80) // negative
-			{
-				temp_value += (int)((int)(temp_byte&0x7F)*256);
+		if (temp_command == 'N' || temp_command == 'R')
+		{
+			if (temp_digits == 0x00) temp_number = temp_length;
 
-				temp_value *= -1;
-			}
-			else
+			if (temp_char == '+') temp_number = 0; // chord
+
+			temp_event[0] = (temp_command == 'R' ? audio_event_rest : temp_note);
+			temp_event[1] = (unsigned char)temp_number;
+
+			if (temp_event[0] >= 0x01 && temp_event[0] <= audio_event_rest)
 			{
-				temp_value += (int)((int)temp_byte*256);
+				if (basic_queue(temp_event, 2)) return 0x01;
 			}
 		}
-		else if (temp_char == '!') // random number
-		{
-			temp_value = random(32768);
-		}
-		else if (temp_char >= 0x30 && temp_char <= 0x39) // number value
+		else if (temp_digits == 0x01)
 		{
-			temp_value *= 10;
-			temp_value += (int)(temp_char - 0x30);
-		}
-		else if (temp_char == '=' || temp_char == '#' || temp_char == '<' || temp_char == '>' || temp_char == 'T' || 
-			temp_char == '"' || temp_char == '\'' || temp_char == ',' || temp_char == '.' || temp_char == ':' || temp_char == ';')
-		{
-			if (temp_operation == '=')
-			{
-				num = temp_value;
-			}
-			else if (temp_operation == '+') // add
-			{
-				num += temp_value;
-			}
-			else if (temp_operation == '-') // sub
-			{
-				num -= temp_value;
-			}
-			else if (temp_operation == '*') // mul
+			if (temp_command == 'O' && temp_number >= 2 && temp_number <= 7) temp_octave = (unsigned char)temp_number;
+			else if (temp_command == 'L' && temp_number > 0) temp_length = (unsigned char)temp_number;
+			else if (temp_command == 'V' && temp_number >= 1 && temp_number <= audio_voices)
 			{
-				num *= temp_value;	
-			}
-			else if (temp_operation == '/') // div
-			{
-				num /= temp_value;
-			}
-			else if (temp_operation == '%') // mod
-			{
-				num = num % temp_value;
-			}
-
-			temp_operation = 0x00;
+				temp_event[0] = (unsigned char)(audio_event_voice + temp_number - 1);
 
-			addr--;
-	
-			break;
-		}
-		else if (temp_char == '+' || temp_char == '-' || temp_char == '*' || temp_char == '/' || temp_char == '%') 
-		{
-			if (temp_operation == '=')
-			{
-				num = temp_value;
-			}
-			else if (temp_operation == '+') // add
-			{
-				num += temp_value;
-			}
-			else if (temp_operation == '-') // sub
-			{
-				num -= temp_value;
+				if (basic_queue(temp_event, 1)) return 0x01;
 			}
-			else if (temp_operation == '*') // mul
+			else if (temp_command == 'W' && temp_number <= 3)
 			{
-				num *= temp_value;	
-			}
-			else if (temp_operation == '/') // div
-			{
-				num /= temp_value;
-			}
-			else if (temp_operation == '%') // mod
-			{
-				num = num % temp_value;
+				temp_event[0] = (unsigned char)(audio_event_wave + temp_number);
+
+				if (basic_queue(temp_event, 1)) return 0x01;
 			}
+		}
 
-			temp_value = 0;
+		temp_command = 0x00;
+		temp_number = 0;
+		temp_digits = 0x00;
 
-			temp_operation = temp_char;
-		}
-		else if (temp_char == ')' || temp_char == ']')
+		if (temp_char == '"' || temp_char == '\'') break;
+
+		if (temp_char == 0x10) // no closing quote
 		{
+			addr--;
+
 			break;
 		}
-		else if (temp_char == 0x10)
+
+		if (temp_char >= 'A' && temp_char <= 'G')
 		{
-			addr--;
-	
-			break;
+			temp_command = 'N';
+			temp_note = (unsigned char)((temp_octave - 2) * 12 + pgm_read_byte(&basic_tones[temp_char - 'A']) + 1);
 		}
-		else
+		else if (temp_char == 'R' || temp_char == 'O' || temp_char == 'L' || temp_char == 'V' || temp_char == 'W')
 		{
-			// ignore
+			temp_command = temp_char;
 		}
 	}
 
-	if (temp_operation == '=') // equals
-	{
-		num = temp_value;
-	}
-	else if (temp_operation == '+') // add
-	{
-		num += temp_value;
-	}
-	else if (temp_operation == '-') // sub
-	{
-		num -= temp_value;
-	}
-	else if (temp_operation == '*') // mul
-	{
-		num *= temp_value;	
-	}
-	else if (temp_operation == '/') // div
-	{
-		num /= temp_value;
-	}
-	else if (temp_operation == '%') // mod
-	{
-		num = num % temp_value;
-	}
-
-	return key;
+	return 0x00;
 };
 
 void basic_execute()
@@ -3214,15 +4795,10 @@ void basic_execute()
 	int temp_compare = 0;
 
 	unsigned char temp_char = 0x00;
-	unsigned char temp_read = 0x00;
 
 	int temp_offset = 0x00;
 
-	unsigned int temp_variable = 0x00;
-
-	unsigned char temp_last = 0x00;
-	
-	unsigned char temp_second;
+	basic_compiledclear(); // the program could have changed since the last run
 
 	temp_line = (unsigned int)x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
 					
@@ -3242,9 +4818,7 @@ void basic_execute()
 		
 		temp_addr++;
 
-		temp_second = (unsigned char)x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
-
-		if (temp_char == 'P' && temp_second == 'R') // print
+		if (temp_char == basic_token_print) // print
 		{
 			while (temp_addr < editor_total)
 			{
@@ -3254,6 +4828,7 @@ void basic_execute()
 		
 				if (temp_char == 0x10) break;
 				else if (temp_char == '"' || temp_char == '\'' || (temp_char >= 0x30 && temp_char <= 0x39) || temp_char == '-' ||
+					temp_char == '(' || temp_char == '[' || (temp_char >= basic_token_byte && temp_char <= basic_token_long) ||
 					temp_char == 'A' || temp_char == 'B' || temp_char == 'C' || temp_char == 'D' ||
 					temp_char == 'W' || temp_char == 'X' || temp_char == 'Y' || temp_char == 'Z')
 				{		
@@ -3339,7 +4914,7 @@ void basic_execute()
 			}
 
 		}
-		else if (temp_char == 'I' && temp_second == 'N') // input
+		else if (temp_char == basic_token_input) // input
 		{
 			while (temp_addr < editor_total)
 			{
@@ -3375,7 +4950,7 @@ void basic_execute()
 					{
 						while (editor_character == 0x00)
 						{	
-							if (editor_break()) break;
+							if (editor_key()) break;
 	
 							if (editor_character >= 0x20 &&
 								editor_character <= 0x7F)
@@ -3408,7 +4983,7 @@ void basic_execute()
 		
 						while (editor_character != 0x0D)
 						{	
-							if (editor_break()) break;
+							if (editor_key()) break;
 	
 							if (editor_character >= 0x30 &&
 								editor_character <= 0x39)
@@ -3447,7 +5022,7 @@ void basic_execute()
 				else temp_addr++;
 			}
 		}
-		else if (temp_char == 'I' && temp_second == 'F') // if
+		else if (temp_char == basic_token_if) // if
 		{
 			if (basic_number(temp_addr, temp_num)) break;
 
@@ -3472,68 +5047,30 @@ void basic_execute()
 					{
 						temp_char = (unsigned char)x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
 
-						if (temp_char == 'T') // then (optional)
-						{
-							while (temp_addr < editor_total)
-							{
-								if (editor_break()) break;
-		
-								temp_char = (unsigned char)x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
-			
-								if (temp_char == 0x10) break;
-								else if (temp_char == 'N')
-								{
-									temp_addr++;
-									break;
-								}
-								else temp_addr++;
-							}
+						if (temp_char == basic_token_then) temp_addr++; // then (optional)
 
-							break;
-						}
-						else
-						{
-							break;
-						}
+						break;
 					}
 					else
 					{
-						temp_place = temp_char;
-				
-						if (temp_place == 'T') // then (optional)
+						while (temp_addr < editor_total) // on to the next then or end, which skip the rest of their line
 						{
-							while (temp_addr < editor_total)
-							{
-								if (editor_break()) break;
-		
-								temp_char = (unsigned char)x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
-			
-								if (temp_char == 0x10) break;
-								else temp_addr++;
-							}
+							if (editor_break()) break;
+
+							temp_char = (unsigned char)x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
 	
-							break;
+							if (temp_char == 0x10) temp_addr += 3;
+							else if (temp_char == basic_token_then || temp_char == basic_token_end) break;
+							else if (temp_char >= basic_token_byte && temp_char <= basic_token_long) temp_addr += (unsigned int)(temp_char - basic_token_byte) + 2;
+							else temp_addr++;
 						}
-						else
-						{
-							while (temp_addr < editor_total)
-							{
-								if (editor_break()) break;
-	
-								temp_char = (unsigned char)x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
-		
-								if (temp_char == 0x10) temp_addr += 3;
-								else if (temp_char == 'E') break;
-								else temp_addr++;
-							}
 
-							break;
-						}
+						break;
 					}
 				}
 			}
 		}
-		else if (temp_char == 'E') // end
+		else if (temp_char == basic_token_end || temp_char == basic_token_then) // end
 		{
 			while (temp_addr < editor_total)
 			{
@@ -3545,33 +5082,61 @@ void basic_execute()
 				else temp_addr++;
 			}
 		}
-		else if (temp_char == 'G' && temp_second == 'O') // goto
+		else if (temp_char == basic_token_goto) // goto
 		{
-			while (temp_addr < editor_total)
+			if (basic_number(temp_addr, temp_num)) break;
+
+			if (temp_num < 0) temp_num *= -1;
+
+			temp_num = temp_num % 32768;
+
+			if (basic_index_total == -1) basic_indexbuild();
+
+			if (basic_index_total >= 0) // binary search
 			{
-				if (editor_break()) break;
-	
-				temp_char = (unsigned char)x6502_read((unsigned char)(temp_addr&0x00FF), (unsigned char)((temp_addr&0xFF00)>>8));
-		
-				if (temp_char == 'T')
+				temp_offset = -1;
+
+				for (int i=0; i<basic_jumps; i++)
 				{
-					temp_addr++;
-					break;
+					if ((unsigned int)basic_code[basic_jumped+i*4] * 256 + (unsigned int)basic_code[basic_jumped+i*4+1] == (unsigned int)temp_num && temp_num != 0) temp_offset = i;
 				}
-				else if (temp_char == 'A' || temp_char == 'B' || temp_char == 'C' || temp_char == 'D' ||
-					temp_char == 'W' || temp_char == 'X' || temp_char == 'Y' || temp_char == 'Z' ||
-					(temp_char >= 0x30 && temp_char <= 0x39))
+
+				if (temp_offset >= 0) // jumped here before
 				{
-					break;
+					temp_line = (unsigned int)temp_num;
+
+					temp_addr = (unsigned int)basic_code[basic_jumped+temp_offset*4+2] * 256 + (unsigned int)basic_code[basic_jumped+temp_offset*4+3];
+
+					continue;
 				}
-				else temp_addr++;
-			}
 
-			if (basic_number(temp_addr, temp_num)) break;
+				temp_offset = basic_indexfind((unsigned int)temp_num);
 
-			if (temp_num < 0) temp_num *= -1;
+				if (temp_offset < basic_index_total)
+				{
+					temp_line = basic_indexline(temp_offset);
 
-			temp_num = temp_num % 32768;
+					temp_addr = basic_indexaddr(temp_offset) + 2;
+
+					if (temp_line == (unsigned int)temp_num)
+					{
+						basic_code[basic_jumped+basic_jump_next*4] = (unsigned char)(temp_line/256);
+						basic_code[basic_jumped+basic_jump_next*4+1] = (unsigned char)(temp_line%256);
+						basic_code[basic_jumped+basic_jump_next*4+2] = (unsigned char)(temp_addr/256);
+						basic_code[basic_jumped+basic_jump_next*4+3] = (unsigned char)(temp_addr%256);
+
+						basic_jump_next = (basic_jump_next + 1) % basic_jumps;
+					}
+				}
+				else
+				{
+					temp_line = 0x0000;
+
+					temp_addr = editor_total; // past the last line
+				}
+
+				continue;
+			}
 
 			temp_addr = editor_start;
 
@@ -3585,7 +5150,7 @@ void basic_execute()
 
 			temp_addr += 2;
 
-			while (temp_line < temp_num && temp_addr < editor_total)
+			while ((int)temp_line < temp_num && temp_addr < editor_total)
 			{
 				if (editor_break()) break;
 
@@ -3607,13 +5172,20 @@ void basic_execute()
 				}
 			}
 		}
-		else if (temp_char == 'S' && temp_second == 'I') // sing
+		else if (temp_char == basic_token_sing) // sing
 		{
-			if (basic_number(temp_addr, temp_num)) break;
+			if (basic_song(temp_addr)) // music in quotes
+			{
+				if (basic_sing(temp_addr)) break;
+			}
+			else
+			{
+				if (basic_number(temp_addr, temp_num)) break;
 
-			if (temp_num < 0) temp_num *= -1;
+				if (temp_num < 0) temp_num *= -1;
 
-			audio_note(temp_num); // beeps and boops
+				audio_note(temp_num); // beeps and boops
+			}
 		}
 		else if (temp_char == 'A' || temp_char == 'B' || temp_char == 'C' || temp_char == 'D' ||
 			temp_char == 'W' || temp_char == 'X' || temp_char == 'Y' || temp_char == 'Z') // variables
@@ -3678,7 +5250,7 @@ void basic_execute()
 				}
 			}
 		}
-		else if (temp_char == 'M') // monitor
+		else if (temp_char == basic_token_mon) // monitor
 		{
 			while (temp_addr < editor_total)
 			{
@@ -3706,6 +5278,8 @@ void basic_execute()
 						{
 							monitor_execute(0, command_size);
 
+							basic_compiledclear(); // it may have written anywhere
+
 							if (temp_char == 0x10) temp_addr--;
 
 							break;
@@ -5708,13 +7282,18 @@ unsigned char editor_execute()
 		}
 		else if (command_string[i] == 'N' && temp_place == 0x00) // new
 		{
-			for (unsigned int j=editor_start; j<editor_total; j++)
-			{
-				x6502_write((unsigned char)(j&0x00FF), (unsigned char)((j&0xFF00)>>8), 0x00);
-			}
+			x6502_flush();
+
+			display_fill((unsigned char)(editor_start/256), (unsigned char)(editor_start%256), 0x00, editor_total-editor_start);
+
+			x6502_forget(editor_start, editor_total);
 
 			editor_total = editor_start + 256;
 
+			basic_index_total = 0;
+
+			basic_jumpclear();
+
 			return 0x01;
 		}
 		else if (command_string[i] == 'C' && temp_place == 0x00) // clear
@@ -5727,6 +7306,17 @@ unsigned char editor_execute()
 		}
 		else if (command_string[i] == 'D' && temp_place == 0x00) // dir
 		{
+			if (fat_quoted(i)) // of the card
+			{
+				if (!editor_dirfiles())
+				{
+					keyboard_print(0x0D);
+					keyboard_print('?');
+				}
+
+				return 0x01;
+			}
+
 			temp_place = 0x00;
 
 			temp_num[0] = 0x0000;
@@ -5763,26 +7353,30 @@ unsigned char editor_execute()
 
 			temp_num[2] = 0x0000;
 
-			for (int j=editor_start; j<editor_total; j++)
+			for (int j=(int)editor_start; j<(int)editor_total; j++)
 			{
 				if (editor_break()) break;
 
-				if (j != editor_start)
+				if (j != (int)editor_start)
 				{
 					temp_char = (unsigned char)x6502_read((unsigned char)(j&0x00FF), (unsigned char)((j&0xFF00)>>8));
 
-					if (!(temp_char == 0x10) && temp_num[2] >= temp_num[0] && temp_num[2] <= temp_num[1]) keyboard_print((char)temp_char);
+					if (temp_char >= 0x80) // keywords and numbers
+					{
+						j = (int)basic_list(temp_char, (unsigned int)(j+1), (temp_num[2] >= temp_num[0] && temp_num[2] <= temp_num[1])) - 1;
+					}
+					else if (!(temp_char == 0x10) && temp_num[2] >= temp_num[0] && temp_num[2] <= temp_num[1]) keyboard_print((char)temp_char);
 	
 					if (temp_char == '"' || temp_char == '\'') temp_quote = 0x01 - temp_quote;
 
 					if (temp_char == 0x10) temp_quote = 0x00;
 				}
 
-				if (temp_quote == 0x00 && (j == editor_start || temp_char == 0x10))
+				if (temp_quote == 0x00 && (j == (int)editor_start || temp_char == 0x10))
 				{
 					temp_place = 0x00;
 
-					for (int k=j+1; k<editor_total; k++)
+					for (int k=j+1; k<(int)editor_total; k++)
 					{
 						temp_char = (unsigned char)x6502_read((unsigned char)(k&0x00FF), (unsigned char)((k&0xFF00)>>8));
 
@@ -5796,9 +7390,9 @@ unsigned char editor_execute()
 
 					if (temp_place == 0x00) break;
 
-					if (j != editor_start) j++;
+					if (j != (int)editor_start) j++;
 
-					if (j >= editor_total) break;
+					if (j >= (int)editor_total) break;
 
 					temp_addr = (unsigned int)x6502_read((unsigned char)(j&0x00FF), (unsigned char)((j&0xFF00)>>8));
 					
@@ -5806,7 +7400,7 @@ unsigned char editor_execute()
 
 					j++;
 
-					if (j >= editor_total) break;
+					if (j >= (int)editor_total) break;
 	
 					temp_addr += (unsigned int)x6502_read((unsigned char)(j&0x00FF), (unsigned char)((j&0xFF00)>>8));
 
@@ -5861,7 +7455,7 @@ unsigned char editor_execute()
 		}
 		else if (command_string[i] == 'L') // load
 		{
-			if (!editor_load())
+			if (!(fat_quoted(i) ? editor_loadfile(i) : editor_load()))
 			{
 				keyboard_print(0x0D);
 				keyboard_print('?');
@@ -5871,7 +7465,7 @@ unsigned char editor_execute()
 		}
 		else if (command_string[i] == 'S') // save
 		{
-			if (!editor_save())
+			if (!(fat_quoted(i) ? editor_savefile(i) : editor_save()))
 			{
 				keyboard_print(0x0D);
 				keyboard_print('?');
@@ -5967,6 +7561,8 @@ unsigned char editor_execute()
 						{
 							break;
 						}
+
+						temp_addr++; // the low byte could look like a delimiter or quote
 					}
 					else temp_addr++;
 				}
@@ -5976,28 +7572,25 @@ unsigned char editor_execute()
 			{
 				temp_addr = temp_last[0] - temp_last[1];
 
-				for (unsigned int j=temp_last[1]; j<editor_total-temp_addr; j++)
-				{
-					if (editor_break()) break;
+				x6502_flush(); // the CPLD moves it all
 
-					x6502_write((unsigned char)((j)&0x00FF), (unsigned char)(((j)&0xFF00)>>8),
-						x6502_read((unsigned char)((j+temp_addr)&0x00FF), (unsigned char)(((j+temp_addr)&0xFF00)>>8)));
-				}
+				display_copy(temp_last[0], temp_last[1], editor_used()-temp_last[0]);
 
-				for (unsigned int j=editor_total-temp_addr; j<editor_total; j++)
-				{
-					if (editor_break()) break;
+				display_fill((unsigned char)((editor_used()-temp_addr)/256), (unsigned char)((editor_used()-temp_addr)%256), 0x00, temp_addr);
 
-					x6502_write((unsigned char)((j)&0x00FF), (unsigned char)(((j)&0xFF00)>>8), 0x00);
+				x6502_forget(temp_last[1], editor_total);
 
-					editor_total--;
+				editor_total -= temp_addr;
 	
-					if (editor_total < editor_start + 256) editor_total = editor_start + 256;
-				}
+				if (editor_total < editor_start + 256) editor_total = editor_start + 256;
+
+				basic_indexdelete(temp_num[0], temp_addr);
 
 				temp_last[0] = temp_last[1];
 			}
 
+			basic_crunch(i);
+
 			temp_addr = 0x0002;
 	
 			temp_place = 0x00;
@@ -6031,13 +7624,15 @@ unsigned char editor_execute()
 
 			temp_quote = 0x00;
 
-			for (unsigned int j=editor_total-temp_addr-1; j>=temp_last[0]; j--)
-			{
-				if (editor_break()) break;
-	
-				x6502_write((unsigned char)((j+temp_addr)&0x00FF), (unsigned char)(((j+temp_addr)&0xFF00)>>8),
-					x6502_read((unsigned char)((j)&0x00FF), (unsigned char)(((j)&0xFF00)>>8)));
-			}
+			x6502_flush(); // the CPLD moves it all
+
+			temp_num[1] = editor_used();
+
+			if (temp_num[1] > editor_total-temp_addr) temp_num[1] = editor_total-temp_addr; // the end falls off
+
+			if (temp_num[1] > temp_last[0]) display_copy(temp_last[0], temp_last[0]+temp_addr, temp_num[1]-temp_last[0]);
+
+			x6502_forget(temp_last[0], editor_total);
 	
 			x6502_write((unsigned char)((temp_last[0]+0x0000)&0x00FF), (unsigned char)(((temp_last[0]+0x0000)&0xFF00)>>8),
 				(unsigned char)(temp_num[0]/256));
@@ -6045,6 +7640,10 @@ unsigned char editor_execute()
 			x6502_write((unsigned char)((temp_last[0]+0x0001)&0x00FF), (unsigned char)(((temp_last[0]+0x0001)&0xFF00)>>8),
 				(unsigned char)(temp_num[0]%256));
 
+			editor_total += 2; // line number
+
+			if (editor_total > editor_end) editor_total = editor_end;
+
 			temp_place = (unsigned char)(i);
 			temp_char = 0x00;
 	
@@ -6086,6 +7685,9 @@ unsigned char editor_execute()
 				if (editor_total > editor_end) editor_total = editor_end;
 			}
 
+			if (editor_total >= editor_end) basic_index_total = -1; // the end was cut off
+			else basic_indexinsert(temp_num[0], temp_last[0], temp_addr);
+
 			break;
 		}
 	}
@@ -6118,6 +7720,7 @@ unsigned char editor_loop()
 		else if (key == 0x0D || key == 0x8D) // carriage return
 		{
 			editor_character = 0x00;
+			keyboard_stop = 0x00;
 
 			if (!editor_execute())
 			{
@@ -6169,11 +7772,11 @@ void setup()
 {
 	// put your setup code here, to run once:
 
-	Serial.begin(9600);
+	if (serial_output || serial_input) serial_begin(); // not with display_transport 2, which takes the USART
 
 	if (serial_output)
 	{
-		Serial.println("");
+		serial_newline();
 	}
 
 	for (int i=0; i<512; i++) shared_memory[i] = 0x00;
@@ -6181,6 +7784,7 @@ void setup()
 	display_initialize();
 	display_clearmemory();
 
+	x6502_invalidate();
 
 
 	// TEMPORARY BELOW!!!
@@ -6219,7 +7823,9 @@ void loop()
 		{
 			keyboard_print(loop_key); // scratchpad mode
 		}
-	}	
+	}
+
+	keyboard_flush();
 }
 
 
@@ -26,15 +26,47 @@ unsigned char screen_memory[960]; // used for 40x24 and 64x15 fast vertical scro
 const bool serial_debug = false; // change to stop error messages
 const bool serial_output = false; // change to stop serial output
 const bool serial_input = false; // change to stop serial input
-unsigned char serial_last = 0x00;
+volatile unsigned char serial_line = 0x00; // 0x01 while a line comes in, 0x02 just after a carriage return
+volatile unsigned char serial_time = 0x00; // low byte of millis() when the last byte came in
+const unsigned char serial_idle = 20; // milliseconds without a byte that end a line too, for no line ending
+const unsigned int serial_rate = 103; // UBRR0 for 9600 baud, 16 MHz / 16 / 9600 - 1
 
-int display_width = 40; // 40 or 64
-int display_height = 24; // 24 or 15
-int display_left = 12; // 12 or 0
-int display_top = 1; // 1 or 5
+// The USART registers are used directly instead of the Serial library,
+// whose two 64 byte buffers left too little SRAM for the stack.
+// Bytes received go straight into keyboard_buffer from USART_RX_vect,
+// bytes sent wait for the one before, as each is followed by delay(1) anyway.
+
+void serial_begin()
+{
+	UBRR0 = serial_rate;
+	UCSR0A = 0x00;
+	UCSR0C = (unsigned char)((1 << UCSZ01) | (1 << UCSZ00)); // 8 data bits, no parity, 1 stop bit
+	UCSR0B = (unsigned char)((serial_input ? ((1 << RXEN0) | (1 << RXCIE0)) : 0x00) | (serial_output ? (1 << TXEN0) : 0x00));
+};
+
+void serial_write(const unsigned char value)
+{
+	while ((UCSR0A & (1 << UDRE0)) == 0x00) { }
+
+	UDR0 = value;
+};
+
+void serial_newline()
+{
+	serial_write(0x0D);
+	serial_write(0x0A);
+};
+
+unsigned char display_width = 40; // 40 or 64
+unsigned char display_height = 24; // 24 or 15
+unsigned char display_left = 12; // 12 or 0
+unsigned char display_top = 1; // 1 or 5
 
 const bool display_check = false; // double checks reads and writes
 const int display_delay = 1; // microseconds
+const int display_transport = 1; // 0 = digitalWrite(), 1 = direct port registers, 2 = USART as SPI master
+const unsigned char display_settle = 16; // cycles at 16 MHz, CPLD needs 16 master clocks per access
+const unsigned char display_baud = 1; // USART clock is 16 MHz / (2 * (display_baud + 1)), so 4 MHz
 
 const int display_input_clock = 6;
 const int display_input_data = 7;
@@ -42,25 +74,127 @@ const int display_input_data = 7;
 const int display_output_clock = 4;
 const int display_output_data = 5;
 
+// Transport 2 uses the ATmega328's USART in master SPI mode.
+// XCK is already pin 4, but TXD is pin 1, so the CPLD serial_data line
+// must be jumpered from pin 5 to pin 1, and both serial_output and serial_input
+// must be false because the USART is no longer available to serial_begin().
+// The SPI block is not used here, pins 11 to 13 belong to the SD card.
+// Received bytes still come through pins 6 and 7 on the port registers.
+const int display_usart_data = 1;
+
 //const int display_ram_bank = 8; // not used anymore
 //int display_ram_bank_value = 0;
 
+// pins 4 through 7 are PD4 through PD7, so the port registers can be used directly,
+// single bit changes compile down to 'sbi' and 'cbi' and are safe from the keyboard interrupt
+
 void display_toggleinput()
 {
-	digitalWrite(display_input_clock, HIGH);
-	digitalWrite(display_input_clock, LOW);
+	if (display_transport >= 1)
+	{
+		PORTD |= (unsigned char)(1 << display_input_clock);
+		PORTD &= (unsigned char)~(1 << display_input_clock);
+	}
+	else
+	{
+		digitalWrite(display_input_clock, HIGH);
+		digitalWrite(display_input_clock, LOW);
+	}
+};
+
+void display_usartsend(const unsigned char value)
+{
+	while ((UCSR0A & (1 << UDRE0)) == 0x00) {}
+
+	UDR0 = value;
+
+	UCSR0A = (unsigned char)(1 << TXC0); // cleared by writing a one, after the buffer is full again
 };
 
 void display_toggleoutput()
 {
-	digitalWrite(display_output_clock, HIGH);
-	digitalWrite(display_output_clock, LOW);
+	if (display_transport == 2)
+	{
+		display_usartsend(0x00); // first clock clears the shift register, the other seven shift in zeros
+	}
+	else if (display_transport == 1)
+	{
+		PORTD |= (unsigned char)(1 << display_output_clock);
+		PORTD &= (unsigned char)~(1 << display_output_clock);
+	}
+	else
+	{
+		digitalWrite(display_output_clock, HIGH);
+		digitalWrite(display_output_clock, LOW);
+	}
+};
+
+void display_wait()
+{
+	if (display_transport == 2)
+	{
+		while ((UCSR0A & (1 << TXC0)) == 0x00) {} // last bit has left the USART
+
+		__builtin_avr_delay_cycles(display_settle);
+	}
+	else if (display_transport == 1)
+	{
+		__builtin_avr_delay_cycles(display_settle); // gives the CPLD time to do the access
+	}
+	else
+	{
+		delayMicroseconds(display_delay); // just in case
+	}
+};
+
+inline unsigned char display_portreceive(const unsigned char value, const unsigned char mask)
+{
+	unsigned char temp_value = value;
+
+	if (PIND & (unsigned char)(1 << display_input_data))
+	{
+		temp_value |= mask;
+	}
+
+	PORTD |= (unsigned char)(1 << display_input_clock);
+	PORTD &= (unsigned char)~(1 << display_input_clock);
+
+	return temp_value;
+};
+
+inline void display_portsend(const unsigned char value, const unsigned char mask)
+{
+	if (value & mask)
+	{
+		PORTD |= (unsigned char)(1 << display_output_data);
+	}
+	else
+	{
+		PORTD &= (unsigned char)~(1 << display_output_data);
+	}
+
+	PORTD |= (unsigned char)(1 << display_output_clock);
+	PORTD &= (unsigned char)~(1 << display_output_clock);
 };
 
 unsigned char display_receivebyte()
 {
 	unsigned char temp_value = 0x00;
 
+	if (display_transport >= 1) // unrolled
+	{
+		temp_value = display_portreceive(temp_value, 0x80);
+		temp_value = display_portreceive(temp_value, 0x40);
+		temp_value = display_portreceive(temp_value, 0x20);
+		temp_value = display_portreceive(temp_value, 0x10);
+		temp_value = display_portreceive(temp_value, 0x08);
+		temp_value = display_portreceive(temp_value, 0x04);
+		temp_value = display_portreceive(temp_value, 0x02);
+		temp_value = display_portreceive(temp_value, 0x01);
+
+		return temp_value;
+	}
+
 	for (int i=0; i<8; i++)
 	{
 		temp_value = temp_value << 1;
@@ -80,6 +214,26 @@ void display_sendbyte(const unsigned char value)
 {
 	unsigned char temp_value = value;
 
+	if (display_transport == 2)
+	{
+		display_usartsend(temp_value);
+
+		return;
+	}
+	else if (display_transport == 1) // unrolled
+	{
+		display_portsend(temp_value, 0x80);
+		display_portsend(temp_value, 0x40);
+		display_portsend(temp_value, 0x20);
+		display_portsend(temp_value, 0x10);
+		display_portsend(temp_value, 0x08);
+		display_portsend(temp_value, 0x04);
+		display_portsend(temp_value, 0x02);
+		display_portsend(temp_value, 0x01);
+
+		return;
+	}
+
 	for (int i=0; i<8; i++)
 	{
 		if (temp_value >= 0x80)
@@ -104,7 +258,7 @@ unsigned char display_receivepacket(const unsigned char high, const unsigned cha
 		display_sendbyte((unsigned char)((high&0x3F)+0x80));
 		display_sendbyte((unsigned char)(low));
 		display_sendbyte((unsigned char)(0x00));
-		delayMicroseconds(display_delay); // just in case
+		display_wait();
 		display_toggleoutput();
 
 		unsigned char temp_check[2];
@@ -118,7 +272,7 @@ unsigned char display_receivepacket(const unsigned char high, const unsigned cha
 			display_sendbyte((unsigned char)((high&0x3F)+0x80));
 			display_sendbyte((unsigned char)(low));
 			display_sendbyte((unsigned char)(0x00));
-			delayMicroseconds(display_delay); // just in case
+			display_wait();
 			display_toggleoutput();
 	
 			temp_check[1] = temp_check[0];
@@ -131,41 +285,41 @@ unsigned char display_receivepacket(const unsigned char high, const unsigned cha
 				{
 					unsigned char temp_binary;
 	
-					Serial.println("");
+					serial_newline();
 	
-					Serial.print('R');
-					Serial.print(' ');
+					serial_write('R');
+					serial_write(' ');
 					
 					temp_binary = temp_check[0];
 	
 					for (int i=0; i<8; i++)
 					{
-						if (temp_binary >= 0x80) Serial.print('1');
-						else Serial.print('0');
+						if (temp_binary >= 0x80) serial_write('1');
+						else serial_write('0');
 					
 						temp_binary = temp_binary << 1;
 		
-						if (i == 3) Serial.print(' ');
+						if (i == 3) serial_write(' ');
 					}
 					
-					Serial.println("");
+					serial_newline();
 	
-					Serial.print(' ');
-					Serial.print(' ');
+					serial_write(' ');
+					serial_write(' ');
 	
 					temp_binary = temp_check[1];
 	
 					for (int i=0; i<8; i++)
 					{
-						if (temp_binary >= 0x80) Serial.print('1');
-						else Serial.print('0');
+						if (temp_binary >= 0x80) serial_write('1');
+						else serial_write('0');
 					
 						temp_binary = temp_binary << 1;
 	
-						if (i == 3) Serial.print(' ');
+						if (i == 3) serial_write(' ');
 					}
 	
-					Serial.println("");
+					serial_newline();
 				}
 			}
 		} 
@@ -178,8 +332,8 @@ unsigned char display_receivepacket(const unsigned char high, const unsigned cha
 		display_sendbyte((unsigned char)((high&0x3F)+0x80));
 		display_sendbyte((unsigned char)(low));
 		display_sendbyte((unsigned char)(0x00));
-		delayMicroseconds(display_delay); // just in case
-		display_toggleoutput();	
+		display_wait();
+		display_toggleoutput();
 	
 		return display_receivebyte();
 	}
@@ -196,7 +350,7 @@ void display_sendpacket(const unsigned char high, const unsigned char low, const
 			display_sendbyte((unsigned char)((high&0x3F)+0xC0));
 			display_sendbyte((unsigned char)(low));
 			display_sendbyte((unsigned char)(value));
-			delayMicroseconds(display_delay); // just in case
+			display_wait();
 			display_toggleoutput();
 	
 			if ((unsigned char)(high&0x08) == 0x08)
@@ -204,7 +358,7 @@ void display_sendpacket(const unsigned char high, const unsigned char low, const
 				display_sendbyte((unsigned char)((high&0x3F)+0x80));
 				display_sendbyte((unsigned char)(low));
 				display_sendbyte((unsigned char)(value));
-				delayMicroseconds(display_delay); // just in case
+				display_wait();
 				display_toggleoutput();
 	
 				temp_check = display_receivebyte();
@@ -220,41 +374,41 @@ void display_sendpacket(const unsigned char high, const unsigned char low, const
 				{
 					unsigned char temp_binary;
 	
-					Serial.println("");
+					serial_newline();
 	
-					Serial.print('W');
-					Serial.print(' ');
+					serial_write('W');
+					serial_write(' ');
 					
 					temp_binary = temp_check;
 	
 					for (int i=0; i<8; i++)
 					{
-						if (temp_binary >= 0x80) Serial.print('1');
-						else Serial.print('0');
+						if (temp_binary >= 0x80) serial_write('1');
+						else serial_write('0');
 					
 						temp_binary = temp_binary << 1;
 		
-						if (i == 3) Serial.print(' ');
+						if (i == 3) serial_write(' ');
 					}
 					
-					Serial.println("");
+					serial_newline();
 	
-					Serial.print(' ');
-					Serial.print(' ');
+					serial_write(' ');
+					serial_write(' ');
 	
 					temp_binary = value;
 	
 					for (int i=0; i<8; i++)
 					{
-						if (temp_binary >= 0x80) Serial.print('1');
-						else Serial.print('0');
+						if (temp_binary >= 0x80) serial_write('1');
+						else serial_write('0');
 					
 						temp_binary = temp_binary << 1;
 	
-						if (i == 3) Serial.print(' ');
+						if (i == 3) serial_write(' ');
 					}
 	
-					Serial.println("");
+					serial_newline();
 				}
 			}
 		}
@@ -265,11 +419,74 @@ void display_sendpacket(const unsigned char high, const unsigned char low, const
 		display_sendbyte((unsigned char)((high&0x3F)+0xC0));
 		display_sendbyte((unsigned char)(low));
 		display_sendbyte((unsigned char)(value));
-		delayMicroseconds(display_delay); // just in case
+		display_wait();
 		display_toggleoutput();
 	}
 };
 
+void display_sendblock(const unsigned char high, const unsigned char low, const unsigned char *buf, const unsigned int len) // consecutive addresses, one packet each
+{
+	unsigned int temp_addr = (unsigned int)((high&0x3F)*256+low);
+
+	for (unsigned int i=0; i<len; i++)
+	{
+		display_sendpacket((unsigned char)((temp_addr&0x3F00)>>8), (unsigned char)(temp_addr&0x00FF), buf[i]);
+
+		temp_addr++;
+	}
+};
+
+void display_receiveblock(const unsigned char high, const unsigned char low, unsigned char *buf, const unsigned int len) // consecutive addresses, one packet each
+{
+	unsigned int temp_addr = (unsigned int)((high&0x3F)*256+low);
+
+	for (unsigned int i=0; i<len; i++)
+	{
+		buf[i] = display_receivepacket((unsigned char)((temp_addr&0x3F00)>>8), (unsigned char)(temp_addr&0x00FF));
+
+		temp_addr++;
+	}
+};
+
+void display_fill(const unsigned char high, const unsigned char low, const unsigned char value, const unsigned int len) // consecutive addresses, one packet each
+{
+	unsigned int temp_addr = (unsigned int)((high&0x3F)*256+low);
+
+	for (unsigned int i=0; i<len; i++)
+	{
+		display_sendpacket((unsigned char)((temp_addr&0x3F00)>>8), (unsigned char)(temp_addr&0x00FF), value);
+
+		temp_addr++;
+	}
+};
+
+void display_copy(const unsigned int from, const unsigned int to, const unsigned int len) // overlapping is fine, through a small buffer
+{
+	unsigned char temp_buffer[32];
+	unsigned int temp_size;
+	unsigned int temp_done = 0;
+
+	while (temp_done < len)
+	{
+		temp_size = len - temp_done;
+
+		if (temp_size > 32) temp_size = 32;
+
+		if (to > from) // moving up, so from the end down
+		{
+			display_receiveblock((unsigned char)(((from+len-temp_done-temp_size)&0x3F00)>>8), (unsigned char)((from+len-temp_done-temp_size)&0x00FF), temp_buffer, temp_size);
+			display_sendblock((unsigned char)(((to+len-temp_done-temp_size)&0x3F00)>>8), (unsigned char)((to+len-temp_done-temp_size)&0x00FF), temp_buffer, temp_size);
+		}
+		else
+		{
+			display_receiveblock((unsigned char)(((from+temp_done)&0x3F00)>>8), (unsigned char)((from+temp_done)&0x00FF), temp_buffer, temp_size);
+			display_sendblock((unsigned char)(((to+temp_done)&0x3F00)>>8), (unsigned char)((to+temp_done)&0x00FF), temp_buffer, temp_size);
+		}
+
+		temp_done += temp_size;
+	}
+};
+
 unsigned char display_receivecharacter(const unsigned char row, const unsigned char column)
 {
 	unsigned char low = (unsigned char)((unsigned char)(column & 0x3F) + (unsigned char)((row & 0x03) << 6));
@@ -299,18 +516,30 @@ void display_initialize()
 
 	digitalWrite(display_input_clock, LOW);
 
+	if (display_transport == 2)
+	{
+		pinMode(display_output_data, INPUT); // jumpered to pin 1 instead
+
+		UBRR0 = 0x0000; // must be zero while enabling
+		UCSR0C = (unsigned char)((1 << UMSEL01) | (1 << UMSEL00)); // master SPI, MSB first, sample on rising edge
+		UCSR0B = (unsigned char)(1 << TXEN0); // transmit only
+		UBRR0 = (unsigned int)display_baud;
+	}
+
 	for (int i=0; i<32; i++)
 	{
 		display_toggleoutput(); // clears shift register
 	}
+
+	if (display_transport == 2)
+	{
+		display_wait();
+	}
 };
 
 void display_clearmemory()
 {	
-	for (int i=0; i<16384; i++)
-	{
-		display_sendpacket((unsigned char)(i/256), (unsigned char)(i%256), 0x00);
-	}
+	display_fill(0x00, 0x00, 0x00, 16384);
 };
 
 
@@ -336,7 +565,7 @@ void string_print(int Y, int X, const char *A)
 
 			if (serial_output)
 			{
-				Serial.print((char)A[i]);
+				serial_write((unsigned char)A[i]);
 				delay(1);
 			}
 		}
@@ -344,7 +573,7 @@ void string_print(int Y, int X, const char *A)
 
 	if (serial_output)
 	{
-		Serial.println("");
+		serial_newline();
 		delay(1);
 	}
 };
@@ -353,16 +582,22 @@ void string_print(int Y, int X, const char *A)
 const int keyboard_clock = 2;
 const int keyboard_data = 3;
 
-volatile unsigned char keyboard_bit = 0x00;
+const unsigned char keyboard_size = 32; // characters waiting, a power of two
+const unsigned int keyboard_timeout = 2000; // microseconds between clocks before a frame starts over
+
 volatile unsigned char keyboard_byte = 0x00;
-volatile unsigned char keyboard_counter = 0x00;
-volatile unsigned char keyboard_buffer[16];
-volatile unsigned char keyboard_read_pos = 0x00;
-volatile unsigned char keyboard_write_pos = 0x00;
-unsigned char keyboard_extended = 0x00;
-unsigned char keyboard_release = 0x00;
-unsigned char keyboard_shift = 0x00;
-unsigned char keyboard_capslock = 0x00;
+volatile unsigned char keyboard_counter = 0x00; // bit of the frame expected next, the start bit is zero, the stop bit 0x0A or 0x0B after a wrong parity
+volatile unsigned int keyboard_time = 0x0000; // low half of micros() at the last clock
+volatile unsigned char keyboard_buffer[keyboard_size];
+volatile unsigned char keyboard_read_pos = 0x00; // only changed by keyboard_character()
+volatile unsigned char keyboard_write_pos = 0x00; // only changed by keyboard_push()
+volatile unsigned char keyboard_overflow = 0x00; // characters dropped while the buffer was full, beeped and cleared by keyboard_character()
+volatile unsigned char keyboard_stop = 0x00; // 0x01 once a break key comes in, until the next command clears it
+unsigned char keyboard_state = 0x00; // these bits only change in keyboard_decode()
+const unsigned char keyboard_extended = 0x01;
+const unsigned char keyboard_release = 0x02;
+const unsigned char keyboard_shift = 0x04;
+const unsigned char keyboard_capslock = 0x08;
 unsigned char keyboard_mode = 0x00;
 unsigned char keyboard_serial = 0x00;
 
@@ -370,6 +605,13 @@ unsigned char keyboard_pos_x = 0x00;
 unsigned char keyboard_pos_y = 0x00;
 unsigned char keyboard_invert = 0x80; // 0x00 or 0x80
 
+unsigned char keyboard_dirty_y = 0xFF; // row of the text area printed to but not sent yet, 0xFF when none
+unsigned char keyboard_dirty_first = 0x00; // columns from here
+unsigned char keyboard_dirty_last = 0x00; // to here
+unsigned char keyboard_cursor = 0x00; // 0x01 when the cursor is not drawn yet
+unsigned char keyboard_pending = 0x00; // low byte of millis() when something first waited
+const unsigned char keyboard_latency = 20; // milliseconds before keyboard_character() sends it anyway
+
 const unsigned char keyboard_text[128] PROGMEM = 
 "\\ for the Rogue-like game. Controls:\nArrowkeys or Numpad to move, Wait,\nDrink, Read, Shoot, Enter for stairs _";
 
@@ -409,54 +651,152 @@ const unsigned char keyboard_conversion[256] PROGMEM = {
 	 0x19,0x2B,0x04,0x2D,0x2A,0x01,0x00,0x00
 };
 
-void keyboard_interrupt()
+unsigned char keyboard_under() // character under the cursor, the menu below the text area is not kept
 {
-	keyboard_bit = digitalRead(keyboard_data);
-	
-	keyboard_byte = keyboard_byte >> 1;
+	if (keyboard_pos_y >= display_top && keyboard_pos_y < display_top+display_height)
+	{
+		return screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left];
+	}
+
+	return 0x00;
+};
+
+void keyboard_push(unsigned char value) // from keyboard_interrupt(), or with interrupts off
+{
+	unsigned char temp_next = (unsigned char)((keyboard_write_pos + 1) & (keyboard_size - 1));
 
-	if (keyboard_bit == HIGH) keyboard_byte += 0x80;
+	if (value == '\\' || value == '|' || value == 0x1B) keyboard_stop = 0x01; // seen at once, even behind other keys
+
+	if (temp_next != keyboard_read_pos)
+	{
+		keyboard_buffer[keyboard_write_pos] = value;
+		keyboard_write_pos = temp_next;
+	}
+	else if (keyboard_overflow < 0xFF) keyboard_overflow++;
+};
 
-	keyboard_counter++;
+void keyboard_decode(unsigned char code) // from keyboard_interrupt(), so only whole characters go into the buffer
+{
+	unsigned char temp_second = 0x00;
 
-	if (keyboard_counter == 0x09)
+	if (code == 0xF0) // release
 	{
-		keyboard_buffer[keyboard_write_pos] = keyboard_byte;
-		keyboard_write_pos++;
-		if (keyboard_write_pos >= 0x10) keyboard_write_pos = 0x00;
+		keyboard_state |= keyboard_release;
 	}
-	else if (keyboard_counter == 0x0B)
+	else if (code == 0xE0) // extended
 	{
-		keyboard_counter = 0x00;
+		keyboard_state |= keyboard_extended;
+	}
+	else
+	{
+		if (keyboard_state & keyboard_release)
+		{
+			if (code == 0x12 || code == 0x59) keyboard_state &= (unsigned char)(~keyboard_shift);
+		}
+		else
+		{
+			if (code == 0x58) keyboard_state ^= keyboard_capslock;
+			else if (code == 0x12 || code == 0x59) keyboard_state |= keyboard_shift;
+
+			if (keyboard_state & keyboard_capslock) code += 0x80;
+
+			if (keyboard_state & keyboard_shift) code += 0x80;
+
+			if (keyboard_state & keyboard_extended)
+			{
+				if (code == 0x4A || code == 0xCA) code += 0x80; // numpad slash
+				
+				temp_second = (unsigned char)pgm_read_byte_near(keyboard_conversion + (unsigned char)(code+0x80));
+			}
+			else
+			{
+				temp_second = (unsigned char)pgm_read_byte_near(keyboard_conversion + (unsigned char)(code+0x00));
+			}
+		}
+
+		keyboard_state &= (unsigned char)(~(keyboard_release | keyboard_extended));
+	}
+
+	if (temp_second == 0x00) return; // releases, prefixes, and keys that type nothing
+
+	keyboard_push(temp_second);
+};
+
+void keyboard_interrupt() // falling edge of the clock, one bit each time and never waits
+{
+	unsigned char temp_bit = (digitalRead(keyboard_data) == HIGH ? 0x01 : 0x00);
+	unsigned char temp_ones = 0x00;
+	unsigned int temp_time = (unsigned int)micros();
+
+	if ((unsigned int)(temp_time - keyboard_time) > keyboard_timeout) keyboard_counter = 0x00; // a clock was missed, start over
+
+	keyboard_time = temp_time;
+
+	if (keyboard_counter == 0x00) // start
+	{
+		if (temp_bit == 0x00)
+		{
+			keyboard_byte = 0x00;
+			keyboard_counter++;
+		}
+	}
+	else if (keyboard_counter <= 0x08) // data
+	{
+		keyboard_byte = keyboard_byte >> 1;
+
+		if (temp_bit == 0x01) keyboard_byte += 0x80;
+
+		keyboard_counter++;
 	}
+	else if (keyboard_counter == 0x09) // parity, odd
+	{
+		temp_ones = temp_bit;
+
+		for (int i=0; i<8; i++) temp_ones += (unsigned char)((keyboard_byte >> i) & 0x01);
 
-	while (digitalRead(keyboard_clock) == LOW) {}
+		keyboard_counter = (unsigned char)(0x0B - (temp_ones & 0x01));
+	}
+	else // stop
+	{
+		if (temp_bit == 0x01 && keyboard_counter == 0x0A) keyboard_decode(keyboard_byte);
+
+		keyboard_counter = 0x00;
+	}
 
 	return;
 };
 
+ISR(INT0_vect) // keyboard_clock is pin 2, set up here rather than with attachInterrupt() and its table of handlers in SRAM
+{
+	keyboard_interrupt();
+};
+
 void keyboard_initialize()
 {
 	pinMode(keyboard_clock, INPUT_PULLUP);
 	pinMode(keyboard_data, INPUT_PULLUP);
 
-	attachInterrupt(digitalPinToInterrupt(keyboard_clock), keyboard_interrupt, LOW);
+	EICRA = (unsigned char)((EICRA & ~((1 << ISC01) | (1 << ISC00))) | (1 << ISC01)); // falling edge
+	EIMSK |= (unsigned char)(1 << INT0);
 
 	interrupts(); // just in case
 };
 
 void keyboard_clearscreen()
 {
+	unsigned char temp_row[64];
+
 	keyboard_pos_x = 0x00;
 	keyboard_pos_y = 0x00;
 
-	for (int i=0; i<2048; i++)
-	{
-		display_sendpacket(keyboard_pos_y, keyboard_pos_x, 0x00);
+	keyboard_dirty_y = 0xFF; // nothing left to send
+	keyboard_cursor = 0x00;
 
-		keyboard_pos_x++;
+	for (int i=0; i<64; i++) temp_row[i] = 0x00;
 
-		if (keyboard_pos_x == 0x00) keyboard_pos_y++;
+	for (int i=0; i<2048; i+=64)
+	{
+		display_sendblock((unsigned char)(i/256), (unsigned char)(i%256), temp_row, 64);
 	}
 	
 	for (int i=0; i<display_height; i++)
@@ -467,12 +807,11 @@ void keyboard_clearscreen()
 		}
 	}
 
+	for (int i=0; i<64; i++) temp_row[i] = keyboard_invert;
+
 	for (int i=display_top; i<display_height+display_top+4; i++)
 	{
-		for (int j=display_left; j<display_width+display_left; j++)
-		{
-			display_sendcharacter(i, j, keyboard_invert);
-		}
+		display_sendblock((unsigned char)((i & 0xFC) >> 2), (unsigned char)(display_left + ((i & 0x03) << 6)), temp_row, display_width);
 	}
 
 	keyboard_pos_x = (unsigned char)display_left;
@@ -512,7 +851,7 @@ void keyboard_menu()
 
 			if (serial_output)
 			{
-				Serial.println("");
+				serial_newline();
 			}
 		}
 		else
@@ -525,7 +864,7 @@ void keyboard_menu()
 
 	if (serial_output)
 	{
-		Serial.println("");
+		serial_newline();
 	}
 
 	keyboard_mode = temp_mode;
@@ -534,140 +873,200 @@ void keyboard_menu()
 
 	keyboard_pos_x = (unsigned char)display_left;
 	keyboard_pos_y = (unsigned char)display_top;
-	display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+0x80+keyboard_invert)); // cursor
+	display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(keyboard_under()+0x80+keyboard_invert)); // cursor
 };
 
-void keyboard_verticalscroll()
+void keyboard_flushrow() // sends the cells printed on one row together
 {
-	for (int i=0; i<display_height; i++)
+	unsigned char temp_row[64];
+
+	if (keyboard_dirty_y == 0xFF) return;
+
+	for (int j=keyboard_dirty_first; j<=keyboard_dirty_last; j++)
 	{
-		for (int j=0; j<display_width; j++)
-		{
-			screen_memory[i*display_width+j] = screen_memory[(i+1)*display_width+j];
-		}
+		temp_row[j-keyboard_dirty_first] = (unsigned char)(screen_memory[keyboard_dirty_y*display_width+j]+keyboard_invert);
 	}
-		
-	for (int j=0; j<display_width; j++)
+
+	display_sendblock((unsigned char)(((keyboard_dirty_y+display_top) & 0xFC) >> 2), 
+		(unsigned char)(display_left + keyboard_dirty_first + (((keyboard_dirty_y+display_top) & 0x03) << 6)), 
+		temp_row, (unsigned int)(keyboard_dirty_last-keyboard_dirty_first+1));
+
+	keyboard_dirty_y = 0xFF;
+};
+
+void keyboard_flush() // whatever keyboard_print() has not sent yet, then the cursor
+{
+	keyboard_flushrow();
+
+	if (keyboard_cursor != 0x00)
 	{
-		screen_memory[(display_height-1)*display_width+j] = 0x00;
+		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(keyboard_under()+keyboard_invert+0x80));
+
+		keyboard_cursor = 0x00;
 	}
+};
 
-	for (int i=0; i<display_height; i++)
+void keyboard_mark() // the cell under the cursor is sent later, with the rest of its row
+{
+	unsigned char temp_y = (unsigned char)(keyboard_pos_y-display_top);
+	unsigned char temp_x = (unsigned char)(keyboard_pos_x-display_left);
+
+	if (keyboard_pos_y < display_top || keyboard_pos_y >= display_top+display_height) // the menu below the text area is not kept
 	{
-		for (int j=0; j<display_width; j++)
-		{
-			display_sendcharacter(i+display_top, j+display_left, screen_memory[i*display_width+j]+keyboard_invert);
-		}
+		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(keyboard_invert));
+
+		return;
 	}
 
-	return;
+	if (keyboard_dirty_y != 0xFF && keyboard_dirty_y != temp_y) keyboard_flushrow();
+
+	if (keyboard_dirty_y == 0xFF)
+	{
+		keyboard_dirty_y = temp_y;
+		keyboard_dirty_first = temp_x;
+		keyboard_dirty_last = temp_x;
+	}
+	else if (temp_x < keyboard_dirty_first) keyboard_dirty_first = temp_x;
+	else if (temp_x > keyboard_dirty_last) keyboard_dirty_last = temp_x;
 };
 
-unsigned char keyboard_character()
+void keyboard_verticalscroll() // only sends the part of each row that changes, the screen already shows the rest
 {
-	unsigned char temp_value = 0x00;
-	unsigned char temp_second = 0x00;
+	unsigned char temp_row[64];
+	int temp_first;
+	int temp_last;
+
+	keyboard_flushrow();
 
-	if (keyboard_read_pos != keyboard_write_pos)
+	for (int i=0; i<display_height; i++)
 	{
-		temp_value = keyboard_buffer[keyboard_read_pos];
+		temp_first = display_width;
+		temp_last = -1;
 
-		if (temp_value == 0xF0) // release
+		for (int j=0; j<display_width; j++)
 		{
-			keyboard_release = 0xF0;
+			if (i < display_height-1) temp_row[j] = screen_memory[(i+1)*display_width+j];
+			else temp_row[j] = 0x00;
+
+			if (temp_row[j] != screen_memory[i*display_width+j])
+			{
+				if (temp_first > j) temp_first = j;
+
+				temp_last = j;
+			}
+
+			screen_memory[i*display_width+j] = temp_row[j];
+
+			temp_row[j] = (unsigned char)(temp_row[j]+keyboard_invert);
 		}
-		else if (temp_value == 0xE0) // extended
+
+		if (temp_last >= temp_first)
 		{
-			keyboard_extended = 0xE0;
+			display_sendblock((unsigned char)(((i+display_top) & 0xFC) >> 2), (unsigned char)(display_left + temp_first + (((i+display_top) & 0x03) << 6)), 
+				&temp_row[temp_first], (unsigned int)(temp_last-temp_first+1));
 		}
-		else
-		{
-			if (keyboard_release > 0x00)
-			{
-				if (temp_value == 0x12 || temp_value == 0x59) keyboard_shift = 0x00;
-			}
-			else
-			{
-				if (temp_value == 0x58) keyboard_capslock += 0x80;
-				else if (temp_value == 0x12 || temp_value == 0x59) keyboard_shift = 0xFF;
+	}
 
-				if (keyboard_capslock != 0x00) temp_value += 0x80;
+	return;
+};
 
-				if (keyboard_shift == 0xFF) temp_value += 0x80;
+void keyboard_late() // when something waits to be sent
+{
+	if ((unsigned char)((unsigned char)millis()-keyboard_pending) >= keyboard_latency)
+	{
+		keyboard_flush(); // printing stopped for a while, or it has waited long enough
+	}
+};
 
-				if (keyboard_extended > 0x00)
-				{
-					if (temp_value == 0x4A || temp_value == 0xCA) temp_value += 0x80; // numpad slash
-					
-					temp_second = (unsigned char)pgm_read_byte_near(keyboard_conversion + (unsigned char)(temp_value+0x80));
-				}
-				else
-				{
-					temp_second = (unsigned char)pgm_read_byte_near(keyboard_conversion + (unsigned char)(temp_value+0x00));
-				}
-			}
+unsigned char keyboard_room() // free places in the buffer
+{
+	return (unsigned char)((keyboard_read_pos - keyboard_write_pos - 1) & (keyboard_size - 1));
+};
 
-			keyboard_release = 0x00;
-			keyboard_extended = 0x00;
-		}
+ISR(USART_RX_vect) // serial input into the same buffer, each byte after the special serial key 0x10
+{
+	unsigned char temp_value;
 
-		keyboard_read_pos++;
-		if (keyboard_read_pos >= 0x10) keyboard_read_pos = 0x00;
+	if (keyboard_room() < 2) // the rest waits in the USART until keyboard_receive() finds room
+	{
+		UCSR0B &= (unsigned char)~(1 << RXCIE0);
 
-		return temp_second;
+		return;
 	}
-	else
+
+	temp_value = UDR0;
+
+	serial_time = (unsigned char)millis();
+
+	if (temp_value == 0x0A && serial_line == 0x02) // after a carriage return
+	{
+		serial_line = 0x00;
+
+		return;
+	}
+
+	keyboard_push(0x10);
+
+	if (temp_value == 0x0D || temp_value == 0x0A) keyboard_push(0x0D);
+	else keyboard_push(temp_value);
+
+	if (temp_value == 0x0D) serial_line = 0x02;
+	else if (temp_value == 0x0A) serial_line = 0x00;
+	else serial_line = 0x01;
+};
+
+void keyboard_receive() // the end of a serial line that has no line ending, and serial input again once there is room
+{
+	noInterrupts();
+
+	if (keyboard_room() >= 2) UCSR0B |= (unsigned char)(1 << RXCIE0);
+
+	if (serial_line != 0x00 && (UCSR0A & (1 << RXC0)) == 0x00 && (unsigned char)((unsigned char)millis()-serial_time) >= serial_idle && keyboard_room() >= 2) // nothing waiting in the USART
 	{
-		if (serial_input)
+		if (serial_line == 0x01) // no line ending, so the pause is the return
 		{
-			if (Serial.available() > 0)
-			{
-				if (serial_last == 0x10) // special serial key
-				{
-					serial_last = Serial.read();
-				}
-				else
-				{
-					serial_last = 0x10;
-				}
+			keyboard_push(0x10);
+			keyboard_push(0x0D);
+		}
 
-				delay(1);
+		serial_line = 0x00;
+	}
 
-				return (unsigned char)serial_last;					
-			}
-			else
-			{
-				if (serial_last == 0x10)
-				{
-					serial_last = 0x0D;
-				}
-				else if (serial_last == 0x0D)
-				{
-					serial_last = 0x00;
-				}
-				else if (serial_last != 0x00)
-				{
-					serial_last = 0x10;
-				}
+	interrupts();
+};
+
+unsigned char keyboard_character()
+{
+	unsigned char temp_value = 0x00;
 
-				delay(1);
+	if (keyboard_dirty_y != 0xFF || keyboard_cursor != 0x00) keyboard_late();
 
-				return serial_last;
-			}
-		}
-	
-		return 0x00;
+	if (serial_input) keyboard_receive();
+
+	if (keyboard_overflow != 0x00) // keys were lost while the buffer was full
+	{
+		keyboard_overflow = 0x00;
+
+		audio_note(500); // higher than the menu beep
+	}
+
+	if (keyboard_read_pos != keyboard_write_pos) // already decoded
+	{
+		temp_value = keyboard_buffer[keyboard_read_pos];
+
+		keyboard_read_pos = (unsigned char)((keyboard_read_pos + 1) & (keyboard_size - 1));
 	}
+
+	return temp_value;
 };
 
 void keyboard_print(unsigned char value)
 {
-	unsigned char temp_value = 0x00;
-	unsigned char temp_x = 0x00;
-	unsigned char temp_y = 0x00;
-
 	if (value == 0x00) return;
-	else if (value == 0x10) // special serial key
+
+	if (keyboard_dirty_y == 0xFF && keyboard_cursor == 0x00) keyboard_pending = (unsigned char)millis(); // nothing was waiting
+
+	if (value == 0x10) // special serial key
 	{
 		keyboard_serial = 0x01;
 	}
@@ -713,7 +1112,7 @@ void keyboard_print(unsigned char value)
 	}
 	else if (value == 0x0D || value == 0x8D) // carriage return
 	{
-		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x00));
+		keyboard_mark();
 
 		keyboard_pos_x = (unsigned char)display_left;
 		if (keyboard_pos_y < (unsigned char)(display_height+display_top)-1) keyboard_pos_y++;
@@ -724,13 +1123,13 @@ void keyboard_print(unsigned char value)
 			keyboard_pos_y = (unsigned char)(display_height+display_top)-1;
 		}
 
-		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+		keyboard_cursor = 0x01;
 
 		if (serial_output)
 		{
 			if (keyboard_serial == 0x00)
 			{
-				Serial.println("");
+				serial_newline();
 				delay(1);
 			}
 		}
@@ -739,44 +1138,44 @@ void keyboard_print(unsigned char value)
 	{
 		if (keyboard_mode == 0x00)
 		{
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x00));
+			keyboard_mark();
 	
 			if (keyboard_pos_y > (unsigned char)display_top) keyboard_pos_y--;
 	
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+			keyboard_cursor = 0x01;
 		}
 	}
 	else if (value == 0x12 || value == 0x92) // down arrow
 	{
 		if (keyboard_mode == 0x00)
 		{
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x00));
+			keyboard_mark();
 	
 			if (keyboard_pos_y < (unsigned char)(display_height+display_top)-1) keyboard_pos_y++;
 	
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+			keyboard_cursor = 0x01;
 		}
 	}
 	else if (value == 0x08 || value == 0x13 || value == 0x88 || value == 0x93) // backspace or left arrow
 	{
 		if (keyboard_mode == 0x00 || value == 0x08 || value == 0x88)
 		{
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x00));
+			keyboard_mark();
 
 			if (keyboard_pos_x > (unsigned char)display_left) keyboard_pos_x--;
 
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+			keyboard_cursor = 0x01;
 		}
 	}
 	else if (value == 0x09 || value == 0x14 || value == 0x89 || value == 0x94) // tab or right arrow
 	{
 		if (keyboard_mode == 0x00 || value == 0x09 || value == 0x89)
 		{
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x00));
+			keyboard_mark();
 
 			if (keyboard_pos_x < (unsigned char)(display_width+display_left-1)) keyboard_pos_x++;
 
-			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+			keyboard_cursor = 0x01;
 		}
 	}
 	else if (value == 0x1B || value == 0x9B) // escape
@@ -791,7 +1190,7 @@ void keyboard_print(unsigned char value)
 			{
 				if (keyboard_serial == 0x00)
 				{
-					Serial.println("");
+					serial_newline();
 					delay(1);
 				}
 			}
@@ -804,8 +1203,16 @@ void keyboard_print(unsigned char value)
 			if (value > 0x60 && value <= 0x7A) value = (unsigned char)(value - 0x20); // upper case only
 		}
 
-		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(value+keyboard_invert));
-		screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left] = (unsigned char)value;
+		if (keyboard_pos_y >= display_top && keyboard_pos_y < display_top+display_height) // the menu is printed below the text area
+		{
+			screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left] = (unsigned char)value;
+
+			keyboard_mark(); // sent with the rest of the row
+		}
+		else
+		{
+			display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(value+keyboard_invert));
+		}
 
 		if (keyboard_pos_x < (unsigned char)display_width+display_left-1) keyboard_pos_x++;
 		else
@@ -819,13 +1226,13 @@ void keyboard_print(unsigned char value)
 			}
 		}
 
-		display_sendcharacter(keyboard_pos_y, keyboard_pos_x, (unsigned char)(screen_memory[(keyboard_pos_y-display_top)*display_width+keyboard_pos_x-display_left]+keyboard_invert+0x80));
+		keyboard_cursor = 0x01;
 
 		if (serial_output)
 		{
 			if (keyboard_serial == 0x00)
 			{
-				Serial.print((char)value);
+				serial_write((unsigned char)value);
 				delay(1);
 			}
 		}
@@ -843,6 +1250,13 @@ const int sdcard_mosi = 11;
 const int sdcard_miso = 12;
 const int sdcard_sclk = 13;
 
+const int sdcard_transport = 1; // 0 = digitalWrite(), 1 = SPI peripheral on the same pins
+const unsigned int sdcard_busy = 500; // milliseconds a card may take to finish a write
+const unsigned int sdcard_readtime = 100; // milliseconds a card may take to answer a command, or to start a block it reads
+
+unsigned char sdcard_ready = 0x00; // 0x01 after sdcard_initialize(), cleared when a transfer fails
+unsigned char sdcard_sdhc = 0x00; // 0x01 for SDHC and SDXC, which take block numbers instead of byte addresses
+
 void sdcard_enable()
 {
 	digitalWrite(sdcard_ss, LOW);
@@ -864,10 +1278,26 @@ void sdcard_longdelay()
 	delay(10);
 };
 
+unsigned char sdcard_transfer(unsigned char value) // one byte each way through the SPI peripheral
+{
+	SPDR = value;
+
+	while ((SPSR & (1 << SPIF)) == 0x00) {}
+
+	return SPDR;
+};
+
 void sdcard_sendbyte(unsigned char value)
 {
 	unsigned char temp_value = value;
 
+	if (sdcard_transport == 1)
+	{
+		sdcard_transfer(value);
+
+		return;
+	}
+
 	for (int i=0; i<8; i++)
 	{
 		if (temp_value >= 0x80)
@@ -889,6 +1319,11 @@ unsigned char sdcard_receivebyte()
 {
 	unsigned char temp_value = 0x00;
 
+	if (sdcard_transport == 1)
+	{
+		return sdcard_transfer(0xFF);
+	}
+
 	for (int i=0; i<8; i++)
 	{
 		temp_value = temp_value << 1;
@@ -904,11 +1339,12 @@ unsigned char sdcard_receivebyte()
 	return temp_value;
 };
 
-unsigned char sdcard_waitresult()
+unsigned char sdcard_waitresult(const unsigned int timeout) // the first byte that is not 0xFF, or 0xFF after 'timeout' milliseconds
 {
 	unsigned char temp_value = 0xFF;
+	unsigned long temp_start = millis();
 
-	for (int i=0; i<2048; i++) // arbitrary wait time
+	while (true)
 	{
 		temp_value = sdcard_receivebyte();
 
@@ -916,9 +1352,21 @@ unsigned char sdcard_waitresult()
 		{
 			return temp_value;
 		}
+
+		if (millis() - temp_start > timeout) return 0xFF;
+	}
+};
+
+int sdcard_waitready() // the card holds its output low while busy
+{
+	unsigned long temp_start = millis();
+
+	while (sdcard_receivebyte() != 0xFF)
+	{
+		if (millis() - temp_start > sdcard_busy) return 0;
 	}
 
-	return 0xFF;
+	return 1;
 };
 
 void sdcard_pump()
@@ -928,6 +1376,16 @@ void sdcard_pump()
 
 	sdcard_longdelay();
 
+	if (sdcard_transport == 1)
+	{
+		for (int i=0; i<10; i++)
+		{
+			sdcard_transfer(0xFF); // mosi stays high too
+		}
+
+		return;
+	}
+
 	for (int i=0; i<80; i++)
 	{
 		sdcard_toggle();
@@ -937,8 +1395,12 @@ void sdcard_pump()
 int sdcard_initialize()
 {
 	unsigned char temp_value = 0x00;
+	unsigned char temp_version = 0x00; // 0x01 for cards before 2.00, which do not know CMD8
 
-	pinMode(sdcard_ss, OUTPUT);
+	sdcard_ready = 0x00;
+	sdcard_sdhc = 0x00;
+
+	pinMode(sdcard_ss, OUTPUT); // also keeps the SPI peripheral the master
 	pinMode(sdcard_mosi, OUTPUT);
 	pinMode(sdcard_miso, INPUT_PULLUP);
 	pinMode(sdcard_sclk, OUTPUT);
@@ -947,6 +1409,12 @@ int sdcard_initialize()
 	digitalWrite(sdcard_mosi, LOW);
 	digitalWrite(sdcard_sclk, LOW);
 
+	if (sdcard_transport == 1)
+	{
+		SPCR = (unsigned char)((1 << SPE) | (1 << MSTR) | (1 << SPR1) | (1 << SPR0)); // 125 kHz, below the 400 kHz allowed until ready
+		SPSR = 0x00;
+	}
+
 	sdcard_disable();
 	sdcard_pump();
 	sdcard_longdelay();
@@ -957,7 +1425,7 @@ int sdcard_initialize()
 	sdcard_sendbyte(0x00);
 	sdcard_sendbyte(0x00);
 	sdcard_sendbyte(0x95); // CRC for CMD0
-	temp_value = sdcard_waitresult(); // command response
+	temp_value = sdcard_waitresult(sdcard_readtime); // command response
 	if (temp_value == 0xFF) { return 0; }
 	sdcard_disable();
 	if (temp_value != 0x01) { return 0; } // expecting 0x01
@@ -970,16 +1438,23 @@ int sdcard_initialize()
 	sdcard_sendbyte(0x01);
 	sdcard_sendbyte(0xAA); 
 	sdcard_sendbyte(0x87); // CRC for CMD8
-	temp_value = sdcard_waitresult(); // command response
+	temp_value = sdcard_waitresult(sdcard_readtime); // command response
 	if (temp_value == 0xFF) { return 0; }
-	sdcard_disable();
-	if (temp_value != 0x01) { return 0; } // expecting 0x01
-	sdcard_enable();
-	temp_value = sdcard_receivebyte(); // 32-bit return value, ignore
-	temp_value = sdcard_receivebyte();
-	temp_value = sdcard_receivebyte();
-	temp_value = sdcard_receivebyte();
-	sdcard_disable();
+	if (temp_value == 0x05) // illegal command, so an older card
+	{
+		sdcard_disable();
+		temp_version = 0x01;
+	}
+	else
+	{
+		if (temp_value != 0x01) { sdcard_disable(); return 0; } // expecting 0x01
+		temp_value = sdcard_receivebyte(); // 32-bit return value, voltage then check pattern
+		temp_value = sdcard_receivebyte();
+		temp_value = sdcard_receivebyte();
+		temp_value = sdcard_receivebyte();
+		sdcard_disable();
+		if (temp_value != 0xAA) { return 0; } // check pattern comes back
+	}
 	do {
 		sdcard_pump();
 		sdcard_longdelay();
@@ -990,7 +1465,7 @@ int sdcard_initialize()
 		sdcard_sendbyte(0x00);
 		sdcard_sendbyte(0x00);
 		sdcard_sendbyte(0x01); // CRC (general)
-		temp_value = sdcard_waitresult(); // command response
+		temp_value = sdcard_waitresult(sdcard_readtime); // command response
 		if (temp_value == 0xFF) { return 0; }
 		sdcard_disable();
 		if (temp_value != 0x01) { return 0; } // expecting 0x01
@@ -998,104 +1473,416 @@ int sdcard_initialize()
 		sdcard_longdelay();
 		sdcard_enable();
 		sdcard_sendbyte(0x69); // CMD41 = 0x40 + 0x29 (41 in hex)
-		sdcard_sendbyte(0x40); // needed for CMD41?
+		sdcard_sendbyte(temp_version == 0x00 ? 0x40 : 0x00); // HCS, this host takes SDHC cards, but not for older cards
 		sdcard_sendbyte(0x00);
 		sdcard_sendbyte(0x00);
 		sdcard_sendbyte(0x00);
 		sdcard_sendbyte(0x01); // CRC (general)
-		temp_value = sdcard_waitresult(); // command response
+		temp_value = sdcard_waitresult(sdcard_readtime); // command response
 		if (temp_value == 0xFF) { return 0; }
 		sdcard_disable();
 		if (temp_value != 0x00 && temp_value != 0x01) { return 0; } // expecting 0x00, if 0x01 try again
 		sdcard_longdelay();
 	} while (temp_value == 0x01);
 
+	if (temp_version == 0x00)
+	{
+		sdcard_enable();
+		sdcard_sendbyte(0x7A); // CMD58 = 0x40 + 0x3A (58 in hex)
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x01); // CRC (general)
+		temp_value = sdcard_waitresult(sdcard_readtime); // command response
+		if (temp_value != 0x00) { sdcard_disable(); return 0; } // expecting 0x00
+		temp_value = sdcard_receivebyte(); // 32-bit OCR, CCS is bit 30
+		if (temp_value & 0x40) sdcard_sdhc = 0x01;
+		temp_value = sdcard_receivebyte();
+		temp_value = sdcard_receivebyte();
+		temp_value = sdcard_receivebyte();
+		sdcard_disable();
+	}
+
+	if (sdcard_sdhc == 0x00)
+	{
+		sdcard_enable();
+		sdcard_sendbyte(0x50); // CMD16 = 0x40 + 0x10 (16 in hex)
+		sdcard_sendbyte(0x00); // blocks of 512 bytes, as SDHC cards always are
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x02);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x01); // CRC (general)
+		temp_value = sdcard_waitresult(sdcard_readtime); // command response
+		sdcard_disable();
+		if (temp_value != 0x00) { return 0; } // expecting 0x00
+	}
+
+	if (sdcard_transport == 1)
+	{
+		SPCR = (unsigned char)((1 << SPE) | (1 << MSTR)); // full speed from here on, 8 MHz
+		SPSR = (unsigned char)(1 << SPI2X);
+	}
+
+	sdcard_ready = 0x01;
+
 	return 1;
 };
 
-int sdcard_readblock(unsigned char high, unsigned char low)
+int sdcard_command(unsigned char command, unsigned long block) // selects the card and sends a block command, no pump or delay needed once ready
 {
 	unsigned char temp_value = 0x00;
 
-	sdcard_disable();
-	sdcard_pump();
-	sdcard_longdelay();
+	if (sdcard_sdhc == 0x00) block = block << 9; // byte address of the block
+
 	sdcard_enable();
-	sdcard_sendbyte(0x51); // CMD17 = 0x40 + 0x11 (17 in hex)
-	sdcard_sendbyte(0x00);
-	sdcard_sendbyte(high);
-	sdcard_sendbyte(low&0xFE); // only blocks of 512 bytes
-	sdcard_sendbyte(0x00);
+	sdcard_receivebyte(); // one byte with the card selected before each command
+	sdcard_sendbyte(command);
+	sdcard_sendbyte((unsigned char)((block >> 24) & 0xFF));
+	sdcard_sendbyte((unsigned char)((block >> 16) & 0xFF));
+	sdcard_sendbyte((unsigned char)((block >> 8) & 0xFF));
+	sdcard_sendbyte((unsigned char)(block & 0xFF));
 	sdcard_sendbyte(0x01); // CRC (general)
-	temp_value = sdcard_waitresult(); // command response
-	if (temp_value == 0xFF) { return 0; }
-	else if (temp_value != 0x00) { return 0; } // expecting 0x00
-	temp_value = sdcard_waitresult(); // data packet starts with 0xFE
-	if (temp_value == 0xFF) { return 0; }
-	else if (temp_value != 0xFE) { return 0; }
-	for (int i=0; i<512; i++) // packet of 512 bytes
+	temp_value = sdcard_waitresult(sdcard_readtime); // command response
+	if (temp_value != 0x00) { sdcard_disable(); sdcard_ready = 0x00; return 0; } // expecting 0x00
+
+	return 1;
+};
+
+int sdcard_readblocks(unsigned long block, const unsigned int count, unsigned int remote, unsigned char *buf, const unsigned int len) // 'count' blocks in a row into extended RAM, 'len' bytes at a time
+{
+	unsigned char temp_value = 0x00;
+
+	if (!sdcard_command((count > 1 ? 0x52 : 0x51), block)) { return 0; } // CMD18 = 0x40 + 0x12 (18 in hex), or CMD17 for one block
+
+	for (unsigned int b=0; b<count; b++)
 	{
+		temp_value = sdcard_waitresult(sdcard_readtime); // data packet starts with 0xFE
+		if (temp_value != 0xFE) { sdcard_disable(); sdcard_ready = 0x00; return 0; }
+		for (unsigned int i=0; i<512; i+=len) // packet of 512 bytes
+		{
+			for (unsigned int j=0; j<len; j++)
+			{
+				buf[j] = sdcard_receivebyte();
+			}
+
+			display_sendblock((unsigned char)((remote+i)/256), (unsigned char)((remote+i)%256), buf, len); // the card waits for the clock
+		}
+		temp_value = sdcard_receivebyte(); // CRC, ignored in SPI mode
 		temp_value = sdcard_receivebyte();
-		shared_memory[i] = temp_value;
+
+		remote += 512;
+	}
+
+	if (count > 1)
+	{
+		sdcard_sendbyte(0x4C); // CMD12 = 0x40 + 0x0C (12 in hex), stops the transmission
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x00);
+		sdcard_sendbyte(0x01); // CRC (general)
+		temp_value = sdcard_receivebyte(); // stuff byte
+		temp_value = sdcard_waitresult(sdcard_readtime); // command response
+		if (temp_value != 0x00 || !sdcard_waitready()) { sdcard_disable(); sdcard_ready = 0x00; return 0; }
 	}
-	temp_value = sdcard_receivebyte(); // data packet ends with 0x55 then 0xAA
-	temp_value = sdcard_receivebyte(); // ignore here
+
 	sdcard_disable();
 
 	return 1;
 };
 
-int sdcard_writeblock(unsigned char high, unsigned char low)
+int sdcard_writeblocks(unsigned long block, const unsigned int count, unsigned int remote, unsigned char *buf, const unsigned int len) // 'count' blocks in a row from extended RAM, 'len' bytes at a time
 {
 	unsigned char temp_value = 0x00;
 
-	sdcard_disable();
-	sdcard_pump();
-	sdcard_longdelay();
-	sdcard_enable();
-	sdcard_sendbyte(0x58); // CMD24 = 0x40 + 0x18 (24 in hex)
-	sdcard_sendbyte(0x00);
-	sdcard_sendbyte(high);
-	sdcard_sendbyte(low&0xFE); // only blocks of 512 bytes
-	sdcard_sendbyte(0x00);
-	sdcard_sendbyte(0x01); // CRC (general)
-	temp_value = sdcard_waitresult(); // command response
-	if (temp_value == 0xFF) { return 0; }
-	else if (temp_value != 0x00) { return 0; } // expecting 0x00
-	sdcard_sendbyte(0xFE); // data packet starts with 0xFE
-	for (int i=0; i<512; i++) // packet of 512 bytes
+	if (!sdcard_command((count > 1 ? 0x59 : 0x58), block)) { return 0; } // CMD25 = 0x40 + 0x19 (25 in hex), or CMD24 for one block
+
+	for (unsigned int b=0; b<count; b++)
+	{
+		sdcard_sendbyte(count > 1 ? 0xFC : 0xFE); // data packet starts with 0xFC for each of many blocks, or 0xFE for one
+		for (unsigned int i=0; i<512; i+=len) // packet of 512 bytes
+		{
+			display_receiveblock((unsigned char)((remote+i)/256), (unsigned char)((remote+i)%256), buf, len);
+
+			for (unsigned int j=0; j<len; j++)
+			{
+				sdcard_sendbyte(buf[j]);
+			}
+		}
+		sdcard_sendbyte(0xFF); // CRC, ignored in SPI mode
+		sdcard_sendbyte(0xFF);
+		temp_value = sdcard_waitresult(sdcard_busy); // data response
+		if ((temp_value & 0x1F) != 0x05 || !sdcard_waitready()) { sdcard_disable(); sdcard_ready = 0x00; return 0; } // accepted, then written
+
+		remote += 512;
+	}
+
+	if (count > 1)
 	{
-		temp_value = shared_memory[i]; 
-		sdcard_sendbyte(temp_value);
+		sdcard_sendbyte(0xFD); // stop token
+		temp_value = sdcard_receivebyte(); // stuff byte
+		if (!sdcard_waitready()) { sdcard_disable(); sdcard_ready = 0x00; return 0; }
 	}
-	sdcard_sendbyte(0x55); // data packet ends with 0x55 then 0xAA
-	sdcard_sendbyte(0xAA);
-	temp_value = sdcard_receivebyte(); // toggle clock 8 times
+
 	sdcard_disable();
 
 	return 1;
 };
 
-const int audio_output = 9;
-
-void audio_note(unsigned int value)
+const int audio_output = 9; // OC1A, a PWM output that the speaker smooths into the sound
+
+// Timer1 counts to audio_top at 16 MHz in fast PWM mode, so each overflow is one sample, 15625 a second.
+// The overflow interrupt mixes the voices into OCR1A in roughly 150 of the 1024 cycles between samples,
+// so the keyboard interrupt waits no more than about ten microseconds, well inside a PS/2 clock pulse.
+
+const unsigned int audio_top = 1023;
+const unsigned char audio_voices = 3;
+const unsigned char audio_rate = 244; // samples each sequencer tick, 64 ticks a second
+const unsigned char audio_size = 8; // bytes of events waiting, a power of two
+const unsigned int audio_shortest = 64; // microseconds high and low for audio_note(), higher notes would alias
+
+const signed char audio_waves[128] PROGMEM = { // 32 samples each of square, triangle, saw, and sine
+	120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, 120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120, -120,
+	-120, -104, -88, -72, -56, -40, -24, -8, 8, 24, 40, 56, 72, 88, 104, 120, 120, 104, 88, 72, 56, 40, 24, 8, -8, -24, -40, -56, -72, -88, -104, -120,
+	-120, -112, -105, -97, -89, -81, -74, -66, -58, -50, -43, -35, -27, -19, -12, -4, 4, 12, 19, 27, 35, 43, 50, 58, 66, 74, 81, 89, 97, 105, 112, 120,
+	0, 23, 46, 67, 85, 100, 111, 118, 120, 118, 111, 100, 85, 67, 46, 23, 0, -23, -46, -67, -85, -100, -111, -118, -120, -118, -111, -100, -85, -67, -46, -23 };
+
+const unsigned int audio_steps[12] PROGMEM = { 8779, 9301, 9854, 10440, 11060, 11718, 12415, 13153, 13935, 14764, 15642, 16572 }; // C7 to B7, halved for each octave below
+
+// Events, from a song in PROGMEM or from audio_queue, each note lasting until its voice gets another:
+//   0x01 to 0x3F, length    note on the current voice, C2 to D7, then 'length' ticks before the next event
+//   0x40, length            rest on the current voice
+//   0x41 to 0x43            current voice, 1 to 3
+//   0x48 to 0x4B            wave of the current voice, square, triangle, saw, or sine
+//   0x50, low, high, length square wave on voice 1 with that phase step, for audio_note()
+//   0x00                    end, the sound stops when nothing follows
+// A length of zero starts the next event at the same time, for chords.
+
+const unsigned char audio_event_rest = 0x40;
+const unsigned char audio_event_voice = 0x41;
+const unsigned char audio_event_wave = 0x48;
+const unsigned char audio_event_step = 0x50;
+
+volatile unsigned int audio_phase[audio_voices];
+volatile unsigned int audio_step[audio_voices]; // added to the phase each sample, zero when silent
+volatile unsigned char audio_shape = 0x00; // two bits for each voice, which of the four audio_waves it plays, voice 0 in the lowest, and the voice events are for in the top two
+
+volatile unsigned char audio_queue[audio_size];
+volatile unsigned char audio_head = 0x00; // written by audio_push()
+volatile unsigned char audio_tail = 0x00; // written by the Timer1 interrupt
+const unsigned char * volatile audio_song = NULL; // events in PROGMEM, played before audio_queue
+
+volatile unsigned char audio_wait = 0x00; // ticks left before the next event
+volatile unsigned char audio_count = 0x00; // samples left in this tick
+
+void audio_begin() // Timer1 as the DAC, starting at the middle level
 {
+	if (TIMSK1 != 0x00) return; // Timer1 runs already
+
+	audio_wait = 0x00;
+	audio_count = audio_rate;
+
 	pinMode(audio_output, OUTPUT);
 
+	TCCR1B = 0x00; // stopped while it changes
+	TCNT1 = 0;
+	ICR1 = audio_top;
+	OCR1A = (audio_top + 1) / 2;
+
+	TCCR1A = (unsigned char)((1 << COM1A1) | (1 << WGM11));
+	TCCR1B = (unsigned char)((1 << WGM13) | (1 << WGM12) | (1 << CS10));
+	TIMSK1 = (unsigned char)(1 << TOIE1);
+};
+
+void audio_silence() // stops Timer1 and every voice, and leaves the pin low
+{
+	TIMSK1 = 0x00;
+	TCCR1B = 0x00;
+	TCCR1A = 0x00;
+
 	digitalWrite(audio_output, LOW);
 
-	unsigned char temp_value = 0x00;
+	for (int i=0; i<audio_voices; i++) audio_step[i] = 0;
+
+	audio_song = NULL;
+};
+
+unsigned char audio_next() // the next byte of events, 0x00 when there are none yet
+{
+	unsigned char temp_byte;
+
+	if (audio_song != NULL)
+	{
+		temp_byte = pgm_read_byte(audio_song);
+
+		if (temp_byte != 0x00)
+		{
+			audio_song++;
+
+			return temp_byte;
+		}
+
+		audio_song = NULL;
+	}
+
+	if (audio_tail == audio_head) return 0x00;
+
+	temp_byte = audio_queue[audio_tail];
+
+	audio_tail = (unsigned char)((audio_tail + 1) & (audio_size - 1));
+
+	return temp_byte;
+};
+
+void audio_tick() // 64 times a second, from the interrupt
+{
+	unsigned char temp_byte;
+	unsigned int temp_step;
+	unsigned char temp_voice = (unsigned char)(audio_shape >> 6);
+
+	if (audio_wait > 1)
+	{
+		audio_wait--;
+
+		return;
+	}
+
+	audio_wait = 0x00;
+
+	for (int i=0; i<8; i++) // a few events starting together, the rest wait for the next tick
+	{
+		temp_byte = audio_next();
+
+		if (temp_byte == 0x00) // nothing more
+		{
+			if (i == 0) audio_silence(); // otherwise the rest of a chord may still be on its way
+
+			return;
+		}
+		else if (temp_byte <= audio_event_rest) // note or rest
+		{
+			if (temp_byte == audio_event_rest) temp_step = 0;
+			else temp_step = pgm_read_word(&audio_steps[(temp_byte - 1) % 12]) >> (5 - (temp_byte - 1) / 12);
+
+			audio_step[temp_voice] = temp_step;
+
+			audio_wait = audio_next();
+		}
+		else if (temp_byte >= audio_event_voice && temp_byte < audio_event_voice + audio_voices)
+		{
+			temp_voice = (unsigned char)(temp_byte - audio_event_voice);
+
+			audio_shape = (unsigned char)((audio_shape & 0x3F) | (temp_voice << 6));
+		}
+		else if (temp_byte >= audio_event_wave && temp_byte < audio_event_wave + 4)
+		{
+			audio_shape = (unsigned char)((audio_shape & ~(0x03 << (temp_voice*2))) | ((temp_byte - audio_event_wave) << (temp_voice*2)));
+		}
+		else if (temp_byte == audio_event_step)
+		{
+			temp_voice = 0x00;
+			audio_shape &= 0x3C; // voice 0, square
+
+			temp_step = (unsigned int)audio_next();
+			temp_step += (unsigned int)audio_next() * 256;
+
+			audio_step[0] = temp_step;
+
+			audio_wait = audio_next();
+		}
+
+		if (audio_wait > 0) return;
+	}
+};
+
+ISR(TIMER1_OVF_vect) // one sample, with the voices added up around the middle level
+{
+	int temp_sample = (audio_top + 1) / 2;
+	unsigned char temp_shape = audio_shape;
+
+	for (int i=0; i<audio_voices; i++)
+	{
+		if (audio_step[i] != 0)
+		{
+			audio_phase[i] += audio_step[i];
+
+			temp_sample += (signed char)pgm_read_byte(&audio_waves[((temp_shape & 0x03) << 5) + ((unsigned char)(audio_phase[i] >> 8) >> 3)]); // top five bits
+		}
+
+		temp_shape >>= 2;
+	}
+
+	OCR1A = (unsigned int)temp_sample; // used from the next sample
+
+	audio_count--;
 
-	for (unsigned long i=0; i<(unsigned long)(100000/(value+1)); i++) // needs modifying a litte
+	if (audio_count == 0x00)
 	{
-		digitalWrite(audio_output, HIGH);
+		audio_count = audio_rate;
+
+		audio_tick();
+	}
+};
+
+unsigned char audio_room() // bytes audio_push() can take without waiting
+{
+	return (unsigned char)((audio_tail - audio_head - 1) & (audio_size - 1));
+};
+
+void audio_push(const unsigned char *event, const unsigned char length) // queues one whole event, waiting for room if need be
+{
+	while (audio_room() < length) delay(1); // until the interrupt takes some
 
-		delayMicroseconds(value);
+	noInterrupts();
 
-		digitalWrite(audio_output, LOW);
+	for (int i=0; i<length; i++) audio_queue[(audio_head + i) & (audio_size - 1)] = event[i];
 
-		delayMicroseconds(value);
+	audio_head = (unsigned char)((audio_head + length) & (audio_size - 1)); // all of it at once
+
+	audio_begin();
+
+	interrupts();
+};
+
+void audio_play(const unsigned char *song) // events in PROGMEM, ending with 0x00, instead of any song playing
+{
+	noInterrupts();
+
+	audio_song = song;
+	audio_wait = 0x00; // from the next tick
+
+	audio_begin();
+
+	interrupts();
+};
+
+void audio_note(unsigned int value) // 'value' microseconds high then low for about a fifth of a second, zero for a rest
+{
+	unsigned char temp_event[4];
+	unsigned long temp_step;
+
+	if (value == 0)
+	{
+		temp_event[0] = audio_event_voice;
+		temp_event[1] = audio_event_rest;
+		temp_event[2] = 13; // ticks
+
+		audio_push(temp_event, 3);
+
+		return;
 	}
+
+	if (value < audio_shortest) value = audio_shortest;
+
+	temp_step = 2097152 / (unsigned long)value; // 65536 steps a period, at 15625 samples a second
+
+	temp_event[0] = audio_event_step;
+	temp_event[1] = (unsigned char)(temp_step & 0xFF);
+	temp_event[2] = (unsigned char)((temp_step >> 8) & 0xFF);
+	temp_event[3] = 13;
+
+	audio_push(temp_event, 4);
 };
 
 unsigned char eeprom_read(unsigned char low, unsigned char high)
@@ -1103,9 +1890,9 @@ unsigned char eeprom_read(unsigned char low, unsigned char high)
 	return EEPROM.read((unsigned int)((high*256)+low)%1024);
 };
 
-void eeprom_write(unsigned char low, unsigned char high, unsigned char data)
+void eeprom_write(unsigned char low, unsigned char high, unsigned char data) // 3.3 ms, but only when the byte is different
 {
-	EEPROM.write((unsigned int)((high*256)+low)%1024, (unsigned char)data);
+	EEPROM.update((unsigned int)((high*256)+low)%1024, (unsigned char)data);
 };
 
 
@@ -1194,7 +1981,7 @@ const unsigned char rogue_text_welcome[42] PROGMEM = "Grab the Amulet on Floor 5
 const unsigned char rogue_text_died[28] PROGMEM = "You died! Press \\ to exit.\n";
 const unsigned char rogue_text_ascended[32] PROGMEM = "You ascended! Press \\ to exit.\n";
 
-const unsigned char rogue_text_direction[16] PROGMEM = "What direction?\n";
+const unsigned char rogue_text_direction[17] PROGMEM = "What direction?\n";
 
 const unsigned char rogue_text_levelup[16] PROGMEM = "You leveled up\n";
 const unsigned char rogue_text_hungry[16] PROGMEM = "You are hungry\n";
@@ -1206,12 +1993,12 @@ const unsigned char rogue_text_picked[16] PROGMEM = "You picked up \n";
 const unsigned char rogue_text_drank[12] PROGMEM = "You drank \n";
 const unsigned char rogue_text_read[12] PROGMEM = "You read \n";
 const unsigned char rogue_text_shot[12] PROGMEM = "You shot \n";
-const unsigned char rogue_text_struck[12] PROGMEM = " struck you\n";
+const unsigned char rogue_text_struck[13] PROGMEM = " struck you\n";
 
 const unsigned char rogue_text_fungus[8] PROGMEM = "Fungus\n";
-const unsigned char rogue_text_bat[4] PROGMEM = "Bat\n";
+const unsigned char rogue_text_bat[5] PROGMEM = "Bat\n";
 const unsigned char rogue_text_goblin[8] PROGMEM = "Goblin\n";
-const unsigned char rogue_text_hobgoblin[10] PROGMEM = "Hobgoblin\n";
+const unsigned char rogue_text_hobgoblin[11] PROGMEM = "Hobgoblin\n";
 const unsigned char rogue_text_troll[8] PROGMEM = "Troll\n";
 const unsigned char rogue_text_ogre[6] PROGMEM = "Ogre\n";
 
@@ -1227,6 +2014,11 @@ const unsigned char rogue_text_amulet[8] PROGMEM = "Amulet\n";
 
 const unsigned char rogue_text_break[4] PROGMEM = ". \n";
 
+const unsigned char rogue_song_levelup[11] PROGMEM = { 0x41, 0x49, 37, 6, 41, 6, 44, 6, 49, 12, 0x00 }; // events for audio_play()
+const unsigned char rogue_song_amulet[13] PROGMEM = { 0x41, 0x4B, 37, 0, 0x42, 0x4B, 41, 0, 0x43, 0x4B, 44, 32, 0x00 };
+const unsigned char rogue_song_died[11] PROGMEM = { 0x41, 0x4A, 32, 12, 31, 12, 30, 12, 29, 32, 0x00 };
+const unsigned char rogue_song_ascended[19] PROGMEM = { 0x41, 0x48, 37, 8, 37, 8, 37, 8, 44, 16, 0x42, 0x48, 41, 0, 0x43, 0x48, 49, 40, 0x00 };
+
 unsigned char rogue_text_position = 0;
 
 
@@ -1404,10 +2196,7 @@ void rogue_setuprooms()
 		rogue_player_r = random(100);
 	}
 
-	for (unsigned int i=0x0000; i<0x2000; i++)
-	{
-		display_sendpacket(i/256, i%256, 0x00); // clears map and visibility
-	}
+	display_fill(0x00, 0x00, 0x00, 0x2000); // clears map and visibility
 
 	unsigned char tx, ty, dx, dy, w, b, qx, qy;
 	
@@ -1461,9 +2250,9 @@ void rogue_setuprooms()
 	char path_horz[2][3];
 	char count;
 
-	for (char i=0; i<3; i++)
+	for (unsigned char i=0; i<3; i++)
 	{
-		for (char j=0; j<2; j++)
+		for (unsigned char j=0; j<2; j++)
 		{	
 			path_vert[i][j] = random(2);
 			path_horz[j][i] = random(2);
@@ -1472,18 +2261,18 @@ void rogue_setuprooms()
 
 	while (true)
 	{
-		for (char i=0; i<3; i++)
+		for (unsigned char i=0; i<3; i++)
 		{
-			for (char j=0; j<2; j++)
+			for (unsigned char j=0; j<2; j++)
 			{	
 				path_vert[i][j] = random(2);
 				path_horz[j][i] = random(2);
 			}
 		}
 
-		for (char i=0; i<3; i++)
+		for (unsigned char i=0; i<3; i++)
 		{
-			for (char j=0; j<3; j++)
+			for (unsigned char j=0; j<3; j++)
 			{
 				conn[i][j] = 0;
 			}
@@ -1550,9 +2339,9 @@ void rogue_setuprooms()
 
 			count = 0;
 
-			for (char i=0; i<3; i++)
+			for (unsigned char i=0; i<3; i++)
 			{
-				for (char j=0; j<3; j++)
+				for (unsigned char j=0; j<3; j++)
 				{
 					if (conn[i][j] > 0) count++;
 				}
@@ -2357,6 +3146,8 @@ void rogue_levelup()
 	
 		rogue_printmessage(rogue_text_levelup);
 		rogue_printmessage(rogue_text_break);
+
+		audio_play(rogue_song_levelup);
 	}
 };
 
@@ -2472,6 +3263,8 @@ void rogue_moveplayer(unsigned char tx, unsigned char ty)
 					rogue_printmessage(rogue_text_picked);
 					rogue_printmessage(rogue_text_amulet);
 					rogue_printmessage(rogue_text_break);
+
+					audio_play(rogue_song_amulet);
 				}
 				else if (screen_memory[rogue_item_t + i] == rogue_char_item_gold) // gold
 				{
@@ -2686,7 +3479,7 @@ void rogue_clearmessage()
 	rogue_text_position = 0;
 };
 
-void rogue_printmessage(const unsigned int place)
+void rogue_printmessage(const unsigned char *place)
 {
 	for (int i=0; i<64; i++)
 	{
@@ -2999,6 +3792,8 @@ void rogue_mainloop()
 
 						rogue_printmessage(rogue_text_ascended);				
 
+						audio_play(rogue_song_ascended);
+
 						while (true)
 						{
 							k = keyboard_character();
@@ -3046,6 +3841,8 @@ void rogue_mainloop()
 
 				rogue_printmessage(rogue_text_died);				
 
+				audio_play(rogue_song_died);
+
 				while (true)
 				{
 					k = keyboard_character();
@@ -3067,11 +3864,11 @@ void setup()
 {
 	// put your setup code here, to run once:
 
-	Serial.begin(9600);
+	if (serial_output || serial_input) serial_begin(); // not with display_transport 2, which takes the USART
 
 	if (serial_output)
 	{
-		Serial.println("");
+		serial_newline();
 	}
 
 	for (int i=0; i<512; i++) shared_memory[i] = 0x00;
@@ -3120,6 +3917,8 @@ void loop()
 		}
 	}
 
+	keyboard_flush();
+
 		
 }
 